@@ -0,0 +1,501 @@
+#include "AllocationTracking.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <new>
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#define HAS_MALLOC_HOOK true
+#else
+#define HAS_MALLOC_HOOK false
+#endif
+
+// Phase 0 collects the allocations made outside of any named phase
+static const uint32_t max_allocation_phases = 32;
+
+struct AllocationCounter
+{
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> bytes;
+
+    void Add(uint64_t size)
+    {
+        count.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void Reset()
+    {
+        count.store(0, std::memory_order_relaxed);
+        bytes.store(0, std::memory_order_relaxed);
+    }
+};
+
+static AllocationCounter phaseCounters[max_allocation_phases][ALLOCATION_SOURCE_COUNT];
+static AllocationCounter callbackCounters[ALLOCATION_SOURCE_COUNT];
+static AllocationCounter vulkanScopeCounters[VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1];
+static std::atomic<uint64_t> callbackInvocations(0);
+static std::atomic<uint64_t> operatorNewCount(0);
+
+// Set by InitializeAllocationTracking, until then the hooks only forward to the allocator
+static std::atomic<bool> trackingEnabled(false);
+
+static const char *phaseNames[max_allocation_phases] = { "(other)" };
+static std::atomic<uint32_t> phaseNameCount(1);
+
+// Guards the registration of phase names, the lookups read the names registered so far without it
+static std::mutex phaseNameMutex;
+
+// Each thread counts its allocations against the phase it is in, several threads may run dispatches at once
+static thread_local uint32_t currentPhase = 0;
+
+// Allocations made on a thread that is inside a Vulkan callback are counted for the callback
+static thread_local uint32_t callbackDepth = 0;
+
+// Set while operator new or the Vulkan allocator calls malloc, so the malloc hook does not count them twice
+static thread_local bool insideTrackedAllocation = false;
+
+static void CountAllocation(AllocationSource source, uint64_t size)
+{
+    if (0 != callbackDepth)
+    {
+        callbackCounters[source].Add(size);
+    }
+
+    phaseCounters[currentPhase][source].Add(size);
+}
+
+// Returns the index of a phase name, registering it the first time it is seen
+// The names are string literals, so they are compared by address
+static uint32_t GetPhaseIndex(const char *name)
+{
+    uint32_t count = phaseNameCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (phaseNames[i] == name)
+        {
+            return i;
+        }
+    }
+
+    // Another thread may have registered the name since, it is looked for again under the lock
+    std::lock_guard<std::mutex> lock(phaseNameMutex);
+
+    const uint32_t checkedCount = count;
+    count = phaseNameCount.load(std::memory_order_relaxed);
+    for (uint32_t i = checkedCount; i < count; i++)
+    {
+        if (phaseNames[i] == name)
+        {
+            return i;
+        }
+    }
+
+    if (count == max_allocation_phases)
+    {
+        return 0;
+    }
+
+    phaseNames[count] = name;
+    phaseNameCount.store(count + 1, std::memory_order_release);
+
+    return count;
+}
+
+AllocationPhaseScope::AllocationPhaseScope(const char *name) : previousPhase(currentPhase)
+{
+    currentPhase = GetPhaseIndex(name);
+}
+
+AllocationPhaseScope::~AllocationPhaseScope()
+{
+    currentPhase = previousPhase;
+}
+
+AllocationCallbackScope::AllocationCallbackScope()
+{
+    if (0 == callbackDepth++)
+    {
+        callbackInvocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+AllocationCallbackScope::~AllocationCallbackScope()
+{
+    callbackDepth--;
+}
+
+uint64_t GetOperatorNewCount()
+{
+    return operatorNewCount.load(std::memory_order_relaxed);
+}
+
+bool IsAllocationTrackingEnabled()
+{
+    return trackingEnabled.load(std::memory_order_relaxed);
+}
+
+#if ENABLE_ALLOCATION_TRACKING
+
+// Allocates for the two operator new overloads below, with the default alignment when alignment is 0
+// The array and nothrow forms of operator new call those overloads
+static void *TrackedOperatorNew(size_t size, size_t alignment)
+{
+    size = 0 == size ? 1 : size;
+
+    if (trackingEnabled.load(std::memory_order_relaxed))
+    {
+        operatorNewCount.fetch_add(1, std::memory_order_relaxed);
+        CountAllocation(ALLOCATION_SOURCE_OPERATOR_NEW, size);
+    }
+
+    insideTrackedAllocation = true;
+#if defined(_MSC_VER)
+    void *pointer = 0 == alignment ? malloc(size) : _aligned_malloc(size, alignment);
+#else
+    void *pointer = 0 == alignment ? malloc(size) : aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+    insideTrackedAllocation = false;
+
+    if (nullptr == pointer)
+    {
+        throw std::bad_alloc();
+    }
+
+    return pointer;
+}
+
+static void FreeAligned(void *pointer)
+{
+#if defined(_MSC_VER)
+    _aligned_free(pointer);
+#else
+    free(pointer);
+#endif
+}
+
+void *operator new(size_t size)
+{
+    return TrackedOperatorNew(size, 0);
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    return TrackedOperatorNew(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void *pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+
+// Every Vulkan host allocation is preceded by this header, which remembers where the
+// underlying malloc block starts so that any alignment can be honored
+struct VulkanAllocationHeader
+{
+    void *block;
+    size_t size;
+};
+
+static void *VKAPI_PTR TrackedVulkanAllocation(void *pUserData, size_t size, size_t alignment, VkSystemAllocationScope allocationScope)
+{
+    if (0 == size)
+    {
+        return nullptr;
+    }
+
+    alignment = std::max(alignment, alignof(VulkanAllocationHeader));
+
+    insideTrackedAllocation = true;
+    void *const block = malloc(size + alignment + sizeof(VulkanAllocationHeader));
+    insideTrackedAllocation = false;
+
+    if (nullptr == block)
+    {
+        return nullptr;
+    }
+
+    const uintptr_t address = (reinterpret_cast<uintptr_t>(block) + sizeof(VulkanAllocationHeader) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+
+    VulkanAllocationHeader *const header = reinterpret_cast<VulkanAllocationHeader *>(address) - 1;
+    header->block = block;
+    header->size = size;
+
+    CountAllocation(ALLOCATION_SOURCE_VULKAN_HOST, size);
+    if (allocationScope <= VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE)
+    {
+        vulkanScopeCounters[allocationScope].Add(size);
+    }
+
+    return reinterpret_cast<void *>(address);
+}
+
+static void VKAPI_PTR TrackedVulkanFree(void *pUserData, void *pMemory)
+{
+    if (nullptr != pMemory)
+    {
+        free((reinterpret_cast<VulkanAllocationHeader *>(pMemory) - 1)->block);
+    }
+}
+
+static void *VKAPI_PTR TrackedVulkanReallocation(void *pUserData, void *pOriginal, size_t size, size_t alignment, VkSystemAllocationScope allocationScope)
+{
+    if (0 == size)
+    {
+        TrackedVulkanFree(pUserData, pOriginal);
+        return nullptr;
+    }
+
+    void *const pMemory = TrackedVulkanAllocation(pUserData, size, alignment, allocationScope);
+    if (nullptr != pMemory && nullptr != pOriginal)
+    {
+        memcpy(pMemory, pOriginal, std::min(size, (reinterpret_cast<VulkanAllocationHeader *>(pOriginal) - 1)->size));
+        TrackedVulkanFree(pUserData, pOriginal);
+    }
+
+    return pMemory;
+}
+
+static void VKAPI_PTR TrackedVulkanInternalAllocation(void *pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope)
+{
+    CountAllocation(ALLOCATION_SOURCE_VULKAN_HOST, size);
+    if (allocationScope <= VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE)
+    {
+        vulkanScopeCounters[allocationScope].Add(size);
+    }
+}
+
+static void VKAPI_PTR TrackedVulkanInternalFree(void *pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope)
+{
+}
+
+static const VkAllocationCallbacks trackedVulkanAllocator = {
+    nullptr,
+    TrackedVulkanAllocation,
+    TrackedVulkanReallocation,
+    TrackedVulkanFree,
+    TrackedVulkanInternalAllocation,
+    TrackedVulkanInternalFree
+};
+
+const VkAllocationCallbacks *GetVulkanAllocator()
+{
+    return trackingEnabled.load(std::memory_order_relaxed) ? &trackedVulkanAllocator : nullptr;
+}
+
+#if HAS_MALLOC_HOOK
+static int MallocHook(int allocationType, void *userData, size_t size, int blockType, long requestNumber, const unsigned char *filename, int lineNumber)
+{
+    if (!insideTrackedAllocation && _CRT_BLOCK != blockType && (_HOOK_ALLOC == allocationType || _HOOK_REALLOC == allocationType))
+    {
+        CountAllocation(ALLOCATION_SOURCE_MALLOC, size);
+    }
+
+    return 1;
+}
+#endif
+
+void InitializeAllocationTracking()
+{
+#if HAS_MALLOC_HOOK
+    _CrtSetAllocHook(MallocHook);
+#endif
+
+    trackingEnabled.store(true, std::memory_order_relaxed);
+}
+
+static void VKAPI_PTR DeviceMemoryReportCallback(const VkDeviceMemoryReportCallbackDataEXT *pCallbackData, void *pUserData)
+{
+    if (VK_DEVICE_MEMORY_REPORT_EVENT_TYPE_ALLOCATE_EXT == pCallbackData->type)
+    {
+        CountAllocation(ALLOCATION_SOURCE_DEVICE_MEMORY, pCallbackData->size);
+    }
+}
+
+void AddDeviceMemoryReport(VkPhysicalDevice physicalDevice, VkDeviceCreateInfo &deviceCreateInfo, DeviceMemoryReportChain &chain)
+{
+    if (!trackingEnabled.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    const bool extensionFound = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const VkExtensionProperties &properties)
+    {
+        return 0 == strcmp(VK_EXT_DEVICE_MEMORY_REPORT_EXTENSION_NAME, properties.extensionName);
+    });
+
+    if (!extensionFound)
+    {
+        return;
+    }
+
+    chain.features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DEVICE_MEMORY_REPORT_FEATURES_EXT;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &chain.features;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    if (VK_TRUE != chain.features.deviceMemoryReport)
+    {
+        return;
+    }
+
+    chain.extensions.assign(deviceCreateInfo.ppEnabledExtensionNames, deviceCreateInfo.ppEnabledExtensionNames + deviceCreateInfo.enabledExtensionCount);
+    chain.extensions.push_back(VK_EXT_DEVICE_MEMORY_REPORT_EXTENSION_NAME);
+
+    chain.createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_DEVICE_MEMORY_REPORT_CREATE_INFO_EXT;
+    chain.createInfo.pfnUserCallback = DeviceMemoryReportCallback;
+    chain.createInfo.pNext = deviceCreateInfo.pNext;
+    chain.features.pNext = &chain.createInfo;
+
+    deviceCreateInfo.pNext = &chain.features;
+    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(chain.extensions.size());
+    deviceCreateInfo.ppEnabledExtensionNames = chain.extensions.data();
+}
+
+#else
+
+const VkAllocationCallbacks *GetVulkanAllocator()
+{
+    return nullptr;
+}
+
+void InitializeAllocationTracking()
+{
+}
+
+void AddDeviceMemoryReport(VkPhysicalDevice physicalDevice, VkDeviceCreateInfo &deviceCreateInfo, DeviceMemoryReportChain &chain)
+{
+}
+
+#endif
+
+void ResetAllocationCounts()
+{
+    for (AllocationCounter (&counters)[ALLOCATION_SOURCE_COUNT] : phaseCounters)
+    {
+        for (AllocationCounter &counter : counters)
+        {
+            counter.Reset();
+        }
+    }
+
+    for (AllocationCounter &counter : callbackCounters)
+    {
+        counter.Reset();
+    }
+
+    for (AllocationCounter &counter : vulkanScopeCounters)
+    {
+        counter.Reset();
+    }
+
+    callbackInvocations.store(0, std::memory_order_relaxed);
+}
+
+// Writes "count (bytes B)" for one counter
+static void PrintCounter(const AllocationCounter &counter)
+{
+    std::cout << "\t" << counter.count.load(std::memory_order_relaxed) << " (" << counter.bytes.load(std::memory_order_relaxed) << " B)";
+}
+
+// Prints the allocation counts since the last reset, then resets them
+void ReportAllocationCounts(uint32_t dispatchIndex)
+{
+    // Snapshot the counters first, printing them allocates too
+    static AllocationCounter snapshot[max_allocation_phases][ALLOCATION_SOURCE_COUNT];
+    static AllocationCounter callbackSnapshot[ALLOCATION_SOURCE_COUNT];
+    static AllocationCounter scopeSnapshot[VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1];
+
+    const uint32_t phaseCount = phaseNameCount.load(std::memory_order_acquire);
+    for (uint32_t phase = 0; phase < phaseCount; phase++)
+    {
+        for (uint32_t source = 0; source < ALLOCATION_SOURCE_COUNT; source++)
+        {
+            snapshot[phase][source].count.store(phaseCounters[phase][source].count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            snapshot[phase][source].bytes.store(phaseCounters[phase][source].bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+
+    for (uint32_t source = 0; source < ALLOCATION_SOURCE_COUNT; source++)
+    {
+        callbackSnapshot[source].count.store(callbackCounters[source].count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        callbackSnapshot[source].bytes.store(callbackCounters[source].bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    for (uint32_t scope = 0; scope <= VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE; scope++)
+    {
+        scopeSnapshot[scope].count.store(vulkanScopeCounters[scope].count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        scopeSnapshot[scope].bytes.store(vulkanScopeCounters[scope].bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    const uint64_t invocations = callbackInvocations.load(std::memory_order_relaxed);
+
+    std::cout << "[ALLOCATIONS] : dispatch " << dispatchIndex << " : count (bytes) per source" << std::endl;
+    std::cout << "\tphase\toperator new\tmalloc" << (HAS_MALLOC_HOOK ? "" : " (not hooked)") << "\tVkAllocationCallbacks\tdevice memory" << std::endl;
+
+    for (uint32_t phase = 0; phase < phaseCount; phase++)
+    {
+        std::cout << "\t" << phaseNames[phase];
+        for (uint32_t source = 0; source < ALLOCATION_SOURCE_COUNT; source++)
+        {
+            PrintCounter(snapshot[phase][source]);
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "\tcallbacks (" << invocations << " invocations)";
+    for (uint32_t source = 0; source < ALLOCATION_SOURCE_COUNT; source++)
+    {
+        PrintCounter(callbackSnapshot[source]);
+    }
+    std::cout << std::endl;
+
+    if (0 != invocations)
+    {
+        std::cout << "\tper callback invocation";
+        for (uint32_t source = 0; source < ALLOCATION_SOURCE_COUNT; source++)
+        {
+            std::cout << "\t" << static_cast<double>(callbackSnapshot[source].count.load(std::memory_order_relaxed)) / invocations <<
+                " (" << static_cast<double>(callbackSnapshot[source].bytes.load(std::memory_order_relaxed)) / invocations << " B)";
+        }
+        std::cout << std::endl;
+    }
+
+    static const char *const scopeNames[] = { "command", "object", "cache", "device", "instance" };
+    std::cout << "\tVkAllocationCallbacks by scope:";
+    for (uint32_t scope = 0; scope <= VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE; scope++)
+    {
+        std::cout << " " << scopeNames[scope];
+        PrintCounter(scopeSnapshot[scope]);
+    }
+    std::cout << std::endl;
+
+    ResetAllocationCounts();
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <vector>
+
+// If this macro is set to "true" every allocation made during a RunComputeShader() call is
+// counted and reported when the call returns, split by source:
+//   - global operator new
+//   - malloc, through the debug CRT allocation hook (MSVC debug builds only)
+//   - VkAllocationCallbacks, passed to the device and to every object RunComputeShader creates
+//   - device memory, through VK_EXT_device_memory_report when the device supports it, which
+//     also sees the printf buffers the validation layer allocates
+// Each is split by the phase of RunComputeShader it happened in, and allocations made inside
+// the Vulkan callbacks are also reported per callback invocation.
+// The macro only compiles the hooks in, nothing is counted until InitializeAllocationTracking()
+// is called. The benchmark project defines it as "true", and only the callbacks benchmark calls
+// InitializeAllocationTracking(), so the other benchmarks are timed without the tracking.
+#ifndef ENABLE_ALLOCATION_TRACKING
+#define ENABLE_ALLOCATION_TRACKING false
+#endif
+
+#if ENABLE_ALLOCATION_TRACKING
+
+#define ALLOCATION_CONCATENATE_INNER(a, b) a##b
+#define ALLOCATION_CONCATENATE(a, b) ALLOCATION_CONCATENATE_INNER(a, b)
+
+// Attributes the allocations this thread makes from this line to the end of the enclosing scope to a phase
+#define ALLOCATION_PHASE_SCOPE(name) AllocationPhaseScope ALLOCATION_CONCATENATE(allocationPhaseScope, __LINE__)(name)
+
+// Attributes the allocations made by this thread until the end of the enclosing scope to a callback invocation
+#define ALLOCATION_CALLBACK_SCOPE() AllocationCallbackScope ALLOCATION_CONCATENATE(allocationCallbackScope, __LINE__)
+
+#else
+
+#define ALLOCATION_PHASE_SCOPE(name)
+#define ALLOCATION_CALLBACK_SCOPE()
+
+#endif
+
+enum AllocationSource
+{
+    ALLOCATION_SOURCE_OPERATOR_NEW,
+    ALLOCATION_SOURCE_MALLOC,
+    ALLOCATION_SOURCE_VULKAN_HOST,
+    ALLOCATION_SOURCE_DEVICE_MEMORY,
+    ALLOCATION_SOURCE_COUNT
+};
+
+// Returns the VkAllocationCallbacks to create and destroy Vulkan objects with,
+// which is nullptr (the driver's allocator) when allocation tracking is disabled
+const VkAllocationCallbacks *GetVulkanAllocator();
+
+// Starts counting and installs the malloc hook, where the C runtime supports one. Must be called
+// before any Vulkan object is created, as GetVulkanAllocator() changes with it.
+void InitializeAllocationTracking();
+
+// Whether the hooks are compiled in and InitializeAllocationTracking() was called
+bool IsAllocationTrackingEnabled();
+
+// Total operator new allocations since allocation tracking was initialized, on any thread
+uint64_t GetOperatorNewCount();
+
+void ResetAllocationCounts();
+void ReportAllocationCounts(uint32_t dispatchIndex);
+
+// Enables VK_EXT_device_memory_report on the device being created, when it is supported,
+// by chaining the structures in this object into the device create info
+struct DeviceMemoryReportChain
+{
+    std::vector<const char *> extensions;
+    VkPhysicalDeviceDeviceMemoryReportFeaturesEXT features = {};
+    VkDeviceDeviceMemoryReportCreateInfoEXT createInfo = {};
+};
+
+void AddDeviceMemoryReport(VkPhysicalDevice physicalDevice, VkDeviceCreateInfo &deviceCreateInfo, DeviceMemoryReportChain &chain);
+
+class AllocationPhaseScope
+{
+public:
+    explicit AllocationPhaseScope(const char *name);
+    ~AllocationPhaseScope();
+
+    AllocationPhaseScope(const AllocationPhaseScope &) = delete;
+    AllocationPhaseScope &operator=(const AllocationPhaseScope &) = delete;
+
+private:
+    uint32_t previousPhase;
+};
+
+class AllocationCallbackScope
+{
+public:
+    AllocationCallbackScope();
+    ~AllocationCallbackScope();
+
+    AllocationCallbackScope(const AllocationCallbackScope &) = delete;
+    AllocationCallbackScope &operator=(const AllocationCallbackScope &) = delete;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// Options shared by all the benchmarks, parsed from "--name=value" command line arguments
+struct BenchmarkOptions
+{
+    uint32_t iterations = 100;
+    uint32_t warmupIterations = 5;
+
+    // Selects the physical device whose name contains this string, for example "llvmpipe"
+    // to run on lavapipe. The first device is used when it is empty.
+    std::string deviceName;
+
+    std::string shaderPath = "GLSLComputeShader.comp.spv";
+
+    // Messages sent by each thread of the callback benchmark
+    uint32_t messages = 100000;
+
+    // Largest thread count of the callback benchmark and worker count of the jobs benchmark, 0 uses
+    // one thread per hardware thread
+    uint32_t threads = 0;
+
+    // Comma separated output sinks the callback benchmark redirects the callbacks to
+    std::string sinks = "null,memory,file,lz4";
+
+    // Comma separated message output formats of the callback benchmark, out of text, jsonl and summary
+    std::string formats = "text,jsonl,summary";
+
+    // Invocations of each scaling and pipelining benchmark dispatch, rounded up to whole workgroups
+    uint32_t invocations = 262144;
+
+    // Comma separated fractions of printing invocations the scaling benchmark sweeps
+    std::string fractions = "0,0.0001,0.001,0.01,0.1,0.25,0.5,1";
+
+    std::string csvPath = "printf_scaling.csv";
+
+    // Values formatted per iteration of the format benchmark
+    uint32_t values = 100000;
+
+    // Printf records sorted per iteration of the order benchmark
+    uint32_t records = 1024 * 1024;
+
+    // How long the soak benchmark dispatches for, and how often it prints its histograms (0 only at exit)
+    uint32_t soakSeconds = 60;
+    uint32_t reportIntervalSeconds = 10;
+
+    // Queues of the compute family the scheduler benchmark spreads its jobs over, 0 uses all of them
+    uint32_t queues = 0;
+
+    // Largest frame count the pipelining benchmark runs its dispatches over
+    uint32_t frames = 3;
+};
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+// Summary of a series of samples, all in the unit the samples were recorded in
+struct SampleStatistics
+{
+    double minimum = 0.0;
+    double median = 0.0;
+    double mean = 0.0;
+    double p99 = 0.0;
+    double maximum = 0.0;
+    double standardDeviation = 0.0;
+};
+
+// Records the time between its construction and destruction, in microseconds, into a sample series
+class PhaseTimer
+{
+public:
+    explicit PhaseTimer(std::vector<double> &samples) : samples(samples), start(BenchmarkClock::now()) {}
+
+    ~PhaseTimer()
+    {
+        samples.push_back(std::chrono::duration<double, std::micro>(BenchmarkClock::now() - start).count());
+    }
+
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+private:
+    std::vector<double> &samples;
+    BenchmarkClock::time_point start;
+};
+
+// A stream buffer that discards everything written to it, used to silence the
+// Vulkan callbacks while they are being benchmarked
+class NullStreamBuffer : public std::streambuf
+{
+protected:
+    int_type overflow(int_type character) override { return traits_type::not_eof(character); }
+    std::streamsize xsputn(const char *, std::streamsize count) override { return count; }
+};
+
+SampleStatistics ComputeSampleStatistics(std::vector<double> samples);
+void PrintStatisticsHeader(const char *unit);
+void PrintStatisticsRow(const char *name, const SampleStatistics &statistics);
+
+int RunPhaseBenchmark(const BenchmarkOptions &options);
+int RunCallbackBenchmark(const BenchmarkOptions &options);
+int RunScalingBenchmark(const BenchmarkOptions &options);
+int RunSoakBenchmark(const BenchmarkOptions &options);
+int RunFormatBenchmark(const BenchmarkOptions &options);
+int RunOrderBenchmark(const BenchmarkOptions &options);
+int RunJobsBenchmark(const BenchmarkOptions &options);
+int RunSchedulerBenchmark(const BenchmarkOptions &options);
+int RunPipeliningBenchmark(const BenchmarkOptions &options);
@@ -0,0 +1,202 @@
+#include "Benchmark.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Usage: VulkanPrintfBenchmark <benchmark> [--name=value ...]
+//
+// To run without a GPU, point the Vulkan loader at the lavapipe ICD of a Mesa build, e.g.
+//     set VK_DRIVER_FILES=C:\mesa\x64\lvp_icd.x86_64.json
+//     VulkanPrintfBenchmark phases --device=llvmpipe
+static void PrintUsage()
+{
+    fprintf(stderr,
+        "Usage: VulkanPrintfBenchmark <benchmark> [options]\n"
+        "\n"
+        "Benchmarks:\n"
+        "  phases              Times each step of the setup, dispatch and teardown path\n"
+        "  callbacks           Measures the throughput of the Vulkan callbacks with synthetic messages\n"
+        "  scaling             Sweeps the fraction of printing invocations for each printf backend\n"
+        "  soak                Dispatches repeatedly and prints latency histograms periodically\n"
+        "  format              Compares the integer and float formatting of the printf renderer with the standard library\n"
+        "  order               Sorts printf records by invocation with the radix sort of --order=invocation\n"
+        "  jobs                Measures the dispatch throughput of the job runner as its worker count doubles, and of the coroutine loop\n"
+        "  scheduler           Compares uneven jobs over the compute queues with and without work stealing\n"
+        "  pipelining          Compares repeated dispatches one at a time with dispatches pipelined over 2 to --frames frames\n"
+        "\n"
+        "Options:\n"
+        "  --iterations=N      Number of measured iterations (default 100)\n"
+        "  --warmup=N          Number of unmeasured iterations run first (default 5)\n"
+        "  --device=NAME       Use the first physical device whose name contains NAME\n"
+        "  --shader=PATH       SPIR-V shader to dispatch (default GLSLComputeShader.comp.spv)\n"
+        "  --messages=N        Messages sent by each callback benchmark thread (default 100000)\n"
+        "  --threads=N         Largest callback benchmark thread count and jobs benchmark worker count (default: hardware threads)\n"
+        "  --sinks=LIST        Callback output sinks out of null,memory,file,lz4,stdout (default null,memory,file,lz4)\n"
+        "  --formats=LIST      Callback output formats out of text,jsonl,summary (default text,jsonl,summary)\n"
+        "  --invocations=N     Invocations of each scaling and pipelining benchmark dispatch (default 262144)\n"
+        "  --fractions=LIST    Printing fractions the scaling benchmark sweeps (default 0,0.0001,0.001,0.01,0.1,0.25,0.5,1)\n"
+        "  --csv=PATH          Scaling benchmark output file (default printf_scaling.csv)\n"
+        "  --values=N          Values formatted per format benchmark iteration (default 100000)\n"
+        "  --records=N         Records sorted per order benchmark iteration (default 1048576)\n"
+        "  --duration=S        Seconds the soak benchmark runs for (default 60)\n"
+        "  --report-interval=S Seconds between soak benchmark histogram reports, 0 for only at exit (default 10)\n"
+        "  --queues=N          Compute queues the scheduler benchmark uses (default: all of the family)\n"
+        "  --frames=N          Largest frame count of the pipelining benchmark (default 3)\n");
+}
+
+// Returns the value of argument if it has the form "--name=value", otherwise nullptr
+static const char *GetOptionValue(const char *argument, const char *name)
+{
+    const size_t nameLength = strlen(name);
+    if (0 == strncmp(argument, name, nameLength) && '=' == argument[nameLength])
+    {
+        return argument + nameLength + 1;
+    }
+
+    return nullptr;
+}
+
+static bool ParseOptions(int argc, char **argv, BenchmarkOptions &options)
+{
+    for (int i = 2; i < argc; i++)
+    {
+        const char *value = nullptr;
+
+        if (nullptr != (value = GetOptionValue(argv[i], "--iterations")))
+        {
+            options.iterations = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--warmup")))
+        {
+            options.warmupIterations = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--device")))
+        {
+            options.deviceName = value;
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--shader")))
+        {
+            options.shaderPath = value;
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--messages")))
+        {
+            options.messages = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--threads")))
+        {
+            options.threads = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--sinks")))
+        {
+            options.sinks = value;
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--formats")))
+        {
+            options.formats = value;
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--invocations")))
+        {
+            options.invocations = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--fractions")))
+        {
+            options.fractions = value;
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--csv")))
+        {
+            options.csvPath = value;
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--values")))
+        {
+            options.values = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--records")))
+        {
+            options.records = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--duration")))
+        {
+            options.soakSeconds = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--report-interval")))
+        {
+            options.reportIntervalSeconds = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--queues")))
+        {
+            options.queues = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else if (nullptr != (value = GetOptionValue(argv[i], "--frames")))
+        {
+            options.frames = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return false;
+        }
+    }
+
+    return options.iterations > 0;
+}
+
+int main(int argc, char **argv)
+{
+    BenchmarkOptions options = {};
+    if (argc < 2 || !ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    const std::string benchmark = argv[1];
+
+    if ("phases" == benchmark)
+    {
+        return RunPhaseBenchmark(options);
+    }
+
+    if ("callbacks" == benchmark)
+    {
+        return RunCallbackBenchmark(options);
+    }
+
+    if ("scaling" == benchmark)
+    {
+        return RunScalingBenchmark(options);
+    }
+
+    if ("soak" == benchmark)
+    {
+        return RunSoakBenchmark(options);
+    }
+
+    if ("format" == benchmark)
+    {
+        return RunFormatBenchmark(options);
+    }
+
+    if ("order" == benchmark)
+    {
+        return RunOrderBenchmark(options);
+    }
+
+    if ("jobs" == benchmark)
+    {
+        return RunJobsBenchmark(options);
+    }
+
+    if ("scheduler" == benchmark)
+    {
+        return RunSchedulerBenchmark(options);
+    }
+
+    if ("pipelining" == benchmark)
+    {
+        return RunPipeliningBenchmark(options);
+    }
+
+    PrintUsage();
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,54 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// Computes the summary statistics of a series of samples
+// The percentiles use the nearest-rank method, so they are always one of the recorded samples
+SampleStatistics ComputeSampleStatistics(std::vector<double> samples)
+{
+    SampleStatistics statistics = {};
+    if (samples.empty())
+    {
+        return statistics;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    const size_t count = samples.size();
+    const size_t p99Rank = static_cast<size_t>(std::ceil(0.99 * static_cast<double>(count)));
+
+    statistics.minimum = samples.front();
+    statistics.maximum = samples.back();
+    statistics.median = (count % 2 == 1) ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+    statistics.p99 = samples[std::max<size_t>(p99Rank, 1) - 1];
+
+    double sum = 0.0;
+    for (double sample : samples)
+    {
+        sum += sample;
+    }
+    statistics.mean = sum / static_cast<double>(count);
+
+    double squaredDeviations = 0.0;
+    for (double sample : samples)
+    {
+        squaredDeviations += (sample - statistics.mean) * (sample - statistics.mean);
+    }
+    statistics.standardDeviation = count > 1 ? std::sqrt(squaredDeviations / static_cast<double>(count - 1)) : 0.0;
+
+    return statistics;
+}
+
+// Prints the column headings for PrintStatisticsRow
+void PrintStatisticsHeader(const char *unit)
+{
+    printf("%-32s %12s %12s %12s %12s %12s %12s   (%s)\n", "", "min", "median", "mean", "p99", "max", "stddev", unit);
+}
+
+// Prints one row of summary statistics
+void PrintStatisticsRow(const char *name, const SampleStatistics &statistics)
+{
+    printf("%-32s %12.3f %12.3f %12.3f %12.3f %12.3f %12.3f\n", name, statistics.minimum, statistics.median, statistics.mean,
+        statistics.p99, statistics.maximum, statistics.standardDeviation);
+}
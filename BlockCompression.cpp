@@ -0,0 +1,239 @@
+#include "BlockCompression.h"
+#include <cstring>
+
+// The format rules of LZ4 blocks: matches are at least 4 bytes, the last 5 bytes are always
+// literals, and no match starts in the last 12 bytes
+static const size_t min_match_length = 4;
+static const size_t last_literals = 5;
+static const size_t match_start_limit = 12;
+static const size_t max_match_offset = 65535;
+
+// The hash table has 4096 entries, 16 KB, small enough for the stack of any thread
+static const uint32_t hash_bits = 12;
+
+static inline uint32_t Read32(const uint8_t *position)
+{
+    uint32_t value = 0;
+    memcpy(&value, position, sizeof(value));
+    return value;
+}
+
+static inline uint32_t HashPrefix(uint32_t prefix)
+{
+    return (prefix * 2654435761u) >> (32 - hash_bits);
+}
+
+// Writes the remainder of a length that did not fit in its token nibble, as 255s and a final byte
+static inline uint8_t *WriteLength(uint8_t *output, size_t length)
+{
+    while (length >= 255)
+    {
+        *output++ = 255;
+        length -= 255;
+    }
+
+    *output++ = static_cast<uint8_t>(length);
+    return output;
+}
+
+// Writes one sequence of literals followed by a match, or only literals when matchLength is zero
+static inline uint8_t *WriteSequence(uint8_t *output, const uint8_t *literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+    uint8_t *const token = output++;
+
+    if (literalLength >= 15)
+    {
+        *token = 15 << 4;
+        output = WriteLength(output, literalLength - 15);
+    }
+    else
+    {
+        *token = static_cast<uint8_t>(literalLength << 4);
+    }
+
+    memcpy(output, literals, literalLength);
+    output += literalLength;
+
+    if (0 == matchLength)
+    {
+        return output;
+    }
+
+    *output++ = static_cast<uint8_t>(offset);
+    *output++ = static_cast<uint8_t>(offset >> 8);
+
+    const size_t extraLength = matchLength - min_match_length;
+    if (extraLength >= 15)
+    {
+        *token |= 15;
+        output = WriteLength(output, extraLength - 15);
+    }
+    else
+    {
+        *token |= static_cast<uint8_t>(extraLength);
+    }
+
+    return output;
+}
+
+size_t GetCompressBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t CompressBlock(const uint8_t *input, size_t size, uint8_t *output, size_t capacity)
+{
+    if (capacity < GetCompressBound(size))
+    {
+        return 0;
+    }
+
+    uint8_t *position = output;
+    const uint8_t *anchor = input;
+
+    if (size > match_start_limit)
+    {
+        uint32_t table[1 << hash_bits] = {};
+
+        const uint8_t *const matchEnd = input + size - last_literals;
+        const uint8_t *const searchEnd = input + size - match_start_limit;
+        const uint8_t *current = input + 1;
+
+        while (current < searchEnd)
+        {
+            const uint32_t prefix = Read32(current);
+            const uint32_t hash = HashPrefix(prefix);
+            const uint8_t *candidate = input + table[hash];
+            table[hash] = static_cast<uint32_t>(current - input);
+
+            const size_t offset = static_cast<size_t>(current - candidate);
+            if (0 == offset || offset > max_match_offset || Read32(candidate) != prefix)
+            {
+                // Runs without matches are skipped faster the longer they get, as LZ4 does
+                current += 1 + (static_cast<size_t>(current - anchor) >> 6);
+                continue;
+            }
+
+            // Extend the match backwards over the pending literals, then forwards
+            while (current > anchor && candidate > input && current[-1] == candidate[-1])
+            {
+                current--;
+                candidate--;
+            }
+
+            size_t matchLength = min_match_length;
+            while (current + matchLength < matchEnd && current[matchLength] == candidate[matchLength])
+            {
+                matchLength++;
+            }
+
+            position = WriteSequence(position, anchor, static_cast<size_t>(current - anchor), offset, matchLength);
+
+            current += matchLength;
+            anchor = current;
+
+            // The position just before the next search is hashed too, it often starts the next repeat
+            if (current < searchEnd)
+            {
+                table[HashPrefix(Read32(current - 2))] = static_cast<uint32_t>(current - 2 - input);
+            }
+        }
+    }
+
+    position = WriteSequence(position, anchor, static_cast<size_t>(input + size - anchor), 0, 0);
+
+    return static_cast<size_t>(position - output);
+}
+
+// Reads the remainder of a length whose token nibble was 15, returns false if it runs past the end
+static inline bool ReadLength(const uint8_t *&input, const uint8_t *end, size_t &length)
+{
+    uint8_t value = 0;
+    do
+    {
+        if (input == end)
+        {
+            return false;
+        }
+
+        value = *input++;
+        length += value;
+    } while (255 == value);
+
+    return true;
+}
+
+bool DecompressBlock(const uint8_t *input, size_t size, uint8_t *output, size_t outputSize)
+{
+    const uint8_t *const inputEnd = input + size;
+    uint8_t *position = output;
+    uint8_t *const outputEnd = output + outputSize;
+
+    while (input < inputEnd)
+    {
+        const uint8_t token = *input++;
+
+        size_t literalLength = token >> 4;
+        if (15 == literalLength && !ReadLength(input, inputEnd, literalLength))
+        {
+            return false;
+        }
+
+        if (literalLength > static_cast<size_t>(inputEnd - input) || literalLength > static_cast<size_t>(outputEnd - position))
+        {
+            return false;
+        }
+
+        memcpy(position, input, literalLength);
+        input += literalLength;
+        position += literalLength;
+
+        // The last sequence has only literals
+        if (input == inputEnd)
+        {
+            break;
+        }
+
+        if (inputEnd - input < 2)
+        {
+            return false;
+        }
+
+        const size_t offset = static_cast<size_t>(input[0]) | (static_cast<size_t>(input[1]) << 8);
+        input += 2;
+
+        if (0 == offset || offset > static_cast<size_t>(position - output))
+        {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+        if (15 == matchLength && !ReadLength(input, inputEnd, matchLength))
+        {
+            return false;
+        }
+        matchLength += min_match_length;
+
+        if (matchLength > static_cast<size_t>(outputEnd - position))
+        {
+            return false;
+        }
+
+        // A match may overlap the bytes it produces, repeating a short run, so it is copied forwards
+        const uint8_t *source = position - offset;
+        if (offset >= matchLength)
+        {
+            memcpy(position, source, matchLength);
+            position += matchLength;
+        }
+        else
+        {
+            for (size_t i = 0; i < matchLength; i++)
+            {
+                *position++ = *source++;
+            }
+        }
+    }
+
+    return position == outputEnd;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// A fast LZ77 block codec that writes the LZ4 block format: sequences of a token, literals, a
+// 16-bit match offset and the match length, with matches found through a hash table of the
+// last position of every 4 byte prefix. Each block is compressed on its own, so blocks can be
+// compressed and decompressed in parallel and in any order.
+
+// The most bytes CompressBlock writes for an input of size bytes
+size_t GetCompressBound(size_t size);
+
+// Compresses size bytes into output, which must have room for GetCompressBound(size) bytes
+// Returns the compressed size, or 0 when output is too small
+size_t CompressBlock(const uint8_t *input, size_t size, uint8_t *output, size_t capacity);
+
+// Decompresses a block that held exactly outputSize bytes, returns false if the block is corrupt
+bool DecompressBlock(const uint8_t *input, size_t size, uint8_t *output, size_t outputSize);
@@ -0,0 +1,414 @@
+#include "Benchmark.h"
+#include "VulkanCompute.h"
+#include "AllocationTracking.h"
+#include "CompressedLog.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+// A sink that appends everything into a fixed size buffer, wrapping around when it is full
+// Writers reserve their range with one atomic add, so several threads can write at once
+class MemoryStreamBuffer : public std::streambuf
+{
+public:
+    explicit MemoryStreamBuffer(size_t capacity) : buffer(capacity) {}
+
+protected:
+    int_type overflow(int_type character) override
+    {
+        if (!traits_type::eq_int_type(character, traits_type::eof()))
+        {
+            const char value = traits_type::to_char_type(character);
+            xsputn(&value, 1);
+        }
+
+        return traits_type::not_eof(character);
+    }
+
+    std::streamsize xsputn(const char *data, std::streamsize count) override
+    {
+        const size_t offset = writeOffset.fetch_add(static_cast<size_t>(count), std::memory_order_relaxed);
+        for (std::streamsize i = 0; i < count; i++)
+        {
+            buffer[(offset + static_cast<size_t>(i)) % buffer.size()] = data[i];
+        }
+
+        return count;
+    }
+
+private:
+    std::vector<char> buffer;
+    std::atomic<size_t> writeOffset{ 0 };
+};
+
+// A sink that writes to a file through the C runtime, whose FILE locking keeps each write whole
+class FileStreamBuffer : public std::streambuf
+{
+public:
+    explicit FileStreamBuffer(const char *filename) : file(fopen(filename, "wb")) {}
+
+    ~FileStreamBuffer()
+    {
+        if (nullptr != file)
+        {
+            fclose(file);
+        }
+    }
+
+    bool IsOpen() const { return nullptr != file; }
+
+protected:
+    int_type overflow(int_type character) override
+    {
+        if (!traits_type::eq_int_type(character, traits_type::eof()))
+        {
+            fputc(traits_type::to_char_type(character), file);
+        }
+
+        return traits_type::not_eof(character);
+    }
+
+    std::streamsize xsputn(const char *data, std::streamsize count) override
+    {
+        return static_cast<std::streamsize>(fwrite(data, 1, static_cast<size_t>(count), file));
+    }
+
+    int sync() override
+    {
+        return fflush(file);
+    }
+
+private:
+    FILE *file = nullptr;
+};
+
+// A synthetic callback payload, modelled on what the validation layer sends
+struct SyntheticMessage
+{
+    VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+    VkDebugUtilsMessageTypeFlagsEXT type;
+    VkDebugReportFlagsEXT reportFlags;
+    const char *messageIdName;
+    int32_t messageIdNumber;
+    std::string message;
+};
+
+// Builds the message mix used by the benchmark: mostly short debug printf messages, with some
+// performance warnings (which SHOW_ONLY_DEBUG_PRINTF_EXT_MESSAGES filters out) and long validation errors
+// The printf messages carry the correlation tag of a dispatch that is never captured, so
+// VulkanDebugCallback parses them fully but drops their records, as it does for late messages
+static std::vector<SyntheticMessage> CreateSyntheticMessages()
+{
+    std::vector<SyntheticMessage> messages;
+
+    for (int i = 0; i < 8; i++)
+    {
+        SyntheticMessage printfMessage = {};
+        printfMessage.severity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+        printfMessage.type = VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
+        printfMessage.reportFlags = VK_DEBUG_REPORT_INFORMATION_BIT_EXT;
+        printfMessage.messageIdName = "WARNING-DEBUG-PRINTF";
+        printfMessage.messageIdNumber = 0x76589099;
+        printfMessage.message = "Validation Information: [ WARNING-DEBUG-PRINTF ] Object 0: handle = 0x1f2a3b4c5d0, type = VK_OBJECT_TYPE_QUEUE; "
+            "| MessageID = 0x76589099 | [dispatch 1 invocation " + std::to_string(i * 1237) + "] GLSL GI ID X value is: " + std::to_string(i * 1237);
+        messages.push_back(printfMessage);
+    }
+
+    SyntheticMessage performanceMessage = {};
+    performanceMessage.severity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+    performanceMessage.type = VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+    performanceMessage.reportFlags = VK_DEBUG_REPORT_PERFORMANCE_WARNING_BIT_EXT;
+    performanceMessage.messageIdName = "BestPractices-vkCreateComputePipelines-compute-work-group-size";
+    performanceMessage.messageIdNumber = 0x2cb5d8a3;
+    performanceMessage.message = "Validation Performance Warning: [ BestPractices-vkCreateComputePipelines-compute-work-group-size ] "
+        "Object 0: handle = 0x1f2a3b4c5d0, type = VK_OBJECT_TYPE_DEVICE; | MessageID = 0x2cb5d8a3 | vkCreateComputePipelines(): "
+        "compute shader with work group dimensions (512, 1, 1), (512 threads total), has fewer threads than configured in a subgroup.";
+    messages.push_back(performanceMessage);
+
+    SyntheticMessage errorMessage = {};
+    errorMessage.severity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    errorMessage.type = VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
+    errorMessage.reportFlags = VK_DEBUG_REPORT_ERROR_BIT_EXT;
+    errorMessage.messageIdName = "VUID-vkCmdDispatch-None-08114";
+    errorMessage.messageIdNumber = 0x30b6e267;
+    errorMessage.message = "Validation Error: [ VUID-vkCmdDispatch-None-08114 ] Object 0: handle = 0x1f2a3b4c5d0, type = VK_OBJECT_TYPE_COMMAND_BUFFER; "
+        "Object 1: handle = 0xcb3ee80000000007, type = VK_OBJECT_TYPE_PIPELINE; | MessageID = 0x30b6e267 | vkCmdDispatch(): ";
+    while (errorMessage.message.size() < 1024)
+    {
+        errorMessage.message += "the descriptor set bound at set 0, binding 0 was never updated and is accessed by the bound compute pipeline. ";
+    }
+    messages.push_back(errorMessage);
+
+    return messages;
+}
+
+enum CallbackKind
+{
+    CALLBACK_DEBUG_UTILS,
+    CALLBACK_DEBUG_REPORT
+};
+
+// Sends messageCount messages through one of the callbacks, cycling through the synthetic messages
+static void SendMessages(CallbackKind callback, const std::vector<SyntheticMessage> &messages, uint32_t messageCount)
+{
+    VkDebugUtilsObjectNameInfoEXT object = {};
+    object.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+    object.objectType = VK_OBJECT_TYPE_QUEUE;
+    object.objectHandle = 0x1f2a3b4c5d0;
+
+    for (uint32_t i = 0; i < messageCount; i++)
+    {
+        const SyntheticMessage &message = messages[i % messages.size()];
+
+        if (CALLBACK_DEBUG_UTILS == callback)
+        {
+            VkDebugUtilsMessengerCallbackDataEXT callbackData = {};
+            callbackData.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CALLBACK_DATA_EXT;
+            callbackData.pMessageIdName = message.messageIdName;
+            callbackData.messageIdNumber = message.messageIdNumber;
+            callbackData.pMessage = message.message.c_str();
+            callbackData.objectCount = 1;
+            callbackData.pObjects = &object;
+
+            VulkanDebugCallback(message.severity, message.type, &callbackData, nullptr);
+        }
+        else
+        {
+            VulkanReportCallback(message.reportFlags, VK_DEBUG_REPORT_OBJECT_TYPE_QUEUE_EXT, object.objectHandle, 0,
+                message.messageIdNumber, "Validation", message.message.c_str(), nullptr);
+        }
+    }
+}
+
+// One of the --formats the callbacks write in. In summary order they decode the printf messages
+// and write only the other messages, as VulkanPrintf --aggregate does.
+struct CallbackOutput
+{
+    const char *name;
+    MessageOutputFormat format;
+    PrintfOutputOrder order;
+};
+
+// Sends messages through a callback from threadCount threads at once and prints the throughput
+static void RunCallbackThroughput(CallbackKind callback, const CallbackOutput &output, const char *sinkName, std::streambuf *sink,
+    uint32_t threadCount, const std::vector<SyntheticMessage> &messages, uint32_t messagesPerThread)
+{
+    std::streambuf *const coutStreamBuffer = std::cout.rdbuf(sink);
+    SetMessageOutputFormat(output.format);
+    SetPrintfOutputOrder(output.order);
+
+    std::atomic<bool> start(false);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back([&]()
+        {
+            while (!start.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+
+            SendMessages(callback, messages, messagesPerThread);
+        });
+    }
+
+    const uint64_t allocationsBefore = GetOperatorNewCount();
+    const BenchmarkClock::time_point startTime = BenchmarkClock::now();
+
+    start.store(true, std::memory_order_release);
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    // The lines still buffered, JSON Lines or collected text lines, count towards the run
+    FlushMessageOutput();
+
+    const double seconds = std::chrono::duration<double>(BenchmarkClock::now() - startTime).count();
+    const uint64_t allocations = GetOperatorNewCount() - allocationsBefore;
+
+    std::cout.flush();
+    std::cout.rdbuf(coutStreamBuffer);
+    SetMessageOutputFormat(MESSAGE_OUTPUT_TEXT);
+    SetPrintfOutputOrder(PRINTF_ORDER_ARRIVAL);
+
+    const double totalMessages = static_cast<double>(messagesPerThread) * threadCount;
+    printf("%-22s %-7s %-8s %8u %14.0f %12.1f %14.3f\n", CALLBACK_DEBUG_UTILS == callback ? "VulkanDebugCallback" : "VulkanReportCallback",
+        output.name, sinkName, threadCount, totalMessages / seconds, seconds * 1e9 / totalMessages, static_cast<double>(allocations) / totalMessages);
+}
+
+// Prints how well the lz4 sink compressed the callback output, and how fast the blocks
+// decompress with every thread reading its share of them
+static bool ReportCompressedLog(const char *path, uint64_t textSize, uint64_t fileSize, uint32_t threadCount)
+{
+    CompressedLogReader reader;
+    if (!reader.Open(path) || reader.GetTextSize() != textSize)
+    {
+        fprintf(stderr, "Cannot read back %s\n", path);
+        return false;
+    }
+
+    std::atomic<size_t> nextBlock(0);
+    std::atomic<bool> corrupt(false);
+
+    const BenchmarkClock::time_point startTime = BenchmarkClock::now();
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back([&]()
+        {
+            std::vector<uint8_t> block;
+            for (size_t b = nextBlock++; b < reader.GetBlockCount(); b = nextBlock++)
+            {
+                if (!reader.ReadBlock(b, block))
+                {
+                    corrupt = true;
+                }
+            }
+        });
+    }
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    const double seconds = std::chrono::duration<double>(BenchmarkClock::now() - startTime).count();
+
+    if (corrupt)
+    {
+        fprintf(stderr, "Corrupt block in %s\n", path);
+        return false;
+    }
+
+    printf("lz4 sink: %.1f MB of text in %.1f MB, ratio %.2f, %zu blocks decompressed at %.0f MB/s on %u threads\n",
+        textSize / 1e6, fileSize / 1e6, fileSize > 0 ? static_cast<double>(textSize) / fileSize : 0.0,
+        reader.GetBlockCount(), textSize / 1e6 / seconds, threadCount);
+
+    return true;
+}
+
+// Measures the host-side cost of the Vulkan callbacks alone, without a device or validation layer,
+// by calling them directly with synthetic messages for each output sink and thread count
+int RunCallbackBenchmark(const BenchmarkOptions &options)
+{
+    // The only benchmark that counts allocations, the others are timed without the hooks counting
+    InitializeAllocationTracking();
+
+    const std::vector<SyntheticMessage> messages = CreateSyntheticMessages();
+
+    uint32_t maximumThreads = options.threads;
+    if (0 == maximumThreads)
+    {
+        maximumThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<uint32_t> threadCounts = { 1 };
+    if (maximumThreads > 1)
+    {
+        threadCounts.push_back(maximumThreads);
+    }
+
+    NullStreamBuffer nullSink;
+    MemoryStreamBuffer memorySink(64 * 1024 * 1024);
+    FileStreamBuffer fileSink("callback_benchmark_output.txt");
+    std::streambuf *const stdoutSink = std::cout.rdbuf();
+
+    // The messages reach the lz4 sink as fast as they are copied into its block, it only slows
+    // the callbacks down once the compression thread falls behind by compressed_log_queue_depth blocks
+    static const char compressed_path[] = "callback_benchmark_output.vkpflz";
+    CompressedLogStreamBuffer compressedSink;
+
+    struct Sink
+    {
+        const char *name;
+        std::streambuf *streamBuffer;
+    };
+
+    std::vector<Sink> sinks;
+    std::stringstream sinkNames(options.sinks);
+    std::string sinkName;
+    while (std::getline(sinkNames, sinkName, ','))
+    {
+        if ("null" == sinkName)
+        {
+            sinks.push_back({ "null", &nullSink });
+        }
+        else if ("memory" == sinkName)
+        {
+            sinks.push_back({ "memory", &memorySink });
+        }
+        else if ("file" == sinkName && fileSink.IsOpen())
+        {
+            sinks.push_back({ "file", &fileSink });
+        }
+        else if ("lz4" == sinkName && compressedSink.Open(compressed_path))
+        {
+            sinks.push_back({ "lz4", &compressedSink });
+        }
+        else if ("stdout" == sinkName)
+        {
+            sinks.push_back({ "stdout", stdoutSink });
+        }
+        else
+        {
+            fprintf(stderr, "Unavailable sink: %s\n", sinkName.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<CallbackOutput> formats;
+    std::stringstream formatNames(options.formats);
+    std::string formatName;
+    while (std::getline(formatNames, formatName, ','))
+    {
+        if ("text" == formatName)
+        {
+            formats.push_back({ "text", MESSAGE_OUTPUT_TEXT, PRINTF_ORDER_ARRIVAL });
+        }
+        else if ("jsonl" == formatName)
+        {
+            formats.push_back({ "jsonl", MESSAGE_OUTPUT_JSONL, PRINTF_ORDER_ARRIVAL });
+        }
+        else if ("summary" == formatName)
+        {
+            formats.push_back({ "summary", MESSAGE_OUTPUT_TEXT, PRINTF_ORDER_SUMMARY });
+        }
+        else
+        {
+            fprintf(stderr, "Unknown output format: %s\n", formatName.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("Callback benchmark: %u messages per thread, %zu message kinds\n", options.messages, messages.size());
+    printf("%-22s %-7s %-8s %8s %14s %12s %14s\n", "callback", "format", "sink", "threads", "messages/sec", "ns/message", "allocs/message");
+
+    for (const CallbackOutput &format : formats)
+    {
+        for (const Sink &sink : sinks)
+        {
+            for (uint32_t threadCount : threadCounts)
+            {
+                RunCallbackThroughput(CALLBACK_DEBUG_UTILS, format, sink.name, sink.streamBuffer, threadCount, messages, options.messages);
+                RunCallbackThroughput(CALLBACK_DEBUG_REPORT, format, sink.name, sink.streamBuffer, threadCount, messages, options.messages);
+            }
+        }
+    }
+
+    if (compressedSink.IsOpen())
+    {
+        compressedSink.Close();
+        if (!ReportCompressedLog(compressed_path, compressedSink.GetTextSize(), compressedSink.GetFileSize(), maximumThreads))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
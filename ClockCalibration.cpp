@@ -0,0 +1,220 @@
+#include "ClockCalibration.h"
+#include "VulkanCompute.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+ClockCalibration clockCalibration;
+
+#ifdef _WIN32
+static const VkTimeDomainEXT host_time_domain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#else
+static const VkTimeDomainEXT host_time_domain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+
+int64_t GetHostNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Returns the length of one tick of the host time domain, in nanoseconds
+static double GetHostTicksToNanoseconds()
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency = {};
+    QueryPerformanceFrequency(&frequency);
+    return 1000000000.0 / static_cast<double>(frequency.QuadPart);
+#else
+    return 1.0;
+#endif
+}
+
+void GetCalibratedTimestampSupport(VkInstance instance, VkPhysicalDevice physicalDevice, QuerySupport &querySupport)
+{
+    querySupport.calibratedTimestampsExtension = nullptr;
+
+#if ENABLE_CALIBRATED_TIMESTAMPS
+    if (!querySupport.timestampsSupported)
+    {
+        return;
+    }
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    // The KHR extension is preferred, the EXT extension has the same entry points under other names
+    const char *extension = nullptr;
+    const char *getTimeDomainsName = nullptr;
+    for (const VkExtensionProperties &properties : availableExtensions)
+    {
+        if (0 == strcmp(VK_KHR_CALIBRATED_TIMESTAMPS_EXTENSION_NAME, properties.extensionName))
+        {
+            extension = VK_KHR_CALIBRATED_TIMESTAMPS_EXTENSION_NAME;
+            getTimeDomainsName = "vkGetPhysicalDeviceCalibrateableTimeDomainsKHR";
+            break;
+        }
+
+        if (0 == strcmp(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME, properties.extensionName))
+        {
+            extension = VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME;
+            getTimeDomainsName = "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT";
+        }
+    }
+
+    if (nullptr == extension)
+    {
+        return;
+    }
+
+    auto getTimeDomains = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)vkGetInstanceProcAddr(instance, getTimeDomainsName);
+    if (nullptr == getTimeDomains)
+    {
+        return;
+    }
+
+    uint32_t timeDomainCount = 0;
+    getTimeDomains(physicalDevice, &timeDomainCount, nullptr);
+
+    std::vector<VkTimeDomainEXT> timeDomains(timeDomainCount);
+    getTimeDomains(physicalDevice, &timeDomainCount, timeDomains.data());
+
+    bool deviceDomainFound = false;
+    bool hostDomainFound = false;
+    for (VkTimeDomainEXT timeDomain : timeDomains)
+    {
+        deviceDomainFound |= VK_TIME_DOMAIN_DEVICE_EXT == timeDomain;
+        hostDomainFound |= host_time_domain == timeDomain;
+    }
+
+    if (deviceDomainFound && hostDomainFound)
+    {
+        querySupport.calibratedTimestampsExtension = extension;
+    }
+#endif
+}
+
+VkResult ClockCalibration::Initialize(VkDevice device, const QuerySupport &querySupport)
+{
+    Reset();
+
+    if (nullptr == querySupport.calibratedTimestampsExtension)
+    {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    const bool khr = 0 == strcmp(VK_KHR_CALIBRATED_TIMESTAMPS_EXTENSION_NAME, querySupport.calibratedTimestampsExtension);
+    getCalibratedTimestamps = (PFN_vkGetCalibratedTimestampsEXT)vkGetDeviceProcAddr(device, khr ? "vkGetCalibratedTimestampsKHR" : "vkGetCalibratedTimestampsEXT");
+    if (nullptr == getCalibratedTimestamps)
+    {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    this->device = device;
+    hostTimeDomain = host_time_domain;
+    hostTicksToNanoseconds = GetHostTicksToNanoseconds();
+    nominalSlope = querySupport.timestampPeriod;
+    timestampMask = querySupport.timestampMask;
+    slope = nominalSlope;
+
+    return Sample();
+}
+
+void ClockCalibration::Reset()
+{
+    device = VK_NULL_HANDLE;
+    getCalibratedTimestamps = nullptr;
+    sampleCount = 0;
+    newestSample = 0;
+    slope = nominalSlope;
+}
+
+// Returns ticks - referenceTicks, allowing for the counter wrapping within timestampMask
+int64_t ClockCalibration::GetDeviceTickDelta(uint64_t ticks, uint64_t referenceTicks) const
+{
+    const uint64_t delta = (ticks - referenceTicks) & timestampMask;
+    const uint64_t half = (timestampMask >> 1) + 1;
+
+    return delta >= half ? static_cast<int64_t>(delta) - static_cast<int64_t>(timestampMask) - 1 : static_cast<int64_t>(delta);
+}
+
+VkResult ClockCalibration::Sample()
+{
+    if (nullptr == getCalibratedTimestamps)
+    {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    VkCalibratedTimestampInfoEXT timestampInfos[2] = {};
+    timestampInfos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    timestampInfos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    timestampInfos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    timestampInfos[1].timeDomain = hostTimeDomain;
+
+    uint64_t timestamps[2] = {};
+    uint64_t maxDeviation = 0;
+    const VkResult result = getCalibratedTimestamps(device, 2, timestampInfos, timestamps, &maxDeviation);
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
+    newestSample = 0 == sampleCount ? 0 : (newestSample + 1) % clock_calibration_samples;
+    sampleCount = sampleCount < clock_calibration_samples ? sampleCount + 1 : sampleCount;
+
+    ClockCalibrationSample &sample = samples[newestSample];
+    sample.deviceTicks = timestamps[0] & timestampMask;
+    sample.hostNanoseconds = static_cast<int64_t>(static_cast<double>(timestamps[1]) * hostTicksToNanoseconds);
+    sample.maxDeviation = maxDeviation;
+
+    // Least squares fit of the slope through the newest sample, the older samples being
+    // weighted down by their own uncertainty so one noisy reading does not skew the drift
+    const ClockCalibrationSample &reference = samples[newestSample];
+    double sumXY = 0.0;
+    double sumXX = 0.0;
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        if (i == newestSample)
+        {
+            continue;
+        }
+
+        const double x = static_cast<double>(GetDeviceTickDelta(samples[i].deviceTicks, reference.deviceTicks));
+        const double y = static_cast<double>(samples[i].hostNanoseconds - reference.hostNanoseconds);
+        const double weight = 1.0 / (1.0 + static_cast<double>(samples[i].maxDeviation + reference.maxDeviation));
+
+        sumXY += weight * x * y;
+        sumXX += weight * x * x;
+    }
+
+    slope = sumXX > 0.0 ? sumXY / sumXX : nominalSlope;
+
+    return VK_SUCCESS;
+}
+
+int64_t ClockCalibration::DeviceTicksToHostNanoseconds(uint64_t deviceTicks) const
+{
+    const ClockCalibrationSample &reference = samples[newestSample];
+    const double ticks = static_cast<double>(GetDeviceTickDelta(deviceTicks & timestampMask, reference.deviceTicks));
+
+    return reference.hostNanoseconds + static_cast<int64_t>(std::llround(slope * ticks));
+}
+
+double ClockCalibration::GetDriftPartsPerMillion() const
+{
+    return nominalSlope > 0.0 ? (slope / nominalSlope - 1.0) * 1000000.0 : 0.0;
+}
+
+uint64_t ClockCalibration::GetMaxDeviation() const
+{
+    return 0 != sampleCount ? samples[newestSample].maxDeviation : 0;
+}
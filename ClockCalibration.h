@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+
+struct QuerySupport;
+
+// If this macro is set to "true" and the device supports VK_KHR_calibrated_timestamps or
+// VK_EXT_calibrated_timestamps, paired device and host clock samples are taken after every
+// dispatch. They keep a drift model that places the GPU timestamps of each dispatch on the
+// host clock next to its submit, its printf messages arriving and the wait returning, which
+// shows whether the latency is in the shader, the layer's readback or the callbacks.
+#define ENABLE_CALIBRATED_TIMESTAMPS true
+
+// The number of most recent samples the drift model is fitted to
+static const uint32_t clock_calibration_samples = 16;
+
+// Returns the host clock the device timestamps are converted to, in nanoseconds.
+// This is std::chrono::steady_clock, which reads the same counter as the host time domain
+// the calibration uses (QueryPerformanceCounter on Windows, CLOCK_MONOTONIC elsewhere).
+int64_t GetHostNanoseconds();
+
+// Checks for the calibrated timestamps extensions and a host time domain they can sample
+// together with the device, and records them in querySupport for CreateDevice to enable
+void GetCalibratedTimestampSupport(VkInstance instance, VkPhysicalDevice physicalDevice, QuerySupport &querySupport);
+
+// A paired reading of the device timestamp counter and the host clock
+struct ClockCalibrationSample
+{
+    uint64_t deviceTicks = 0;
+    int64_t hostNanoseconds = 0;
+
+    // The largest possible difference between the two readings, in nanoseconds
+    uint64_t maxDeviation = 0;
+};
+
+// Converts device timestamps to the host clock with a linear model, host = reference + slope *
+// (ticks - reference ticks), fitted to the most recent samples so the drift between the clocks
+// is followed. Only one thread may use it at a time.
+class ClockCalibration
+{
+public:
+    // Returns VK_ERROR_EXTENSION_NOT_PRESENT when the device does not support calibration
+    VkResult Initialize(VkDevice device, const QuerySupport &querySupport);
+    void Reset();
+
+    // Takes a new sample and refits the model
+    VkResult Sample();
+
+    bool IsCalibrated() const { return 0 != sampleCount; }
+
+    int64_t DeviceTicksToHostNanoseconds(uint64_t deviceTicks) const;
+
+    // The measured rate of the device clock against timestampPeriod, in parts per million
+    double GetDriftPartsPerMillion() const;
+
+    // The maxDeviation of the newest sample
+    uint64_t GetMaxDeviation() const;
+
+private:
+    int64_t GetDeviceTickDelta(uint64_t ticks, uint64_t referenceTicks) const;
+
+    VkDevice device = VK_NULL_HANDLE;
+    PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps = nullptr;
+    VkTimeDomainEXT hostTimeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    double hostTicksToNanoseconds = 1.0;
+    double nominalSlope = 1.0;
+    uint64_t timestampMask = ~0ull;
+
+    ClockCalibrationSample samples[clock_calibration_samples];
+    uint32_t sampleCount = 0;
+    uint32_t newestSample = 0;
+    double slope = 1.0;
+};
+
+// The calibration of the device created by main(), used by ReportComputeDispatch
+extern ClockCalibration clockCalibration;
@@ -0,0 +1,324 @@
+#include "CompressedLog.h"
+#include "BlockCompression.h"
+#include "FileSeek.h"
+#include <algorithm>
+#include <cstring>
+
+CompressedLogStreamBuffer::~CompressedLogStreamBuffer()
+{
+    Close();
+}
+
+bool CompressedLogStreamBuffer::Open(const char *path)
+{
+    Close();
+
+    file = fopen(path, "wb");
+    if (nullptr == file)
+    {
+        return false;
+    }
+
+    CompressedLogHeader header = {};
+    memcpy(header.magic, compressed_log_magic, sizeof(header.magic));
+    header.version = compressed_log_version;
+    header.blockSize = compressed_log_block_size;
+    fwrite(&header, sizeof(header), 1, file);
+
+    currentBlock.reserve(compressed_log_block_size);
+    textSize = 0;
+    closing = false;
+    index.clear();
+    fileOffset = sizeof(header);
+    compressedTextOffset = 0;
+    compressedBlock.resize(GetCompressBound(compressed_log_block_size));
+
+    compressionThread = std::thread(&CompressedLogStreamBuffer::CompressBlocks, this);
+
+    return true;
+}
+
+void CompressedLogStreamBuffer::Close()
+{
+    if (nullptr == file)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (!currentBlock.empty())
+        {
+            SubmitBlock();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        closing = true;
+    }
+    queueChanged.notify_all();
+    compressionThread.join();
+
+    const uint64_t indexOffset = fileOffset;
+    fwrite(index.data(), sizeof(CompressedLogIndexEntry), index.size(), file);
+    fileOffset += index.size() * sizeof(CompressedLogIndexEntry);
+
+    CompressedLogFooter footer = {};
+    footer.indexOffset = indexOffset;
+    footer.blockCount = static_cast<uint32_t>(index.size());
+    footer.magic = compressed_log_index_magic;
+    fwrite(&footer, sizeof(footer), 1, file);
+    fileOffset += sizeof(footer);
+
+    fclose(file);
+    file = nullptr;
+
+    fullBlocks.clear();
+    emptyBlocks.clear();
+}
+
+CompressedLogStreamBuffer::int_type CompressedLogStreamBuffer::overflow(int_type character)
+{
+    if (traits_type::eq_int_type(character, traits_type::eof()))
+    {
+        return traits_type::not_eof(character);
+    }
+
+    const char value = traits_type::to_char_type(character);
+    return 1 == xsputn(&value, 1) ? character : traits_type::eof();
+}
+
+std::streamsize CompressedLogStreamBuffer::xsputn(const char *data, std::streamsize count)
+{
+    if (nullptr == file)
+    {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    size_t remaining = static_cast<size_t>(count);
+
+    while (remaining > 0)
+    {
+        const size_t room = compressed_log_block_size - currentBlock.size();
+        const size_t copied = std::min(room, remaining);
+
+        currentBlock.insert(currentBlock.end(), bytes, bytes + copied);
+        bytes += copied;
+        remaining -= copied;
+
+        if (currentBlock.size() == compressed_log_block_size)
+        {
+            SubmitBlock();
+        }
+    }
+
+    textSize += static_cast<uint64_t>(count);
+
+    return count;
+}
+
+void CompressedLogStreamBuffer::SubmitBlock()
+{
+    std::unique_lock<std::mutex> queueLock(queueMutex);
+
+    // The writers wait for the compression thread when it falls behind, rather than queueing without bound
+    queueChanged.wait(queueLock, [this] { return fullBlocks.size() < compressed_log_queue_depth; });
+
+    fullBlocks.push_back(std::move(currentBlock));
+
+    if (emptyBlocks.empty())
+    {
+        currentBlock = std::vector<uint8_t>();
+    }
+    else
+    {
+        currentBlock = std::move(emptyBlocks.back());
+        emptyBlocks.pop_back();
+    }
+
+    queueLock.unlock();
+    queueChanged.notify_all();
+
+    currentBlock.clear();
+    currentBlock.reserve(compressed_log_block_size);
+}
+
+void CompressedLogStreamBuffer::CompressBlocks()
+{
+    std::unique_lock<std::mutex> queueLock(queueMutex);
+
+    for (;;)
+    {
+        queueChanged.wait(queueLock, [this] { return closing || !fullBlocks.empty(); });
+
+        if (fullBlocks.empty())
+        {
+            return;
+        }
+
+        // The block stays at the front of the queue while it is compressed, so it counts toward the queue depth
+        std::vector<uint8_t> &block = fullBlocks.front();
+        queueLock.unlock();
+
+        size_t compressedSize = CompressBlock(block.data(), block.size(), compressedBlock.data(), compressedBlock.size());
+
+        CompressedLogBlockHeader header = {};
+        header.uncompressedSize = static_cast<uint32_t>(block.size());
+        const uint8_t *blockBytes = compressedBlock.data();
+
+        if (0 == compressedSize || compressedSize >= block.size())
+        {
+            compressedSize = block.size();
+            header.compressedSize = static_cast<uint32_t>(compressedSize) | compressed_log_stored_flag;
+            blockBytes = block.data();
+        }
+        else
+        {
+            header.compressedSize = static_cast<uint32_t>(compressedSize);
+        }
+
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(blockBytes, 1, compressedSize, file);
+
+        CompressedLogIndexEntry entry = {};
+        entry.fileOffset = fileOffset;
+        entry.textOffset = compressedTextOffset;
+        entry.compressedSize = static_cast<uint32_t>(compressedSize);
+        entry.uncompressedSize = header.uncompressedSize;
+        index.push_back(entry);
+
+        fileOffset += sizeof(header) + compressedSize;
+        compressedTextOffset += header.uncompressedSize;
+
+        queueLock.lock();
+        emptyBlocks.push_back(std::move(fullBlocks.front()));
+        fullBlocks.pop_front();
+        queueChanged.notify_all();
+    }
+}
+
+CompressedLogReader::~CompressedLogReader()
+{
+    Close();
+}
+
+bool CompressedLogReader::Open(const char *path)
+{
+    Close();
+
+    file = fopen(path, "rb");
+    if (nullptr == file)
+    {
+        return false;
+    }
+
+    CompressedLogHeader header = {};
+    CompressedLogFooter footer = {};
+
+    bool valid = 1 == fread(&header, sizeof(header), 1, file) &&
+        0 == memcmp(header.magic, compressed_log_magic, sizeof(header.magic)) &&
+        compressed_log_version == header.version &&
+        0 == SeekFile(file, 0, SEEK_END);
+
+    const uint64_t fileSize = valid ? TellFile(file) : 0;
+
+    valid = valid && fileSize >= sizeof(header) + sizeof(footer) &&
+        0 == SeekFile(file, fileSize - sizeof(footer), SEEK_SET) &&
+        1 == fread(&footer, sizeof(footer), 1, file) &&
+        compressed_log_index_magic == footer.magic &&
+        footer.indexOffset + static_cast<uint64_t>(footer.blockCount) * sizeof(CompressedLogIndexEntry) + sizeof(footer) == fileSize;
+
+    if (valid)
+    {
+        index.resize(footer.blockCount);
+        valid = 0 == SeekFile(file, footer.indexOffset, SEEK_SET) &&
+            index.size() == fread(index.data(), sizeof(CompressedLogIndexEntry), index.size(), file);
+    }
+
+    if (!valid)
+    {
+        Close();
+    }
+
+    return valid;
+}
+
+void CompressedLogReader::Close()
+{
+    if (nullptr != file)
+    {
+        fclose(file);
+        file = nullptr;
+    }
+
+    index.clear();
+}
+
+uint64_t CompressedLogReader::GetTextSize() const
+{
+    return index.empty() ? 0 : index.back().textOffset + index.back().uncompressedSize;
+}
+
+size_t CompressedLogReader::FindBlock(uint64_t textOffset) const
+{
+    // The first block that starts after the offset, the block before it holds the offset
+    const auto next = std::upper_bound(index.begin(), index.end(), textOffset,
+        [](uint64_t offset, const CompressedLogIndexEntry &entry) { return offset < entry.textOffset; });
+
+    if (next == index.begin() || textOffset >= GetTextSize())
+    {
+        return index.size();
+    }
+
+    return static_cast<size_t>(next - index.begin()) - 1;
+}
+
+bool CompressedLogReader::ReadBlock(size_t block, std::vector<uint8_t> &output)
+{
+    if (block >= index.size())
+    {
+        return false;
+    }
+
+    const CompressedLogIndexEntry &entry = index[block];
+
+    // Each reading thread keeps its buffer for the compressed bytes
+    thread_local std::vector<uint8_t> compressed;
+    compressed.resize(entry.compressedSize);
+
+    CompressedLogBlockHeader header = {};
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+
+        if (0 != SeekFile(file, entry.fileOffset, SEEK_SET) ||
+            1 != fread(&header, sizeof(header), 1, file) ||
+            compressed.size() != fread(compressed.data(), 1, compressed.size(), file))
+        {
+            return false;
+        }
+    }
+
+    if ((header.compressedSize & ~compressed_log_stored_flag) != entry.compressedSize || header.uncompressedSize != entry.uncompressedSize)
+    {
+        return false;
+    }
+
+    output.resize(entry.uncompressedSize);
+
+    if (0 != (header.compressedSize & compressed_log_stored_flag))
+    {
+        if (compressed.size() != output.size())
+        {
+            return false;
+        }
+
+        memcpy(output.data(), compressed.data(), compressed.size());
+        return true;
+    }
+
+    return DecompressBlock(compressed.data(), compressed.size(), output.data(), output.size());
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+// A compressed log file: the text written to a CompressedLogStreamBuffer is cut into blocks
+// of compressed_log_block_size bytes, which a background thread compresses with CompressBlock
+// (see BlockCompression.h) and appends to the file. Every block is independent, and the file
+// ends with an index of the blocks, so a CompressedLogReader can seek to any offset of the
+// text and decompress blocks in parallel.
+//
+// The file is a CompressedLogHeader, the blocks, each a CompressedLogBlockHeader followed by
+// its bytes, then one CompressedLogIndexEntry per block and a CompressedLogFooter. All values
+// are little-endian.
+
+static const uint32_t compressed_log_block_size = 1024 * 1024;
+
+// Full blocks waiting to be compressed before the writer blocks, which bounds the memory used
+static const uint32_t compressed_log_queue_depth = 4;
+
+static const char compressed_log_magic[8] = { 'V', 'K', 'P', 'F', 'L', 'Z', '1', '\0' };
+static const uint32_t compressed_log_version = 1;
+static const uint32_t compressed_log_index_magic = 0x58444e49; // "INDX"
+
+// Set in CompressedLogBlockHeader::compressedSize when the block is stored uncompressed, because compressing it did not make it smaller
+static const uint32_t compressed_log_stored_flag = 0x80000000u;
+
+struct CompressedLogHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t blockSize;
+};
+
+struct CompressedLogBlockHeader
+{
+    uint32_t compressedSize;
+    uint32_t uncompressedSize;
+};
+
+struct CompressedLogIndexEntry
+{
+    // Where the block header is in the file, and where the block's text starts in the whole text
+    uint64_t fileOffset;
+    uint64_t textOffset;
+    uint32_t compressedSize;
+    uint32_t uncompressedSize;
+};
+
+struct CompressedLogFooter
+{
+    uint64_t indexOffset;
+    uint32_t blockCount;
+    uint32_t magic;
+};
+
+static_assert(16 == sizeof(CompressedLogHeader), "The header is part of the file format");
+static_assert(8 == sizeof(CompressedLogBlockHeader), "The block header is part of the file format");
+static_assert(24 == sizeof(CompressedLogIndexEntry), "The index entry is part of the file format");
+static_assert(16 == sizeof(CompressedLogFooter), "The footer is part of the file format");
+
+// A stream buffer that writes a compressed log file, std::cout can be redirected to it.
+// Writes from several threads are serialized. sync() does not cut a block, the text reaches
+// the file when its block fills up or when the buffer is closed.
+class CompressedLogStreamBuffer : public std::streambuf
+{
+public:
+    ~CompressedLogStreamBuffer();
+
+    bool Open(const char *path);
+
+    // Compresses the last partial block and writes the index
+    void Close();
+
+    bool IsOpen() const { return nullptr != file; }
+
+    // The size of the text and of the file, once the buffer is closed
+    uint64_t GetTextSize() const { return textSize; }
+    uint64_t GetFileSize() const { return fileOffset; }
+
+protected:
+    int_type overflow(int_type character) override;
+    std::streamsize xsputn(const char *data, std::streamsize count) override;
+
+private:
+    // Hands the filling block to the compression thread and takes an empty one, writeMutex must be held
+    void SubmitBlock();
+    void CompressBlocks();
+
+    FILE *file = nullptr;
+
+    // Held by writers while they fill the current block
+    std::mutex writeMutex;
+    std::vector<uint8_t> currentBlock;
+    uint64_t textSize = 0;
+
+    // The blocks waiting for the compression thread, and the emptied ones it hands back
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    std::deque<std::vector<uint8_t>> fullBlocks;
+    std::vector<std::vector<uint8_t>> emptyBlocks;
+    bool closing = false;
+    std::thread compressionThread;
+
+    // Only used by the compression thread until it is joined
+    std::vector<CompressedLogIndexEntry> index;
+    uint64_t fileOffset = 0;
+    uint64_t compressedTextOffset = 0;
+    std::vector<uint8_t> compressedBlock;
+};
+
+// Reads a compressed log file. Several threads may call ReadBlock at once, the file reads are
+// serialized and the decompression runs in parallel.
+class CompressedLogReader
+{
+public:
+    ~CompressedLogReader();
+
+    bool Open(const char *path);
+    void Close();
+
+    size_t GetBlockCount() const { return index.size(); }
+    uint64_t GetTextSize() const;
+    const CompressedLogIndexEntry &GetBlock(size_t block) const { return index[block]; }
+
+    // Returns the block that holds the byte at textOffset of the text, or GetBlockCount() past the end
+    size_t FindBlock(uint64_t textOffset) const;
+
+    // Decompresses one block into output, returns false if the file is corrupt
+    bool ReadBlock(size_t block, std::vector<uint8_t> &output);
+
+private:
+    FILE *file = nullptr;
+    std::mutex fileMutex;
+    std::vector<CompressedLogIndexEntry> index;
+};
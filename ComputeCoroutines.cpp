@@ -0,0 +1,244 @@
+#include "ComputeCoroutines.h"
+#include "AllocationTracking.h"
+#include "Tracing.h"
+
+DispatchTask::~DispatchTask()
+{
+    if (handle)
+    {
+        handle.destroy();
+    }
+}
+
+void DispatchAwaitable::await_suspend(std::coroutine_handle<> handle)
+{
+    awaiting = handle;
+    loop.Enqueue(*this);
+}
+
+DispatchEventLoop::~DispatchEventLoop()
+{
+    Destroy();
+}
+
+VkResult DispatchEventLoop::Initialize(const ComputeQueueTarget &target)
+{
+    context.device = target.device;
+    context.queueFamilyIndex = target.queueFamilyIndex;
+    context.queueIndex = target.queueIndex;
+    context.querySupport = target.querySupport;
+    context.queueMutex = &queueMutex;
+
+    const VkResult result = CreateComputeJobContext(context);
+
+    // Each dispatch in flight has a fence of its own, taken from freeFences
+    vkDestroyFence(context.device, context.fence, GetVulkanAllocator());
+    context.fence = VK_NULL_HANDLE;
+
+    return result;
+}
+
+void DispatchEventLoop::Destroy()
+{
+    if (VK_NULL_HANDLE == context.device)
+    {
+        return;
+    }
+
+    if (!inFlight.empty())
+    {
+        VkQueue queue = VK_NULL_HANDLE;
+        vkGetDeviceQueue(context.device, context.queueFamilyIndex, context.queueIndex, &queue);
+        vkQueueWaitIdle(queue);
+
+        for (DispatchAwaitable *awaitable : inFlight)
+        {
+            DestroyComputeDispatch(context.device, awaitable->dispatch);
+            ReleaseJobDispatchIndex(awaitable->result.dispatchIndex);
+            freeFences.push_back(awaitable->fence);
+        }
+    }
+
+    // The awaitables live in the frames, so the frames go last
+    for (void *address : tasks)
+    {
+        std::coroutine_handle<>::from_address(address).destroy();
+    }
+
+    for (VkFence fence : freeFences)
+    {
+        vkDestroyFence(context.device, fence, GetVulkanAllocator());
+    }
+
+    DestroyComputeJobContext(context);
+
+    ready.clear();
+    waiting.clear();
+    inFlight.clear();
+    inFlightFences.clear();
+    tasks.clear();
+    freeFences.clear();
+    context.device = VK_NULL_HANDLE;
+}
+
+void DispatchEventLoop::Spawn(DispatchTask &&task)
+{
+    const std::coroutine_handle<> handle = task.Release();
+
+    tasks.insert(handle.address());
+    ready.push_back(handle);
+}
+
+void DispatchEventLoop::Enqueue(DispatchAwaitable &awaitable)
+{
+    // Dispatches start in the order they were awaited
+    if (!waiting.empty() || !StartDispatch(awaitable, false))
+    {
+        waiting.push_back(&awaitable);
+    }
+}
+
+bool DispatchEventLoop::StartDispatch(DispatchAwaitable &awaitable, bool block)
+{
+    uint32_t dispatchIndex = 0;
+    if (block)
+    {
+        dispatchIndex = AcquireJobDispatchIndex();
+    }
+    else if (!TryAcquireJobDispatchIndex(dispatchIndex))
+    {
+        return false;
+    }
+
+    awaitable.result.dispatchIndex = dispatchIndex;
+
+    VkResult result = VK_SUCCESS;
+    if (!freeFences.empty())
+    {
+        awaitable.fence = freeFences.back();
+        freeFences.pop_back();
+    }
+    else
+    {
+        VkFenceCreateInfo fenceCreateInfo = {};
+        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        result = vkCreateFence(context.device, &fenceCreateInfo, GetVulkanAllocator(), &awaitable.fence);
+    }
+
+    if (VK_SUCCESS == result)
+    {
+        ComputeJobContext dispatchContext = context;
+        dispatchContext.fence = awaitable.fence;
+
+        result = SubmitComputeJob(dispatchContext, awaitable.job, dispatchIndex, awaitable.dispatch);
+    }
+
+    if (VK_SUCCESS != result)
+    {
+        CompleteDispatch(awaitable, result);
+        return true;
+    }
+
+    inFlight.push_back(&awaitable);
+    inFlightFences.push_back(awaitable.fence);
+
+    return true;
+}
+
+void DispatchEventLoop::CompleteDispatch(DispatchAwaitable &awaitable, VkResult result)
+{
+    ComputeJobContext dispatchContext = context;
+    dispatchContext.fence = awaitable.fence;
+
+    awaitable.result.result = FinishComputeJob(dispatchContext, awaitable.dispatch, result, &awaitable.result.printfRecords);
+    ReleaseJobDispatchIndex(awaitable.result.dispatchIndex);
+
+    if (VK_NULL_HANDLE != awaitable.fence)
+    {
+        freeFences.push_back(awaitable.fence);
+        awaitable.fence = VK_NULL_HANDLE;
+    }
+
+    if (VK_SUCCESS != awaitable.result.result && VK_SUCCESS == firstError)
+    {
+        firstError = awaitable.result.result;
+    }
+
+    ready.push_back(awaitable.awaiting);
+}
+
+VkResult DispatchEventLoop::WaitForDispatches()
+{
+    TRACE_SCOPE("wait any");
+
+    const VkResult result = vkWaitForFences(context.device, static_cast<uint32_t>(inFlightFences.size()), inFlightFences.data(), VK_FALSE, UINT64_MAX);
+    if (VK_SUCCESS != result)
+    {
+        return result;
+    }
+
+    // Several fences may have signalled by now, the order of completion does not matter
+    for (size_t i = inFlight.size(); i-- > 0;)
+    {
+        if (VK_SUCCESS != vkGetFenceStatus(context.device, inFlightFences[i]))
+        {
+            continue;
+        }
+
+        DispatchAwaitable &awaitable = *inFlight[i];
+
+        inFlight[i] = inFlight.back();
+        inFlight.pop_back();
+        inFlightFences[i] = inFlightFences.back();
+        inFlightFences.pop_back();
+
+        CompleteDispatch(awaitable, VK_SUCCESS);
+    }
+
+    return VK_SUCCESS;
+}
+
+VkResult DispatchEventLoop::Run()
+{
+    while (!ready.empty() || !waiting.empty() || !inFlight.empty())
+    {
+        while (!ready.empty())
+        {
+            const std::coroutine_handle<> handle = ready.front();
+            ready.pop_front();
+
+            handle.resume();
+            if (handle.done())
+            {
+                tasks.erase(handle.address());
+                handle.destroy();
+            }
+        }
+
+        while (!waiting.empty() && StartDispatch(*waiting.front(), false))
+        {
+            waiting.pop_front();
+        }
+
+        if (!inFlight.empty())
+        {
+            const VkResult result = WaitForDispatches();
+            if (VK_SUCCESS != result)
+            {
+                return result;
+            }
+        }
+        else if (!waiting.empty())
+        {
+            // Other threads hold every capture slot, nothing of the loop's own will free one
+            StartDispatch(*waiting.front(), true);
+            waiting.pop_front();
+        }
+    }
+
+    const VkResult result = firstError;
+    firstError = VK_SUCCESS;
+
+    return result;
+}
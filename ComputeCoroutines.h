@@ -0,0 +1,144 @@
+#pragma once
+
+#include "ComputeScheduler.h"
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Dispatches that C++20 coroutines co_await. A coroutine asks a DispatchEventLoop for a dispatch,
+// and co_await submits it and suspends the coroutine until its fence signals. The coroutine is then
+// resumed with the printf records of the dispatch, once ReportComputeDispatch has reported them.
+//
+// The loop is single threaded. The coroutines, the submissions, the fence waits and the reports
+// all run on the thread that calls DispatchEventLoop::Run, which waits on the fences of every
+// dispatch in flight at once, so a single thread keeps many dispatches in flight without blocking
+// on any one of them. The dispatch indices and reports follow ComputeJobs.h, so a loop may run
+// alongside the runners and schedulers of the process, as long as it is the only one to submit to
+// its queue.
+
+// What co_await of a dispatch gives back
+struct DispatchResult
+{
+    VkResult result = VK_SUCCESS;
+    uint32_t dispatchIndex = 0;
+
+    // The printf records of the dispatch in arrival order, empty when the dispatch failed
+    std::vector<PrintfRecord> printfRecords;
+};
+
+// A coroutine the loop runs. It starts on the next DispatchEventLoop::Run after it is spawned, and
+// the loop destroys it once it returns. Exceptions must not leave it.
+class DispatchTask
+{
+public:
+    struct promise_type
+    {
+        DispatchTask get_return_object() { return DispatchTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    DispatchTask(DispatchTask &&other) noexcept : handle(std::exchange(other.handle, {})) {}
+    DispatchTask(const DispatchTask &) = delete;
+    DispatchTask &operator=(const DispatchTask &) = delete;
+    ~DispatchTask();
+
+    // Hands the coroutine over to whoever destroys it from then on
+    std::coroutine_handle<> Release() { return std::exchange(handle, {}); }
+
+private:
+    explicit DispatchTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+class DispatchEventLoop;
+
+// The awaitable of one dispatch, which lives in the frame of the coroutine awaiting it
+class DispatchAwaitable
+{
+public:
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle);
+    DispatchResult await_resume() { return std::move(result); }
+
+private:
+    friend class DispatchEventLoop;
+
+    DispatchAwaitable(DispatchEventLoop &loop, const ComputeJob &job) : loop(loop), job(job) {}
+
+    DispatchEventLoop &loop;
+    ComputeJob job;
+
+    std::coroutine_handle<> awaiting;
+    ComputeDispatch dispatch = {};
+    VkFence fence = VK_NULL_HANDLE;
+    DispatchResult result;
+};
+
+class DispatchEventLoop
+{
+public:
+    ~DispatchEventLoop();
+
+    // Creates the command pool of the loop for a queue, which only the loop may submit to
+    VkResult Initialize(const ComputeQueueTarget &target);
+
+    // Waits for the dispatches still in flight, destroys the coroutines that have not returned,
+    // and destroys the command pool and fences
+    void Destroy();
+
+    // Hands a coroutine to the loop, which starts it on the next Run
+    void Spawn(DispatchTask &&task);
+
+    // Returns the awaitable of a dispatch of the job, which is submitted when it is awaited. The
+    // shader code of the job must outlive the dispatch.
+    DispatchAwaitable Dispatch(const ComputeJob &job) { return DispatchAwaitable(*this, job); }
+
+    // Runs the coroutines until every one has returned, and returns the first error of the
+    // dispatches they awaited, or the error that a fence wait failed with, which stops the loop
+    VkResult Run();
+
+private:
+    friend class DispatchAwaitable;
+
+    // Starts the dispatch of a coroutine that awaits one, or queues it until a capture slot is free
+    void Enqueue(DispatchAwaitable &awaitable);
+
+    // Submits a dispatch, returns false without submitting when block is false and every capture
+    // slot is in flight
+    bool StartDispatch(DispatchAwaitable &awaitable, bool block);
+
+    // Reports a dispatch whose fence has signalled, or that failed to submit, and readies its coroutine
+    void CompleteDispatch(DispatchAwaitable &awaitable, VkResult result);
+
+    // Waits for any dispatch in flight to complete, and completes every one that has
+    VkResult WaitForDispatches();
+
+    ComputeJobContext context;
+
+    // The fences of the dispatches no longer in flight, for the next ones to reuse
+    std::vector<VkFence> freeFences;
+
+    // The coroutines to resume, those waiting for a capture slot, and those whose dispatch is in
+    // flight along with its fence
+    std::deque<std::coroutine_handle<>> ready;
+    std::deque<DispatchAwaitable *> waiting;
+    std::vector<DispatchAwaitable *> inFlight;
+    std::vector<VkFence> inFlightFences;
+
+    // Every coroutine spawned that has not returned, by address
+    std::unordered_set<void *> tasks;
+
+    VkResult firstError = VK_SUCCESS;
+
+    // Nothing else submits to the queue, only ComputeJobContext asks for the lock
+    std::mutex queueMutex;
+};
@@ -0,0 +1,285 @@
+#include "ComputeJobs.h"
+#include "AllocationTracking.h"
+#include "Tracing.h"
+#include <algorithm>
+#include <cstring>
+
+// The capture slots of the jobs in flight, across all the runners and schedulers
+static std::mutex slotMutex;
+static std::condition_variable slotReleased;
+static bool slotsInFlight[printf_capture_slots] = {};
+static uint32_t slotsInFlightCount = 0;
+
+// Serializes the ReportComputeDispatch calls of every job, see VulkanCompute.h
+static std::mutex reportMutex;
+
+VkResult CreateComputeJobContext(ComputeJobContext &context)
+{
+    VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = context.queueFamilyIndex;
+
+    VkResult result = vkCreateCommandPool(context.device, &commandPoolCreateInfo, GetVulkanAllocator(), &context.commandPool);
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
+    VkFenceCreateInfo fenceCreateInfo = {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    return vkCreateFence(context.device, &fenceCreateInfo, GetVulkanAllocator(), &context.fence);
+}
+
+void DestroyComputeJobContext(ComputeJobContext &context)
+{
+    vkDestroyFence(context.device, context.fence, GetVulkanAllocator());
+    vkDestroyCommandPool(context.device, context.commandPool, GetVulkanAllocator());
+
+    context.fence = VK_NULL_HANDLE;
+    context.commandPool = VK_NULL_HANDLE;
+}
+
+// Allocates dispatch indices until one falls on a free slot, and marks it in flight. slotMutex
+// must be held and a slot must be free.
+static uint32_t ReserveFreeSlot()
+{
+    uint32_t dispatchIndex = AllocateDispatchIndex();
+    while (slotsInFlight[dispatchIndex % printf_capture_slots])
+    {
+        dispatchIndex = AllocateDispatchIndex();
+    }
+
+    slotsInFlight[dispatchIndex % printf_capture_slots] = true;
+    slotsInFlightCount++;
+
+    return dispatchIndex;
+}
+
+uint32_t AcquireJobDispatchIndex()
+{
+    std::unique_lock<std::mutex> lock(slotMutex);
+    slotReleased.wait(lock, [] { return slotsInFlightCount < printf_capture_slots; });
+
+    return ReserveFreeSlot();
+}
+
+bool TryAcquireJobDispatchIndex(uint32_t &dispatchIndex)
+{
+    std::lock_guard<std::mutex> lock(slotMutex);
+    if (slotsInFlightCount >= printf_capture_slots)
+    {
+        return false;
+    }
+
+    dispatchIndex = ReserveFreeSlot();
+
+    return true;
+}
+
+void ReleaseJobDispatchIndex(uint32_t dispatchIndex)
+{
+    {
+        std::lock_guard<std::mutex> lock(slotMutex);
+        slotsInFlight[dispatchIndex % printf_capture_slots] = false;
+        slotsInFlightCount--;
+    }
+
+    slotReleased.notify_one();
+}
+
+VkResult SubmitComputeJob(const ComputeJobContext &context, const ComputeJob &job, uint32_t dispatchIndex, ComputeDispatch &dispatch)
+{
+    dispatch = {};
+    dispatch.dispatchIndex = dispatchIndex;
+    dispatch.groupCountX = job.groupCountX;
+    dispatch.pushConstantSize = job.pushConstantSize;
+    memcpy(dispatch.pushConstants, job.pushConstants, sizeof(dispatch.pushConstants));
+    dispatch.sharedCommandPool = context.commandPool;
+    dispatch.fence = context.fence;
+    dispatch.queueMutex = context.queueMutex;
+    dispatch.queueIndex = context.queueIndex;
+
+    VkResult result = CreateComputeShaderModule(context.device, *job.shaderCode, dispatch);
+
+    if (VK_SUCCESS == result)
+    {
+        result = CreateComputePipeline(context.device, dispatch);
+    }
+
+    if (VK_SUCCESS == result)
+    {
+        result = RecordComputeDispatch(context.device, context.queueFamilyIndex, context.querySupport, dispatch);
+    }
+
+    if (VK_SUCCESS == result)
+    {
+        result = SubmitComputeDispatch(context.device, context.queueFamilyIndex, dispatch);
+    }
+
+    return result;
+}
+
+VkResult ReportComputeJob(const ComputeJobContext &context, const ComputeDispatch &dispatch, std::vector<PrintfRecord> *printfRecords)
+{
+    std::lock_guard<std::mutex> lock(reportMutex);
+    return ReportComputeDispatch(context.device, context.querySupport, dispatch, printfRecords);
+}
+
+VkResult FinishComputeJob(const ComputeJobContext &context, ComputeDispatch &dispatch, VkResult result, std::vector<PrintfRecord> *printfRecords)
+{
+    if (VK_SUCCESS == result)
+    {
+        result = WaitForComputeDispatch(context.device, dispatch);
+    }
+
+    if (VK_SUCCESS == result)
+    {
+        result = ReportComputeJob(context, dispatch, printfRecords);
+    }
+
+    // A submission that failed to complete may still be using the command buffer
+    if (VK_SUCCESS != result && VK_NULL_HANDLE != dispatch.queue)
+    {
+        std::lock_guard<std::mutex> lock(*context.queueMutex);
+        vkQueueWaitIdle(dispatch.queue);
+    }
+
+    DestroyComputeDispatch(context.device, dispatch);
+
+    return result;
+}
+
+VkResult RunComputeJob(const ComputeJobContext &context, const ComputeJob &job, uint32_t dispatchIndex)
+{
+    TRACE_SCOPE("job");
+
+    ComputeDispatch dispatch = {};
+    const VkResult result = SubmitComputeJob(context, job, dispatchIndex, dispatch);
+
+    return FinishComputeJob(context, dispatch, result);
+}
+
+ComputeJobRunner::~ComputeJobRunner()
+{
+    Stop();
+}
+
+VkResult ComputeJobRunner::Start(VkDevice device, uint32_t queueFamilyIndex, const QuerySupport &querySupport, uint32_t workerCount)
+{
+    if (0 == workerCount)
+    {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workerCount = std::min(workerCount, printf_capture_slots);
+
+    // The pools and fences are all created before any worker starts, so a failure leaves nothing running
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back();
+        ComputeJobContext &context = workers.back().context;
+        context.device = device;
+        context.queueFamilyIndex = queueFamilyIndex;
+        context.querySupport = querySupport;
+        context.queueMutex = &queueMutex;
+
+        const VkResult result = CreateComputeJobContext(context);
+        if (result != VK_SUCCESS)
+        {
+            Stop();
+            return result;
+        }
+    }
+
+    for (Worker &worker : workers)
+    {
+        worker.thread = std::thread(&ComputeJobRunner::RunWorker, this, std::ref(worker));
+    }
+
+    return VK_SUCCESS;
+}
+
+void ComputeJobRunner::Submit(const ComputeJob &job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(job);
+        jobsInFlight++;
+    }
+
+    jobAvailable.notify_one();
+}
+
+VkResult ComputeJobRunner::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    jobsCompleted.wait(lock, [this] { return 0 == jobsInFlight; });
+
+    const VkResult result = firstError;
+    firstError = VK_SUCCESS;
+
+    return result;
+}
+
+void ComputeJobRunner::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    jobAvailable.notify_all();
+
+    for (Worker &worker : workers)
+    {
+        if (worker.thread.joinable())
+        {
+            worker.thread.join();
+        }
+
+        DestroyComputeJobContext(worker.context);
+    }
+
+    workers.clear();
+    stopping = false;
+}
+
+void ComputeJobRunner::RunWorker(Worker &worker)
+{
+    for (;;)
+    {
+        ComputeJob job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+            if (jobs.empty())
+            {
+                return;
+            }
+
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        const uint32_t dispatchIndex = AcquireJobDispatchIndex();
+        const VkResult result = RunComputeJob(worker.context, job, dispatchIndex);
+        ReleaseJobDispatchIndex(dispatchIndex);
+
+        bool idle = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (VK_SUCCESS != result && VK_SUCCESS == firstError)
+            {
+                firstError = result;
+            }
+            idle = 0 == --jobsInFlight;
+        }
+
+        if (idle)
+        {
+            jobsCompleted.notify_all();
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "VulkanCompute.h"
+#include "PrintfRecord.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs many independent dispatches on a pool of worker threads that share one VkDevice and one
+// queue. Each worker has its own command pool and fence, so recording and waiting need no locks
+// between workers. The queue is shared, and every vkQueueSubmit holds the runner's queue mutex,
+// since Vulkan requires a queue to be externally synchronized.
+//
+// Every job gets a dispatch index, its printf correlation id, when a worker takes it. The printf
+// records are captured in printf_capture_slots slots by correlation id, so no two jobs in flight
+// use the same slot, which also caps the worker count at printf_capture_slots.
+// ReportComputeDispatch writes to shared outputs, and is called by one job at a time.
+
+// One dispatch of a job runner. The runner does not copy the shader code, which must outlive the job.
+struct ComputeJob
+{
+    const std::vector<uint32_t> *shaderCode = nullptr;
+
+    // The workgroups dispatched in X, shader_local_size_x when left at zero
+    uint32_t groupCountX = 0;
+
+    // Push constants that follow the correlation id
+    uint32_t pushConstants[4] = {};
+    uint32_t pushConstantSize = 0;
+};
+
+// What a job runs with: the queue it submits to, and the command pool and fence of the thread
+// running it, which only that thread may use
+struct ComputeJobContext
+{
+    VkDevice device = VK_NULL_HANDLE;
+    uint32_t queueFamilyIndex = 0;
+    uint32_t queueIndex = 0;
+    QuerySupport querySupport = {};
+
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+
+    // Held around the submissions to the queue, shared by every thread that submits to it
+    std::mutex *queueMutex = nullptr;
+};
+
+// Creates the command pool and fence of a context whose queue members are set
+VkResult CreateComputeJobContext(ComputeJobContext &context);
+void DestroyComputeJobContext(ComputeJobContext &context);
+
+// Returns a dispatch index whose printf capture slot no other job in flight uses, waiting for one
+// to be released if they all are, and releases it once its job has been reported. Shared by all
+// the runners and schedulers of the process.
+uint32_t AcquireJobDispatchIndex();
+void ReleaseJobDispatchIndex(uint32_t dispatchIndex);
+
+// Returns false instead of waiting when every slot is in flight, for callers that must not block
+bool TryAcquireJobDispatchIndex(uint32_t &dispatchIndex);
+
+// Runs the phases of one dispatch with a context and reports it, one job at a time across the
+// process. The dispatch is destroyed even when a phase fails.
+VkResult RunComputeJob(const ComputeJobContext &context, const ComputeJob &job, uint32_t dispatchIndex);
+
+// The two halves of RunComputeJob, for callers that wait for the fence their own way.
+// SubmitComputeJob creates, records and submits the dispatch. FinishComputeJob takes the result
+// of the submission, and waits for the dispatch, reports it and destroys it. When printfRecords is
+// set, the printf records of the dispatch are moved there once they have been reported.
+VkResult SubmitComputeJob(const ComputeJobContext &context, const ComputeJob &job, uint32_t dispatchIndex, ComputeDispatch &dispatch);
+VkResult FinishComputeJob(const ComputeJobContext &context, ComputeDispatch &dispatch, VkResult result, std::vector<PrintfRecord> *printfRecords = nullptr);
+
+// Reports a completed dispatch, one job at a time across the process, for callers that keep the
+// objects of their dispatches instead of finishing them
+VkResult ReportComputeJob(const ComputeJobContext &context, const ComputeDispatch &dispatch, std::vector<PrintfRecord> *printfRecords = nullptr);
+
+class ComputeJobRunner
+{
+public:
+    ~ComputeJobRunner();
+
+    // Creates the command pools and fences and starts the workers, 0 starts one per hardware thread
+    VkResult Start(VkDevice device, uint32_t queueFamilyIndex, const QuerySupport &querySupport, uint32_t workerCount);
+
+    // Queues a job, which any worker may run. Jobs start in the order they were submitted but may
+    // complete, and be reported, in any order.
+    void Submit(const ComputeJob &job);
+
+    // Waits until every job submitted so far has completed, and returns the first error a job
+    // failed with since the last call, or VK_SUCCESS
+    VkResult WaitIdle();
+
+    // Runs the jobs still queued, stops the workers and destroys their command pools and fences
+    void Stop();
+
+    uint32_t GetWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+
+private:
+    struct Worker
+    {
+        std::thread thread;
+        ComputeJobContext context;
+    };
+
+    void RunWorker(Worker &worker);
+
+    // Workers are never moved once started, their threads hold references to them
+    std::deque<Worker> workers;
+
+    // Guards the members below it
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable jobsCompleted;
+    std::deque<ComputeJob> jobs;
+    uint32_t jobsInFlight = 0;
+    bool stopping = false;
+    VkResult firstError = VK_SUCCESS;
+
+    std::mutex queueMutex;
+};
@@ -0,0 +1,204 @@
+#include "ComputePipelining.h"
+#include "Tracing.h"
+#include <algorithm>
+#include <cstring>
+
+PipelinedDispatcher::~PipelinedDispatcher()
+{
+    Destroy();
+}
+
+VkResult PipelinedDispatcher::Initialize(const ComputeQueueTarget &target, uint32_t frameCount)
+{
+    device = target.device;
+
+    // Every frame in flight holds a capture slot
+    frames.resize(std::min(std::max(1u, frameCount), printf_capture_slots));
+
+    for (Frame &frame : frames)
+    {
+        frame.context.device = target.device;
+        frame.context.queueFamilyIndex = target.queueFamilyIndex;
+        frame.context.queueIndex = target.queueIndex;
+        frame.context.querySupport = target.querySupport;
+        frame.context.queueMutex = &queueMutex;
+
+        const VkResult result = CreateComputeJobContext(frame.context);
+        if (result != VK_SUCCESS)
+        {
+            return result;
+        }
+
+        frame.dispatch.sharedCommandPool = frame.context.commandPool;
+        frame.dispatch.fence = frame.context.fence;
+        frame.dispatch.queueMutex = frame.context.queueMutex;
+        frame.dispatch.queueIndex = frame.context.queueIndex;
+    }
+
+    return VK_SUCCESS;
+}
+
+VkResult PipelinedDispatcher::SetKernel(const ComputeJob &job)
+{
+    // The dispatches in flight still use the pipeline of the previous kernel
+    const VkResult flushResult = Flush();
+
+    DestroyComputeDispatch(device, kernel);
+    kernelShaderCode = nullptr;
+
+    kernel.pushConstantSize = job.pushConstantSize;
+
+    VkResult result = CreateComputeShaderModule(device, *job.shaderCode, kernel);
+
+    if (VK_SUCCESS == result)
+    {
+        result = CreateComputePipeline(device, kernel);
+    }
+
+    if (VK_SUCCESS != result)
+    {
+        DestroyComputeDispatch(device, kernel);
+        return result;
+    }
+
+    kernelShaderCode = job.shaderCode;
+
+    return flushResult;
+}
+
+VkResult PipelinedDispatcher::SubmitFrame(Frame &frame, const ComputeJob &job, uint32_t dispatchIndex)
+{
+    ComputeDispatch &dispatch = frame.dispatch;
+    dispatch.dispatchIndex = dispatchIndex;
+    dispatch.groupCountX = job.groupCountX;
+    dispatch.pushConstantSize = job.pushConstantSize;
+    memcpy(dispatch.pushConstants, job.pushConstants, sizeof(dispatch.pushConstants));
+    dispatch.pipelineLayout = kernel.pipelineLayout;
+    dispatch.pipeline = kernel.pipeline;
+
+    // The last dispatch of the frame was reported, so its command buffer is no longer in use
+    VkResult result = vkResetCommandPool(device, frame.context.commandPool, 0);
+
+    if (VK_SUCCESS == result)
+    {
+        result = RecordComputeDispatch(device, frame.context.queueFamilyIndex, frame.context.querySupport, dispatch);
+    }
+
+    if (VK_SUCCESS == result)
+    {
+        result = SubmitComputeDispatch(device, frame.context.queueFamilyIndex, dispatch);
+    }
+
+    return result;
+}
+
+VkResult PipelinedDispatcher::Dispatch(const ComputeJob &job)
+{
+    TRACE_SCOPE("pipelined dispatch");
+
+    VkResult result = VK_SUCCESS;
+    if (job.shaderCode != kernelShaderCode || job.pushConstantSize != kernel.pushConstantSize)
+    {
+        result = SetKernel(job);
+        if (nullptr == kernelShaderCode)
+        {
+            return result;
+        }
+    }
+
+    // The frame is free, its last dispatch was reported when the one after it was submitted
+    Frame &frame = frames[submittedCount % frames.size()];
+    frame.submitResult = SubmitFrame(frame, job, AcquireJobDispatchIndex());
+    submittedCount++;
+
+    if (VK_SUCCESS == result)
+    {
+        result = frame.submitResult;
+    }
+
+    // The dispatches submitted since run while the oldest one is decoded
+    if (submittedCount - finishedCount >= frames.size())
+    {
+        const VkResult finishResult = FinishOldest();
+        if (VK_SUCCESS == result)
+        {
+            result = finishResult;
+        }
+    }
+
+    return result;
+}
+
+VkResult PipelinedDispatcher::FinishOldest()
+{
+    Frame &frame = frames[finishedCount % frames.size()];
+    finishedCount++;
+
+    VkResult result = frame.submitResult;
+
+    if (VK_SUCCESS == result)
+    {
+        result = WaitForComputeDispatch(device, frame.dispatch);
+    }
+
+    if (VK_SUCCESS == result)
+    {
+        result = ReportComputeJob(frame.context, frame.dispatch);
+    }
+
+    // A submission that failed to complete may still be using the command buffer
+    if (VK_SUCCESS != result && VK_NULL_HANDLE != frame.dispatch.queue)
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        vkQueueWaitIdle(frame.dispatch.queue);
+    }
+
+    ReleaseJobDispatchIndex(frame.dispatch.dispatchIndex);
+
+    // A failed submission is returned by Dispatch already
+    return VK_SUCCESS != frame.submitResult ? VK_SUCCESS : result;
+}
+
+VkResult PipelinedDispatcher::Flush()
+{
+    VkResult result = VK_SUCCESS;
+    while (finishedCount < submittedCount)
+    {
+        const VkResult finishResult = FinishOldest();
+        if (VK_SUCCESS == result)
+        {
+            result = finishResult;
+        }
+    }
+
+    return result;
+}
+
+void PipelinedDispatcher::Destroy()
+{
+    if (VK_NULL_HANDLE == device)
+    {
+        return;
+    }
+
+    Flush();
+
+    for (Frame &frame : frames)
+    {
+        // The pipeline belongs to the kernel
+        frame.dispatch.pipelineLayout = VK_NULL_HANDLE;
+        frame.dispatch.pipeline = VK_NULL_HANDLE;
+
+        DestroyComputeDispatch(device, frame.dispatch);
+        DestroyComputeJobContext(frame.context);
+    }
+
+    DestroyComputeDispatch(device, kernel);
+    kernel = {};
+    kernelShaderCode = nullptr;
+
+    frames.clear();
+    submittedCount = 0;
+    finishedCount = 0;
+    device = VK_NULL_HANDLE;
+}
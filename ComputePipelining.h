@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ComputeScheduler.h"
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Runs a stream of dispatches of one kernel with changing parameters, with up to N of them in
+// flight on one queue from one thread. The shader module, pipeline layout and pipeline are created
+// once per kernel. Each of the N frames keeps a command pool, a command buffer, query pools and a
+// fence across its dispatches, and holds the printf capture slot of its dispatch (see ComputeJobs.h)
+// until the dispatch is reported. Dispatching k resets the command pool of the frame of dispatch
+// k - N, which was reported by then, re-records its command buffer with the new push constants and
+// submits it, and then waits for and reports dispatch k - N + 1. With two frames, dispatch k + 1 is
+// recorded and dispatch k - 1 decoded while dispatch k executes. One frame runs each dispatch to
+// completion before the next, as RunComputeJob does.
+class PipelinedDispatcher
+{
+public:
+    ~PipelinedDispatcher();
+
+    // Creates the command pools and fences of frameCount frames for a queue, which only the
+    // dispatcher may submit to
+    VkResult Initialize(const ComputeQueueTarget &target, uint32_t frameCount);
+
+    // Records and submits a dispatch of the job, then reports the oldest dispatch in flight if
+    // every frame is in use. Returns the first error of either. A job with other shader code or
+    // push constant size than the one before it changes the kernel, which first reports every
+    // dispatch in flight. The shader code of the job must outlive the dispatch.
+    VkResult Dispatch(const ComputeJob &job);
+
+    // Waits for and reports every dispatch still in flight, returns the first error of them
+    VkResult Flush();
+
+    // Flushes, and destroys the kernel and the objects of the frames
+    void Destroy();
+
+    uint32_t GetFrameCount() const { return static_cast<uint32_t>(frames.size()); }
+
+private:
+    struct Frame
+    {
+        ComputeJobContext context;
+
+        // Keeps its command buffer and query pools from one dispatch to the next, and uses the
+        // pipeline of the kernel, which it does not own
+        ComputeDispatch dispatch;
+
+        // What recording and submitting the dispatch returned
+        VkResult submitResult = VK_SUCCESS;
+    };
+
+    // Replaces the kernel with the one of the job, once the dispatches of the previous one are reported
+    VkResult SetKernel(const ComputeJob &job);
+
+    // Re-records the command buffer of a frame for a dispatch of the job and submits it
+    VkResult SubmitFrame(Frame &frame, const ComputeJob &job, uint32_t dispatchIndex);
+
+    // Reports the oldest dispatch in flight and frees its frame
+    VkResult FinishOldest();
+
+    VkDevice device = VK_NULL_HANDLE;
+    std::vector<Frame> frames;
+
+    // The shader module, pipeline layout and pipeline of the kernel, and the shader code they were created from
+    ComputeDispatch kernel;
+    const std::vector<uint32_t> *kernelShaderCode = nullptr;
+
+    // The dispatches submitted and finished so far, the frame of dispatch k is k % frames.size()
+    uint64_t submittedCount = 0;
+    uint64_t finishedCount = 0;
+
+    // Nothing else submits to the queue, only ComputeJobContext asks for the lock
+    std::mutex queueMutex;
+};
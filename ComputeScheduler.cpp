@@ -0,0 +1,255 @@
+#include "ComputeScheduler.h"
+#include "ClockCalibration.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+ComputeScheduler::~ComputeScheduler()
+{
+    Stop();
+}
+
+void ComputeScheduler::AddQueue(const ComputeQueueTarget &target, uint32_t submitterCount)
+{
+    // The devices are numbered in the order their first queue was added
+    uint32_t deviceNumber = 0;
+    for (const Queue &queue : queues)
+    {
+        if (queue.target.device == target.device)
+        {
+            deviceNumber = queue.deviceNumber;
+            break;
+        }
+        deviceNumber = std::max(deviceNumber, queue.deviceNumber + 1);
+    }
+
+    queues.emplace_back();
+    Queue &queue = queues.back();
+    queue.target = target;
+    queue.deviceNumber = deviceNumber;
+    queue.submitterCount = std::max(1u, submitterCount);
+}
+
+VkResult ComputeScheduler::Start()
+{
+    // The pools and fences are all created before any submitter starts, so a failure leaves nothing running
+    for (uint32_t queueNumber = 0; queueNumber < queues.size(); queueNumber++)
+    {
+        Queue &queue = queues[queueNumber];
+        for (uint32_t i = 0; i < queue.submitterCount; i++)
+        {
+            submitters.emplace_back();
+            Submitter &submitter = submitters.back();
+            submitter.queue = queueNumber;
+            submitter.context.device = queue.target.device;
+            submitter.context.queueFamilyIndex = queue.target.queueFamilyIndex;
+            submitter.context.queueIndex = queue.target.queueIndex;
+            submitter.context.querySupport = queue.target.querySupport;
+            submitter.context.queueMutex = &queue.queueMutex;
+
+            const VkResult result = CreateComputeJobContext(submitter.context);
+            if (result != VK_SUCCESS)
+            {
+                Stop();
+                return result;
+            }
+        }
+    }
+
+    for (Submitter &submitter : submitters)
+    {
+        submitter.thread = std::thread(&ComputeScheduler::RunSubmitter, this, std::ref(submitter));
+    }
+
+    return VK_SUCCESS;
+}
+
+void ComputeScheduler::Submit(const ComputeJob &job)
+{
+    Submit(job, nextQueue.fetch_add(1, std::memory_order_relaxed) % static_cast<uint32_t>(queues.size()));
+}
+
+void ComputeScheduler::Submit(const ComputeJob &job, uint32_t queue)
+{
+    // The job is counted in flight before any submitter can take it, and queued under the
+    // scheduler lock so that a submitter checking for jobs under it cannot miss the wake up
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobsInFlight++;
+
+        std::lock_guard<std::mutex> jobsLock(queues[queue].jobsMutex);
+        queues[queue].jobs.push_back(job);
+        queues[queue].queuedCount.fetch_add(1, std::memory_order_relaxed);
+        queuedJobs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Any idle submitter may be the one to steal the job, and without stealing only those of its queue can run it
+    jobAvailable.notify_all();
+}
+
+VkResult ComputeScheduler::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    jobsCompleted.wait(lock, [this] { return 0 == jobsInFlight; });
+
+    const VkResult result = firstError;
+    firstError = VK_SUCCESS;
+
+    return result;
+}
+
+void ComputeScheduler::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    jobAvailable.notify_all();
+
+    for (Submitter &submitter : submitters)
+    {
+        if (submitter.thread.joinable())
+        {
+            submitter.thread.join();
+        }
+
+        DestroyComputeJobContext(submitter.context);
+    }
+
+    submitters.clear();
+    stopping = false;
+}
+
+bool ComputeScheduler::TakeJob(uint32_t queue, ComputeJob &job)
+{
+    {
+        Queue &own = queues[queue];
+        std::lock_guard<std::mutex> lock(own.jobsMutex);
+        if (!own.jobs.empty())
+        {
+            job = own.jobs.front();
+            own.jobs.pop_front();
+            own.queuedCount.fetch_sub(1, std::memory_order_relaxed);
+            queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    if (!stealing.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    // The counts may be stale by the time the victim is locked, the caller tries again then
+    uint32_t victim = queue;
+    uint32_t mostQueued = 0;
+    for (uint32_t i = 0; i < queues.size(); i++)
+    {
+        const uint32_t queued = queues[i].queuedCount.load(std::memory_order_relaxed);
+        if (i != queue && queued > mostQueued)
+        {
+            victim = i;
+            mostQueued = queued;
+        }
+    }
+
+    if (victim == queue)
+    {
+        return false;
+    }
+
+    // The back of the victim's deque is the job its own submitters would reach last
+    Queue &busy = queues[victim];
+    std::lock_guard<std::mutex> lock(busy.jobsMutex);
+    if (busy.jobs.empty())
+    {
+        return false;
+    }
+
+    job = busy.jobs.back();
+    busy.jobs.pop_back();
+    busy.queuedCount.fetch_sub(1, std::memory_order_relaxed);
+    queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    queues[queue].jobsStolen.fetch_add(1, std::memory_order_relaxed);
+
+    return true;
+}
+
+void ComputeScheduler::RunSubmitter(Submitter &submitter)
+{
+    Queue &queue = queues[submitter.queue];
+
+    for (;;)
+    {
+        ComputeJob job;
+        if (!TakeJob(submitter.queue, job))
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            // A job counted but not yet taken may be on another deque, which only a thief can reach
+            const bool stealingEnabled = stealing.load(std::memory_order_relaxed);
+            const auto hasJob = [&] { return 0 != (stealingEnabled ? queuedJobs.load(std::memory_order_relaxed) : queue.queuedCount.load(std::memory_order_relaxed)); };
+
+            if (stopping && !hasJob())
+            {
+                return;
+            }
+
+            jobAvailable.wait(lock, [&] { return stopping || hasJob(); });
+            continue;
+        }
+
+        const int64_t startTime = GetHostNanoseconds();
+
+        const uint32_t dispatchIndex = AcquireJobDispatchIndex();
+        const VkResult result = RunComputeJob(submitter.context, job, dispatchIndex);
+        ReleaseJobDispatchIndex(dispatchIndex);
+
+        queue.busyNanoseconds.fetch_add(GetHostNanoseconds() - startTime, std::memory_order_relaxed);
+        queue.jobsRun.fetch_add(1, std::memory_order_relaxed);
+
+        bool idle = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (VK_SUCCESS != result && VK_SUCCESS == firstError)
+            {
+                firstError = result;
+            }
+            idle = 0 == --jobsInFlight;
+        }
+
+        if (idle)
+        {
+            jobsCompleted.notify_all();
+        }
+    }
+}
+
+ComputeQueueStatistics ComputeScheduler::GetQueueStatistics(uint32_t queue) const
+{
+    ComputeQueueStatistics statistics;
+    statistics.jobsRun = queues[queue].jobsRun.load(std::memory_order_relaxed);
+    statistics.jobsStolen = queues[queue].jobsStolen.load(std::memory_order_relaxed);
+    statistics.busyNanoseconds = queues[queue].busyNanoseconds.load(std::memory_order_relaxed);
+
+    return statistics;
+}
+
+void ComputeScheduler::Report() const
+{
+    std::string lines;
+    for (uint32_t i = 0; i < queues.size(); i++)
+    {
+        const Queue &queue = queues[i];
+        const ComputeQueueStatistics statistics = GetQueueStatistics(i);
+
+        lines += "[SCHEDULER] : queue " + std::to_string(i) + " : device " + std::to_string(queue.deviceNumber) +
+            " family " + std::to_string(queue.target.queueFamilyIndex) + " queue " + std::to_string(queue.target.queueIndex) +
+            " : " + std::to_string(statistics.jobsRun) + " jobs, " + std::to_string(statistics.jobsStolen) + " stolen, busy " +
+            std::to_string(statistics.busyNanoseconds / 1000000) + " ms\n";
+    }
+
+    std::cout << lines;
+    std::cout.flush();
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "ComputeJobs.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Schedules dispatch jobs across several queues, of one device or of several. Each queue has its
+// own deque of pending jobs and its own submitter threads, each with a command pool and a fence
+// that tracks the completion of its dispatch. A submitter runs the jobs of its queue's deque from
+// the front, and when that deque is empty it steals from the back of the deque that has the most
+// jobs pending, so a queue stuck behind long dispatches does not hold up jobs that an idle queue
+// could run. Jobs carry no device objects, every dispatch creates its shader module and pipeline
+// on the device of the queue that runs it, so a job can be stolen across devices too.
+//
+// Taking a job locks only the deque it comes from. Submitting one and completing it also take the
+// scheduler-wide lock, to count the jobs in flight and wake the idle submitters. The dispatch
+// indices and reports follow ComputeJobs.h.
+
+// A queue the scheduler submits to. CreateDevice must have created the device with more than
+// queueIndex queues of the family.
+struct ComputeQueueTarget
+{
+    VkDevice device = VK_NULL_HANDLE;
+    uint32_t queueFamilyIndex = 0;
+    uint32_t queueIndex = 0;
+    QuerySupport querySupport = {};
+};
+
+// What a queue has done since the scheduler started
+struct ComputeQueueStatistics
+{
+    uint64_t jobsRun = 0;
+
+    // Of the jobs run, those taken from the deque of another queue
+    uint64_t jobsStolen = 0;
+
+    int64_t busyNanoseconds = 0;
+};
+
+class ComputeScheduler
+{
+public:
+    ~ComputeScheduler();
+
+    // Adds a queue before Start, with the number of threads that submit to it
+    void AddQueue(const ComputeQueueTarget &target, uint32_t submitterCount = 1);
+
+    // Creates the command pools and fences of the submitters and starts them
+    VkResult Start();
+
+    // Without stealing, each submitter only runs the jobs of its own queue, for comparison
+    void SetStealing(bool steal) { stealing.store(steal, std::memory_order_relaxed); }
+
+    // Queues a job on the deques in turn
+    void Submit(const ComputeJob &job);
+
+    // Queues a job on the deque of one queue, in the order the queues were added
+    void Submit(const ComputeJob &job, uint32_t queue);
+
+    // Waits until every job submitted so far has completed, and returns the first error a job
+    // failed with since the last call, or VK_SUCCESS
+    VkResult WaitIdle();
+
+    // Runs the jobs still queued, stops the submitters and destroys their command pools and fences
+    void Stop();
+
+    uint32_t GetQueueCount() const { return static_cast<uint32_t>(queues.size()); }
+
+    ComputeQueueStatistics GetQueueStatistics(uint32_t queue) const;
+
+    // Writes the statistics of every queue to std::cout as "[SCHEDULER] : queue <n> : ..." lines
+    void Report() const;
+
+private:
+    struct Queue
+    {
+        ComputeQueueTarget target;
+        uint32_t deviceNumber = 0;
+        uint32_t submitterCount = 1;
+
+        // Held around vkQueueSubmit by every submitter of the queue
+        std::mutex queueMutex;
+
+        // Guards jobs, queuedCount follows its size for the thieves to read without the lock
+        std::mutex jobsMutex;
+        std::deque<ComputeJob> jobs;
+        std::atomic<uint32_t> queuedCount{ 0 };
+
+        std::atomic<uint64_t> jobsRun{ 0 };
+        std::atomic<uint64_t> jobsStolen{ 0 };
+        std::atomic<int64_t> busyNanoseconds{ 0 };
+    };
+
+    struct Submitter
+    {
+        std::thread thread;
+        uint32_t queue = 0;
+        ComputeJobContext context;
+    };
+
+    // Takes the next job of a queue's deque, or steals one, returns false if there was none
+    bool TakeJob(uint32_t queue, ComputeJob &job);
+
+    void RunSubmitter(Submitter &submitter);
+
+    // Neither queues nor submitters are moved once added, the submitter threads hold references to them
+    std::deque<Queue> queues;
+    std::deque<Submitter> submitters;
+
+    std::atomic<bool> stealing{ true };
+    std::atomic<uint32_t> queuedJobs{ 0 };
+    std::atomic<uint32_t> nextQueue{ 0 };
+
+    // Guards the members below it
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable jobsCompleted;
+    uint32_t jobsInFlight = 0;
+    bool stopping = false;
+    VkResult firstError = VK_SUCCESS;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+// The output files may pass 2 GB, beyond what fseek and long can address on Windows, so their
+// readers seek with 64-bit offsets
+
+inline int SeekFile(FILE *file, uint64_t offset, int origin)
+{
+#if defined(_MSC_VER)
+    return _fseeki64(file, static_cast<int64_t>(offset), origin);
+#else
+    return fseeko(file, static_cast<off_t>(offset), origin);
+#endif
+}
+
+inline uint64_t TellFile(FILE *file)
+{
+#if defined(_MSC_VER)
+    return static_cast<uint64_t>(_ftelli64(file));
+#else
+    return static_cast<uint64_t>(ftello(file));
+#endif
+}
@@ -0,0 +1,392 @@
+#include "Benchmark.h"
+#include "IntegerFormat.h"
+#include "PrintfFormat.h"
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <random>
+
+// The kinds of values the printf arguments usually hold
+struct IntegerValueSet
+{
+    const char *name;
+    uint32_t bits;
+};
+
+static const IntegerValueSet integerValueSets[] = {
+    { "invocation ids (20-bit)", 20 },
+    { "32-bit", 32 },
+    { "64-bit", 64 }
+};
+
+// One way of turning a series of values into text, returning the characters written
+// so the compiler cannot drop the work
+using IntegerFormatter = size_t (*)(const std::vector<uint64_t> &values, bool hex, std::vector<char> &output, std::ostream &stream);
+
+static size_t FormatWithStream(const std::vector<uint64_t> &values, bool hex, std::vector<char> &output, std::ostream &stream)
+{
+    stream << (hex ? std::hex : std::dec);
+    for (uint64_t value : values)
+    {
+        stream << value << ' ';
+    }
+
+    return values.size();
+}
+
+static size_t FormatWithSnprintf(const std::vector<uint64_t> &values, bool hex, std::vector<char> &output, std::ostream &stream)
+{
+    char *position = output.data();
+    for (uint64_t value : values)
+    {
+        position += snprintf(position, integer_format_max_length + 2, hex ? "%llx " : "%llu ", static_cast<unsigned long long>(value));
+    }
+
+    return static_cast<size_t>(position - output.data());
+}
+
+static size_t FormatWithToChars(const std::vector<uint64_t> &values, bool hex, std::vector<char> &output, std::ostream &stream)
+{
+    char *position = output.data();
+    char *const end = output.data() + output.size();
+    for (uint64_t value : values)
+    {
+        position = std::to_chars(position, end, value, hex ? 16 : 10).ptr;
+        *position++ = ' ';
+    }
+
+    return static_cast<size_t>(position - output.data());
+}
+
+static size_t FormatWithIntegerFormat(const std::vector<uint64_t> &values, bool hex, std::vector<char> &output, std::ostream &stream)
+{
+    char *position = output.data();
+    for (uint64_t value : values)
+    {
+        position += hex ? FormatHex(value, false, position) : FormatDecimal(value, position);
+        *position++ = ' ';
+    }
+
+    return static_cast<size_t>(position - output.data());
+}
+
+static size_t FormatWithIntegerFormatBatch(const std::vector<uint64_t> &values, bool hex, std::vector<char> &output, std::ostream &stream)
+{
+    return FormatDecimalBatch(values.data(), values.size(), ' ', output.data());
+}
+
+struct IntegerFormatterEntry
+{
+    const char *name;
+    IntegerFormatter formatter;
+    bool supportsHex;
+};
+
+static const IntegerFormatterEntry integerFormatters[] = {
+    { "iostream operator<<", FormatWithStream, true },
+    { "snprintf", FormatWithSnprintf, true },
+    { "std::to_chars", FormatWithToChars, true },
+    { "FormatDecimal/FormatHex", FormatWithIntegerFormat, true },
+    { "FormatDecimalBatch", FormatWithIntegerFormatBatch, false }
+};
+
+// Float and double arguments, "%f" and "%lf" in the shader
+struct FloatValueSet
+{
+    const char *name;
+    bool single;
+};
+
+static const FloatValueSet floatValueSets[] = {
+    { "float", true },
+    { "double", false }
+};
+
+// One way of turning a series of floating point values into text, returning the characters
+// written. Every formatter but "%f" writes enough digits for the values to parse back exactly.
+using FloatFormatter = size_t (*)(const std::vector<double> &values, bool single, std::vector<char> &output, std::string &text, std::ostream &stream);
+
+static size_t FormatFloatWithStream(const std::vector<double> &values, bool single, std::vector<char> &output, std::string &text, std::ostream &stream)
+{
+    stream << std::setprecision(single ? std::numeric_limits<float>::max_digits10 : std::numeric_limits<double>::max_digits10);
+    for (double value : values)
+    {
+        stream << value << ' ';
+    }
+
+    return values.size();
+}
+
+static size_t FormatFloatWithSnprintf(const std::vector<double> &values, bool single, std::vector<char> &output, std::string &text, std::ostream &stream)
+{
+    char *position = output.data();
+    for (double value : values)
+    {
+        position += snprintf(position, 32, single ? "%.9g " : "%.17g ", value);
+    }
+
+    return static_cast<size_t>(position - output.data());
+}
+
+static size_t FormatFloatWithSnprintfFixed(const std::vector<double> &values, bool single, std::vector<char> &output, std::string &text, std::ostream &stream)
+{
+    char *position = output.data();
+    for (double value : values)
+    {
+        position += snprintf(position, 32, "%f ", value);
+    }
+
+    return static_cast<size_t>(position - output.data());
+}
+
+static size_t FormatFloatWithToChars(const std::vector<double> &values, bool single, std::vector<char> &output, std::string &text, std::ostream &stream)
+{
+    char *position = output.data();
+    char *const end = output.data() + output.size();
+    for (double value : values)
+    {
+        position = single ? std::to_chars(position, end, static_cast<float>(value)).ptr : std::to_chars(position, end, value).ptr;
+        *position++ = ' ';
+    }
+
+    return static_cast<size_t>(position - output.data());
+}
+
+static size_t FormatFloatWithRenderer(const std::vector<double> &values, bool single, std::vector<char> &output, std::string &text, std::ostream &stream)
+{
+    static const char float_format[] = "%.9g ";
+    static const char double_format[] = "%.17lg ";
+    const PrintfFormatView &format = GetPrintfFormat(RegisterPrintfFormat(single ? float_format : double_format));
+
+    text.clear();
+    for (double value : values)
+    {
+        uint64_t argument = 0;
+        memcpy(&argument, &value, sizeof(argument));
+        RenderPrintfFormat(format, &argument, text);
+    }
+
+    return text.size();
+}
+
+struct FloatFormatterEntry
+{
+    const char *name;
+    FloatFormatter formatter;
+};
+
+static const FloatFormatterEntry floatFormatters[] = {
+    { "iostream max_digits10", FormatFloatWithStream },
+    { "snprintf %.9g/%.17g", FormatFloatWithSnprintf },
+    { "snprintf %f (inexact)", FormatFloatWithSnprintfFixed },
+    { "std::to_chars shortest", FormatFloatWithToChars },
+    { "RenderPrintfFormat %.9g/%.17g", FormatFloatWithRenderer }
+};
+
+// Counts the values in the text written by FormatFloatWithRenderer that do not parse back exactly
+static size_t CountRoundTripFailures(const std::vector<double> &values, bool single, const std::string &text)
+{
+    size_t failures = 0;
+    const char *position = text.c_str();
+    for (double value : values)
+    {
+        char *end = nullptr;
+        const bool exact = single ? strtof(position, &end) == static_cast<float>(value) : strtod(position, &end) == value;
+        failures += exact ? 0 : 1;
+        position = end;
+    }
+
+    return failures;
+}
+
+// Integer conversions whose '#' flag and precision interact, with the values they differ on
+struct IntegerFormatCase
+{
+    const char *format;
+    uint32_t value;
+};
+
+static const IntegerFormatCase integerFormatCases[] = {
+    { "%#o", 0 },
+    { "%#o", 8 },
+    { "%#.0o", 0 },
+    { "%#.3o", 8 },
+    { "%#.3o", 0 },
+    { "%#6o", 8 },
+    { "%#06o", 8 },
+    { "%#-6o|", 0 },
+    { "%#x", 0 },
+    { "%#x", 255 },
+    { "%#.0x", 0 },
+    { "%#08X", 255 }
+};
+
+// Float conversions without a precision, which take printf's default of 6
+struct FloatFormatCase
+{
+    const char *format;
+    double value;
+};
+
+static const FloatFormatCase floatFormatCases[] = {
+    { "%f", 1.5 },
+    { "%e", 1.5 },
+    { "%g", 1.5 },
+    { "%g", 100000.0 },
+    { "%g", 1234567.0 },
+    { "%g", 0.0001 },
+    { "%lf", 0.1 },
+    { "%E", -2.5e-10 },
+    { "%10.3f", 3.14159 }
+};
+
+// Counts the floatFormatCases RenderPrintfFormat renders differently from snprintf, and prints each of them
+static size_t CountFloatFormatMismatches()
+{
+    size_t mismatches = 0;
+    for (const FloatFormatCase &formatCase : floatFormatCases)
+    {
+        char expected[64] = {};
+        snprintf(expected, sizeof(expected), formatCase.format, formatCase.value);
+
+        std::string text;
+        uint64_t argument = 0;
+        memcpy(&argument, &formatCase.value, sizeof(argument));
+        RenderPrintfFormat(GetPrintfFormat(RegisterPrintfFormat(formatCase.format)), &argument, text);
+
+        if (text != expected)
+        {
+            printf("%s of %g: RenderPrintfFormat \"%s\", snprintf \"%s\"\n", formatCase.format, formatCase.value, text.c_str(), expected);
+            mismatches++;
+        }
+    }
+
+    return mismatches;
+}
+
+// Counts the integerFormatCases RenderPrintfFormat renders differently from snprintf, and prints each of them
+static size_t CountIntegerFormatMismatches()
+{
+    size_t mismatches = 0;
+    for (const IntegerFormatCase &formatCase : integerFormatCases)
+    {
+        char expected[64] = {};
+        snprintf(expected, sizeof(expected), formatCase.format, formatCase.value);
+
+        std::string text;
+        const uint64_t argument = formatCase.value;
+        RenderPrintfFormat(GetPrintfFormat(RegisterPrintfFormat(formatCase.format)), &argument, text);
+
+        if (text != expected)
+        {
+            printf("%s of %u: RenderPrintfFormat \"%s\", snprintf \"%s\"\n", formatCase.format, formatCase.value, text.c_str(), expected);
+            mismatches++;
+        }
+    }
+
+    return mismatches;
+}
+
+// Times one formatter over the values and prints its row
+template <typename Formatter, typename... Arguments>
+static void MeasureFormatter(const BenchmarkOptions &options, const char *name, Formatter formatter, size_t valueCount, Arguments &...arguments)
+{
+    volatile size_t written = 0;
+
+    for (uint32_t i = 0; i < options.warmupIterations; i++)
+    {
+        written = written + formatter(arguments...);
+    }
+
+    std::vector<double> samples;
+    for (uint32_t i = 0; i < options.iterations; i++)
+    {
+        const BenchmarkClock::time_point start = BenchmarkClock::now();
+        written = written + formatter(arguments...);
+        samples.push_back(std::chrono::duration<double, std::nano>(BenchmarkClock::now() - start).count() / valueCount);
+    }
+
+    PrintStatisticsRow(name, ComputeSampleStatistics(samples));
+}
+
+// Formats --values integers of each size with each formatter, in decimal and in hex, then
+// --values floats and doubles, and prints the nanoseconds per value
+int RunFormatBenchmark(const BenchmarkOptions &options)
+{
+    if (0 == options.values)
+    {
+        fprintf(stderr, "The format benchmark needs at least one value\n");
+        return EXIT_FAILURE;
+    }
+
+    std::mt19937_64 random(12345);
+
+    // The stream formats into a buffer that discards the text, as VulkanDebugCallback's
+    // std::cout would when redirected, so only the formatting is measured
+    NullStreamBuffer nullStreamBuffer;
+    std::ostream stream(&nullStreamBuffer);
+
+    std::vector<char> output(static_cast<size_t>(options.values) * (integer_format_max_length + 1));
+
+    for (const IntegerValueSet &valueSet : integerValueSets)
+    {
+        std::vector<uint64_t> values(options.values);
+        for (uint64_t &value : values)
+        {
+            value = 64 == valueSet.bits ? random() : random() & ((1ull << valueSet.bits) - 1);
+        }
+
+        for (bool hex : { false, true })
+        {
+            printf("\n%s values, %s\n", valueSet.name, hex ? "hex" : "decimal");
+            PrintStatisticsHeader("ns per value");
+
+            for (const IntegerFormatterEntry &entry : integerFormatters)
+            {
+                if (hex && !entry.supportsHex)
+                {
+                    continue;
+                }
+
+                MeasureFormatter(options, entry.name, entry.formatter, values.size(), values, hex, output, stream);
+            }
+        }
+    }
+
+    // Random bit patterns cover every exponent, the way values of real shader output would not,
+    // so the floats are drawn from a wide log-uniform range instead
+    std::string text;
+    output.resize(static_cast<size_t>(options.values) * 32);
+
+    for (const FloatValueSet &valueSet : floatValueSets)
+    {
+        std::vector<double> values(options.values);
+        std::uniform_real_distribution<double> exponent(-12.0, 12.0);
+        for (double &value : values)
+        {
+            value = (random() & 1 ? -1.0 : 1.0) * pow(10.0, exponent(random));
+            value = valueSet.single ? static_cast<float>(value) : value;
+        }
+
+        printf("\n%s values\n", valueSet.name);
+        PrintStatisticsHeader("ns per value");
+
+        for (const FloatFormatterEntry &entry : floatFormatters)
+        {
+            MeasureFormatter(options, entry.name, entry.formatter, values.size(), values, valueSet.single, output, text, stream);
+        }
+
+        FormatFloatWithRenderer(values, valueSet.single, output, text, stream);
+        printf("RenderPrintfFormat output that does not parse back exactly: %zu of %zu values\n", CountRoundTripFailures(values, valueSet.single, text), values.size());
+    }
+
+    printf("\nRenderPrintfFormat integer conversions that differ from snprintf: %zu of %zu\n", CountIntegerFormatMismatches(), sizeof(integerFormatCases) / sizeof(integerFormatCases[0]));
+    printf("RenderPrintfFormat float conversions that differ from snprintf: %zu of %zu\n", CountFloatFormatMismatches(), sizeof(floatFormatCases) / sizeof(floatFormatCases[0]));
+
+    return EXIT_SUCCESS;
+}
@@ -1,10 +1,19 @@
 // glslangValidator -V -e main $(ProjectDir)\HLSLComputeShader.comp.hlsl -o $(ProjectDir)\HLSLComputeShader.comp.spv
 
+// correlationId identifies the dispatch, and starts every message with the index of the
+// invocation in (workgroup, local invocation) order, which the messages can be sorted by
+struct PushConstants
+{
+	uint correlationId;
+};
+
+[[vk::push_constant]] ConstantBuffer<PushConstants> pushConstants;
+
 [numthreads(512, 1, 1)]
-void main( uint3 DTid : SV_DispatchThreadID )
+void main( uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex )
 {
 	if (DTid[0] < 16)
 	{
-		printf("HLSL GI ID X value is: %d", DTid[0]);
+		printf("[dispatch %u invocation %u] HLSL GI ID X value is: %d", pushConstants.correlationId, Gid[0] * 512 + GI, DTid[0]);
 	}
 }
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// Mixes the bits of a value so that each of them changes about half of the result, the
+// finalizer of MurmurHash3. It is a bijection, and zero is the only value that mixes to zero.
+inline uint64_t MixHash(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ull;
+    value ^= value >> 33;
+
+    return value;
+}
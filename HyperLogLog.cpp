@@ -0,0 +1,69 @@
+#include "HyperLogLog.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+HyperLogLog::HyperLogLog()
+{
+    Reset();
+}
+
+void HyperLogLog::Add(uint64_t value)
+{
+    // MixHash maps only zero to zero, so the offset keeps a zero value from leaving every bit clear
+    const uint64_t hash = MixHash(value + 0x9e3779b97f4a7c15ull);
+
+    const uint32_t index = static_cast<uint32_t>(hash >> (64 - hyperloglog_precision));
+
+    // The position of the first set bit in the rest of the hash, one past its end if none is set
+    uint64_t rest = hash << hyperloglog_precision;
+    uint8_t rank = 1;
+    while (rank <= 64 - hyperloglog_precision && 0 == (rest & (1ull << 63)))
+    {
+        rest <<= 1;
+        rank++;
+    }
+
+    registers[index] = std::max(registers[index], rank);
+}
+
+void HyperLogLog::Merge(const HyperLogLog &other)
+{
+    for (uint32_t i = 0; i < hyperloglog_registers; i++)
+    {
+        registers[i] = std::max(registers[i], other.registers[i]);
+    }
+}
+
+void HyperLogLog::Reset()
+{
+    memset(registers, 0, sizeof(registers));
+}
+
+uint64_t HyperLogLog::Estimate() const
+{
+    const double registerCount = hyperloglog_registers;
+
+    double inverseSum = 0.0;
+    uint32_t emptyRegisters = 0;
+    for (uint32_t i = 0; i < hyperloglog_registers; i++)
+    {
+        inverseSum += std::ldexp(1.0, -registers[i]);
+        if (0 == registers[i])
+        {
+            emptyRegisters++;
+        }
+    }
+
+    // The bias correction of the HyperLogLog paper for 128 or more registers
+    const double alpha = 0.7213 / (1.0 + 1.079 / registerCount);
+    double estimate = alpha * registerCount * registerCount / inverseSum;
+
+    if (estimate <= 2.5 * registerCount && 0 != emptyRegisters)
+    {
+        estimate = registerCount * std::log(registerCount / emptyRegisters);
+    }
+
+    return static_cast<uint64_t>(estimate + 0.5);
+}
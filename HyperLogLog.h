@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+// Estimates the number of distinct values in a stream in a fixed 4 KB, with a standard error of
+// about 1.6%. Each value is hashed, the first hyperloglog_precision bits of the hash pick one of
+// the registers, and the register keeps the longest run of leading zeros seen in the rest of the
+// hash. Small counts, where many registers are still empty, are estimated by linear counting.
+// Sketches of parts of a stream can be merged into the sketch of the whole stream.
+static const uint32_t hyperloglog_precision = 12;
+static const uint32_t hyperloglog_registers = 1u << hyperloglog_precision;
+
+class HyperLogLog
+{
+public:
+    HyperLogLog();
+
+    // Adds a value, which is hashed first, so consecutive integers are fine
+    void Add(uint64_t value);
+
+    void Merge(const HyperLogLog &other);
+    void Reset();
+
+    uint64_t Estimate() const;
+
+private:
+    uint8_t registers[hyperloglog_registers];
+};
@@ -0,0 +1,218 @@
+#include "IntegerFormat.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define INTEGER_FORMAT_SSE2 true
+#include <emmintrin.h>
+#else
+#define INTEGER_FORMAT_SSE2 false
+#endif
+
+#if INTEGER_FORMAT_SSE2
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Returns the index of the lowest set bit of a non-zero mask
+static inline uint32_t GetLowestBit(uint32_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+}
+
+// Constants of the eight digit conversion, see Convert8Digits
+alignas(16) static const uint32_t div_10000_vector[4] = { 0xd1b71759, 0xd1b71759, 0xd1b71759, 0xd1b71759 };
+alignas(16) static const uint32_t mul_10000_vector[4] = { 10000, 10000, 10000, 10000 };
+alignas(16) static const uint16_t div_powers_vector[8] = { 8389, 5243, 13108, 32768, 8389, 5243, 13108, 32768 };
+alignas(16) static const uint16_t shift_powers_vector[8] = { 1 << 7, 1 << 11, 1 << 13, 1 << 15, 1 << 7, 1 << 11, 1 << 13, 1 << 15 };
+alignas(16) static const uint16_t mul_10_vector[8] = { 10, 10, 10, 10, 10, 10, 10, 10 };
+
+// Splits a value below 10^8 into its eight decimal digits, one per 16-bit lane, most significant first.
+// abcdefgh is divided into abcd and efgh by a multiply with the reciprocal of 10000, then each half
+// is spread over four lanes and divided by 1000, 100, 10 and 1 with multiply-high and shift steps,
+// giving [a, ab, abc, abcd, e, ef, efg, efgh], from which subtracting ten times the lane to the
+// left leaves one digit per lane.
+static inline __m128i Convert8Digits(uint32_t value)
+{
+    const __m128i abcdefgh = _mm_cvtsi32_si128(static_cast<int>(value));
+    const __m128i abcd = _mm_srli_epi64(_mm_mul_epu32(abcdefgh, _mm_load_si128(reinterpret_cast<const __m128i *>(div_10000_vector))), 45);
+    const __m128i efgh = _mm_sub_epi32(abcdefgh, _mm_mul_epu32(abcd, _mm_load_si128(reinterpret_cast<const __m128i *>(mul_10000_vector))));
+
+    const __m128i v1 = _mm_unpacklo_epi16(abcd, efgh);
+    const __m128i v1a = _mm_slli_epi64(v1, 2);
+    const __m128i v2a = _mm_unpacklo_epi16(v1a, v1a);
+    const __m128i v2 = _mm_unpacklo_epi32(v2a, v2a);
+
+    const __m128i v3 = _mm_mulhi_epu16(v2, _mm_load_si128(reinterpret_cast<const __m128i *>(div_powers_vector)));
+    const __m128i v4 = _mm_mulhi_epu16(v3, _mm_load_si128(reinterpret_cast<const __m128i *>(shift_powers_vector)));
+    const __m128i v5 = _mm_mullo_epi16(v4, _mm_load_si128(reinterpret_cast<const __m128i *>(mul_10_vector)));
+    const __m128i v6 = _mm_slli_epi64(v5, 16);
+
+    return _mm_sub_epi16(v4, v6);
+}
+
+// Writes the sixteen ASCII digits in digits to output, skipping the leading zeros but always
+// keeping the last digit, and returns how many were written. The digits are stored with one
+// unaligned 16 byte store, so output must have room for 16 characters.
+static inline size_t StoreWithoutLeadingZeros(__m128i digits, char *output)
+{
+    const uint32_t zeros = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(digits, _mm_set1_epi8('0'))));
+    const uint32_t skip = GetLowestBit(~zeros | 0x8000);
+
+    alignas(16) char buffer[32];
+    _mm_store_si128(reinterpret_cast<__m128i *>(buffer), digits);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output), _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + skip)));
+
+    return 16 - skip;
+}
+
+// As StoreWithoutLeadingZeros, for eight ASCII digits in the low half of digits
+static inline size_t Store8WithoutLeadingZeros(__m128i digits, char *output)
+{
+    const uint32_t zeros = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(digits, _mm_set1_epi8('0'))));
+    const uint32_t skip = GetLowestBit(~zeros | 0x80);
+
+    alignas(16) char buffer[16];
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(buffer), digits);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(output), _mm_loadl_epi64(reinterpret_cast<const __m128i *>(buffer + skip)));
+
+    return 8 - skip;
+}
+
+// Converts a value below 10^16 into sixteen ASCII digits
+static inline __m128i Convert16Digits(uint64_t value)
+{
+    const __m128i high = Convert8Digits(static_cast<uint32_t>(value / 100000000));
+    const __m128i low = Convert8Digits(static_cast<uint32_t>(value % 100000000));
+
+    return _mm_add_epi8(_mm_packus_epi16(high, low), _mm_set1_epi8('0'));
+}
+
+size_t FormatDecimal(uint64_t value, char *output)
+{
+    // Most printf arguments are small, and need only one eight digit conversion
+    if (value < 100000000)
+    {
+        const __m128i digits = _mm_packus_epi16(Convert8Digits(static_cast<uint32_t>(value)), _mm_setzero_si128());
+        return Store8WithoutLeadingZeros(_mm_add_epi8(digits, _mm_set1_epi8('0')), output);
+    }
+
+    if (value < 10000000000000000ull)
+    {
+        return StoreWithoutLeadingZeros(Convert16Digits(value), output);
+    }
+
+    // Values of 10^16 and above have at most four more leading digits
+    const uint32_t top = static_cast<uint32_t>(value / 10000000000000000ull);
+    const __m128i topDigits = _mm_packus_epi16(Convert8Digits(top), _mm_setzero_si128());
+    const size_t length = Store8WithoutLeadingZeros(_mm_add_epi8(topDigits, _mm_set1_epi8('0')), output);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output + length), Convert16Digits(value % 10000000000000000ull));
+
+    return length + 16;
+}
+
+size_t FormatHex(uint64_t value, bool upperCase, char *output)
+{
+    // Put the most significant byte first, then split every byte into its two nibbles
+#ifdef _MSC_VER
+    const uint64_t bigEndian = _byteswap_uint64(value);
+#else
+    const uint64_t bigEndian = __builtin_bswap64(value);
+#endif
+
+    const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(&bigEndian));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i nibbles = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(bytes, 4), mask), _mm_and_si128(bytes, mask));
+
+    // '0' + nibble, plus the distance from '9' + 1 to 'a' (or 'A') for the nibbles above 9
+    const __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8(upperCase ? 'A' - '9' - 1 : 'a' - '9' - 1));
+    const __m128i digits = _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+
+    return StoreWithoutLeadingZeros(digits, output);
+}
+
+#else
+
+static const char two_digits[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+size_t FormatDecimal(uint64_t value, char *output)
+{
+    char buffer[integer_format_max_length];
+    size_t position = sizeof(buffer);
+
+    while (value >= 100)
+    {
+        const uint32_t pair = static_cast<uint32_t>(value % 100);
+        value /= 100;
+        position -= 2;
+        memcpy(buffer + position, two_digits + 2 * pair, 2);
+    }
+
+    if (value >= 10)
+    {
+        position -= 2;
+        memcpy(buffer + position, two_digits + 2 * value, 2);
+    }
+    else
+    {
+        buffer[--position] = static_cast<char>('0' + value);
+    }
+
+    memcpy(output, buffer + position, sizeof(buffer) - position);
+    return sizeof(buffer) - position;
+}
+
+size_t FormatHex(uint64_t value, bool upperCase, char *output)
+{
+    const char *const digits = upperCase ? "0123456789ABCDEF" : "0123456789abcdef";
+
+    char buffer[16];
+    size_t position = sizeof(buffer);
+    do
+    {
+        buffer[--position] = digits[value & 0xf];
+        value >>= 4;
+    } while (0 != value);
+
+    memcpy(output, buffer + position, sizeof(buffer) - position);
+    return sizeof(buffer) - position;
+}
+
+#endif
+
+size_t FormatDecimalBatch(const uint64_t *values, size_t count, char separator, char *output)
+{
+    char *position = output;
+    for (size_t i = 0; i < count; i++)
+    {
+        position += FormatDecimal(values[i], position);
+        *position++ = separator;
+    }
+
+    return static_cast<size_t>(position - output);
+}
+
+size_t FormatSignedDecimalBatch(const int64_t *values, size_t count, char separator, char *output)
+{
+    char *position = output;
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint64_t magnitude = values[i] < 0 ? 0 - static_cast<uint64_t>(values[i]) : static_cast<uint64_t>(values[i]);
+        *position = '-';
+        position += values[i] < 0 ? 1 : 0;
+        position += FormatDecimal(magnitude, position);
+        *position++ = separator;
+    }
+
+    return static_cast<size_t>(position - output);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Integer to text conversion for the printf renderer. On x86-64 the digits are extracted
+// with SSE2, eight decimal digits (or sixteen hex digits) per vector, and other targets
+// use a two digits per step lookup table. No output is null terminated, and the digits
+// are written with whole vector stores, so output must always have room for
+// integer_format_max_length characters even when fewer are returned.
+
+// The most characters FormatDecimal and FormatHex write for one value
+static const size_t integer_format_max_length = 20;
+
+// Writes the decimal digits of value to output and returns how many were written
+size_t FormatDecimal(uint64_t value, char *output);
+
+// Writes the hex digits of value to output, without a prefix, and returns how many were written
+size_t FormatHex(uint64_t value, bool upperCase, char *output);
+
+// Formats many values per call, each followed by separator, and returns the characters written
+// The output must have room for count * (integer_format_max_length + 1) characters
+size_t FormatDecimalBatch(const uint64_t *values, size_t count, char separator, char *output);
+size_t FormatSignedDecimalBatch(const int64_t *values, size_t count, char separator, char *output);
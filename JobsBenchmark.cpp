@@ -0,0 +1,196 @@
+#include "Benchmark.h"
+#include "VulkanCompute.h"
+#include "AllocationTracking.h"
+#include "ComputeCoroutines.h"
+#include "ComputeJobs.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#define RETURN_ON_BAD_RESULT(result) { const VkResult checkedResult = (result); if (VK_SUCCESS != checkedResult) { return checkedResult; } }
+
+// Runs count jobs of the shader on the runner and waits for all of them
+static VkResult RunJobs(ComputeJobRunner &jobRunner, const std::vector<uint32_t> &shaderCode, uint32_t count)
+{
+    ComputeJob job;
+    job.shaderCode = &shaderCode;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        jobRunner.Submit(job);
+    }
+
+    return jobRunner.WaitIdle();
+}
+
+// Awaits one dispatch of the job
+static DispatchTask AwaitJob(DispatchEventLoop &loop, const ComputeJob &job)
+{
+    co_await loop.Dispatch(job);
+}
+
+// Runs count jobs of the shader as coroutines of the loop, all in flight at once from this thread
+static VkResult RunCoroutineJobs(DispatchEventLoop &loop, const std::vector<uint32_t> &shaderCode, uint32_t count)
+{
+    ComputeJob job;
+    job.shaderCode = &shaderCode;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        loop.Spawn(AwaitJob(loop, job));
+    }
+
+    return loop.Run();
+}
+
+// Sets up a device and runs --iterations jobs for each worker count, doubling up to --threads
+static VkResult RunJobSweep(const BenchmarkOptions &options)
+{
+    if (!VerifyInstanceLayers() || !VerifyInstanceExtensions())
+    {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    VkInstance instance = {};
+    RETURN_ON_BAD_RESULT(CreateHeadlessVulkanInstance(instance));
+
+    VkDebugUtilsMessengerEXT debugMessenger = {};
+    RETURN_ON_BAD_RESULT(CreateDebugMessenger(instance, &debugMessenger));
+
+    VkDebugReportCallbackEXT reportCallback = {};
+    RETURN_ON_BAD_RESULT(CreateReportCallback(instance, &reportCallback));
+
+    VkPhysicalDevice *physicalDevices = nullptr;
+    uint32_t physicalDeviceCount = 0;
+    RETURN_ON_BAD_RESULT(EnumerateDevices(instance, physicalDevices, physicalDeviceCount));
+
+    VkPhysicalDevice physicalDevice = {};
+    const VkResult selectResult = SelectPhysicalDevice(physicalDevices, physicalDeviceCount, options.deviceName, physicalDevice);
+    free(physicalDevices);
+    RETURN_ON_BAD_RESULT(selectResult);
+
+    uint32_t queueFamilyIndex = 0;
+    RETURN_ON_BAD_RESULT(GetBestComputeQueue(physicalDevice, queueFamilyIndex));
+
+    QuerySupport querySupport = {};
+    GetQuerySupport(physicalDevice, queueFamilyIndex, querySupport);
+
+    VkDevice device = {};
+    RETURN_ON_BAD_RESULT(CreateDevice(physicalDevice, queueFamilyIndex, querySupport, device));
+
+    const std::vector<uint32_t> shaderCode = readFile(options.shaderPath);
+
+    uint32_t maximumWorkers = options.threads;
+    if (0 == maximumWorkers)
+    {
+        maximumWorkers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    maximumWorkers = std::min(maximumWorkers, printf_capture_slots);
+
+    std::vector<uint32_t> workerCounts;
+    for (uint32_t workerCount = 1; workerCount < maximumWorkers; workerCount *= 2)
+    {
+        workerCounts.push_back(workerCount);
+    }
+    workerCounts.push_back(maximumWorkers);
+
+    printf("%8s %14s %10s\n", "workers", "dispatches/s", "speedup");
+
+    double singleWorkerRate = 0.0;
+    VkResult result = VK_SUCCESS;
+    for (size_t i = 0; VK_SUCCESS == result && i < workerCounts.size(); i++)
+    {
+        const uint32_t workerCount = workerCounts[i];
+
+        ComputeJobRunner jobRunner;
+        result = jobRunner.Start(device, queueFamilyIndex, querySupport, workerCount);
+
+        if (VK_SUCCESS == result)
+        {
+            result = RunJobs(jobRunner, shaderCode, options.warmupIterations);
+        }
+
+        if (VK_SUCCESS == result)
+        {
+            const BenchmarkClock::time_point start = BenchmarkClock::now();
+            result = RunJobs(jobRunner, shaderCode, options.iterations);
+            const double seconds = std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+
+            const double rate = options.iterations / seconds;
+            if (0 == i)
+            {
+                singleWorkerRate = rate;
+            }
+
+            printf("%8u %14.1f %9.2fx\n", workerCount, rate, rate / singleWorkerRate);
+            fflush(stdout);
+        }
+
+        jobRunner.Stop();
+    }
+
+    // Then on the coroutine event loop, one thread waiting on every fence in flight
+    if (VK_SUCCESS == result)
+    {
+        ComputeQueueTarget target;
+        target.device = device;
+        target.queueFamilyIndex = queueFamilyIndex;
+        target.querySupport = querySupport;
+
+        DispatchEventLoop loop;
+        result = loop.Initialize(target);
+
+        if (VK_SUCCESS == result)
+        {
+            result = RunCoroutineJobs(loop, shaderCode, options.warmupIterations);
+        }
+
+        if (VK_SUCCESS == result)
+        {
+            const BenchmarkClock::time_point start = BenchmarkClock::now();
+            result = RunCoroutineJobs(loop, shaderCode, options.iterations);
+            const double seconds = std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+
+            const double rate = options.iterations / seconds;
+            printf("%8s %14.1f %9.2fx\n", "loop", rate, rate / singleWorkerRate);
+            fflush(stdout);
+        }
+
+        loop.Destroy();
+    }
+
+    vkDeviceWaitIdle(device);
+    vkDestroyDevice(device, GetVulkanAllocator());
+
+    DestroyDebugMessenger(instance, debugMessenger);
+    DestroyReportCallback(instance, reportCallback);
+
+    vkDestroyInstance(instance, nullptr);
+
+    return result;
+}
+
+#undef RETURN_ON_BAD_RESULT
+
+// Measures the dispatch throughput of a job runner as its worker count doubles, each worker
+// recording and waiting on its own while the submissions share the queue
+int RunJobsBenchmark(const BenchmarkOptions &options)
+{
+    // The results are printed with printf, the callbacks would flood the console otherwise
+    NullStreamBuffer nullStreamBuffer;
+    std::streambuf *const coutStreamBuffer = std::cout.rdbuf(&nullStreamBuffer);
+
+    const VkResult result = RunJobSweep(options);
+
+    std::cout.rdbuf(coutStreamBuffer);
+
+    if (VK_SUCCESS != result)
+    {
+        fprintf(stderr, "Jobs benchmark failed with VkResult %d\n", static_cast<int>(result));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
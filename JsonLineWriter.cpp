@@ -0,0 +1,290 @@
+#include "JsonLineWriter.h"
+#include "IntegerFormat.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define JSON_LINE_WRITER_SSE2 true
+#include <emmintrin.h>
+#else
+#define JSON_LINE_WRITER_SSE2 false
+#endif
+
+// The longest number or literal written in one piece: a double's shortest form is at most 24
+// characters, and the escape of one character is six
+static const size_t json_max_token_length = 32;
+
+JsonLineWriter::JsonLineWriter(size_t capacity) : buffer(capacity > json_max_token_length ? capacity : json_max_token_length)
+{
+}
+
+void JsonLineWriter::Reserve(size_t length)
+{
+    if (used + length > buffer.size())
+    {
+        Flush();
+    }
+}
+
+void JsonLineWriter::Append(const char *data, size_t length)
+{
+    if (used + length <= buffer.size())
+    {
+        memcpy(buffer.data() + used, data, length);
+        used += length;
+        return;
+    }
+
+    // Strings longer than the space left are copied in pieces, flushing the buffer whenever it fills up
+    while (length > 0)
+    {
+        Reserve(1);
+
+        const size_t space = buffer.size() - used;
+        const size_t count = length < space ? length : space;
+        memcpy(buffer.data() + used, data, count);
+
+        used += count;
+        data += count;
+        length -= count;
+    }
+}
+
+static inline bool NeedsJsonEscape(unsigned char character)
+{
+    return character < 0x20 || '"' == character || '\\' == character;
+}
+
+// Returns the index of the first character that needs escaping, or length if there is none
+static size_t FindJsonEscape(const char *value, size_t length)
+{
+    size_t i = 0;
+
+#if JSON_LINE_WRITER_SSE2
+    // Sixteen characters at a time: control characters are those equal to their minimum with 0x1f
+    const __m128i control = _mm_set1_epi8(0x1f);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i characters = _mm_loadu_si128(reinterpret_cast<const __m128i *>(value + i));
+        const __m128i escapes = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(characters, control), characters),
+            _mm_or_si128(_mm_cmpeq_epi8(characters, quote), _mm_cmpeq_epi8(characters, backslash)));
+
+        const int mask = _mm_movemask_epi8(escapes);
+        if (0 != mask)
+        {
+            while (0 == (mask & (1 << (i & 15))))
+            {
+                i++;
+            }
+            return i;
+        }
+    }
+#endif
+
+    while (i < length && !NeedsJsonEscape(static_cast<unsigned char>(value[i])))
+    {
+        i++;
+    }
+
+    return i;
+}
+
+void JsonLineWriter::AppendEscaped(const char *value, size_t length)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+
+    // Characters that need no escaping are copied a run at a time
+    size_t position = FindJsonEscape(value, length);
+    Append(value, position);
+
+    while (position < length)
+    {
+        const unsigned char character = static_cast<unsigned char>(value[position++]);
+
+        Reserve(6);
+        char *const escape = buffer.data() + used;
+        escape[0] = '\\';
+
+        switch (character)
+        {
+            case '"': escape[1] = '"'; used += 2; break;
+            case '\\': escape[1] = '\\'; used += 2; break;
+            case '\n': escape[1] = 'n'; used += 2; break;
+            case '\r': escape[1] = 'r'; used += 2; break;
+            case '\t': escape[1] = 't'; used += 2; break;
+            default:
+            {
+                escape[1] = 'u';
+                escape[2] = '0';
+                escape[3] = '0';
+                escape[4] = hex_digits[character >> 4];
+                escape[5] = hex_digits[character & 0xf];
+                used += 6;
+                break;
+            }
+        }
+
+        const size_t run = FindJsonEscape(value + position, length - position);
+        Append(value + position, run);
+        position += run;
+    }
+}
+
+void JsonLineWriter::BeginValue()
+{
+    if (needsComma)
+    {
+        Reserve(1);
+        buffer[used++] = ',';
+    }
+
+    needsComma = true;
+}
+
+void JsonLineWriter::BeginObject()
+{
+    BeginValue();
+    Reserve(1);
+    buffer[used++] = '{';
+    needsComma = false;
+}
+
+void JsonLineWriter::EndObject()
+{
+    Reserve(1);
+    buffer[used++] = '}';
+    needsComma = true;
+}
+
+void JsonLineWriter::BeginArray()
+{
+    BeginValue();
+    Reserve(1);
+    buffer[used++] = '[';
+    needsComma = false;
+}
+
+void JsonLineWriter::EndArray()
+{
+    Reserve(1);
+    buffer[used++] = ']';
+    needsComma = true;
+}
+
+void JsonLineWriter::Key(const char *name)
+{
+    BeginValue();
+
+    const size_t length = strlen(name);
+    Reserve(length + 3);
+    buffer[used++] = '"';
+    memcpy(buffer.data() + used, name, length);
+    used += length;
+    buffer[used++] = '"';
+    buffer[used++] = ':';
+
+    needsComma = false;
+}
+
+void JsonLineWriter::String(const char *value)
+{
+    String(value, strlen(value));
+}
+
+void JsonLineWriter::String(const char *value, size_t length)
+{
+    BeginValue();
+
+    Reserve(1);
+    buffer[used++] = '"';
+    AppendEscaped(value, length);
+    Reserve(1);
+    buffer[used++] = '"';
+}
+
+void JsonLineWriter::Int(int64_t value)
+{
+    BeginValue();
+    Reserve(json_max_token_length);
+
+    if (value < 0)
+    {
+        buffer[used++] = '-';
+    }
+
+    used += FormatDecimal(value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value), buffer.data() + used);
+}
+
+void JsonLineWriter::Uint(uint64_t value)
+{
+    BeginValue();
+    Reserve(json_max_token_length);
+    used += FormatDecimal(value, buffer.data() + used);
+}
+
+void JsonLineWriter::Double(double value)
+{
+    if (!std::isfinite(value))
+    {
+        String(std::isnan(value) ? "nan" : (value < 0.0 ? "-inf" : "inf"));
+        return;
+    }
+
+    BeginValue();
+    Reserve(json_max_token_length);
+    used = static_cast<size_t>(std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value).ptr - buffer.data());
+}
+
+void JsonLineWriter::Float(float value)
+{
+    if (!std::isfinite(value))
+    {
+        Double(value);
+        return;
+    }
+
+    BeginValue();
+    Reserve(json_max_token_length);
+    used = static_cast<size_t>(std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value).ptr - buffer.data());
+}
+
+void JsonLineWriter::Bool(bool value)
+{
+    BeginValue();
+    Append(value ? "true" : "false", value ? 4 : 5);
+}
+
+void JsonLineWriter::Null()
+{
+    BeginValue();
+    Append("null", 4);
+}
+
+void JsonLineWriter::EndLine()
+{
+    Reserve(1);
+    buffer[used++] = '\n';
+    needsComma = false;
+}
+
+void JsonLineWriter::Flush()
+{
+    if (0 == used)
+    {
+        return;
+    }
+
+    std::streambuf *const destination = nullptr != output ? output : std::cout.rdbuf();
+    if (nullptr != destination)
+    {
+        destination->sputn(buffer.data(), static_cast<std::streamsize>(used));
+        destination->pubsync();
+    }
+
+    used = 0;
+}
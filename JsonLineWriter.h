@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <vector>
+
+// A streaming JSON encoder that writes one object per line (JSON Lines) into a buffer it
+// allocates once, and passes the buffer to a stream buffer only when it is full or flushed.
+// Encoding never allocates, so it can run in the Vulkan callbacks. The writer does no
+// locking, callers that share one must serialize their use of it.
+class JsonLineWriter
+{
+public:
+    explicit JsonLineWriter(size_t capacity);
+
+    // The stream buffer the lines are flushed to, std::cout's at the time of the flush when nullptr
+    void SetOutput(std::streambuf *output) { this->output = output; }
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+
+    // Writes the key of the next member of an object, the value follows with one of the calls below
+    // Keys are written as they are, they must not contain characters that JSON escapes
+    void Key(const char *name);
+
+    void String(const char *value);
+    void String(const char *value, size_t length);
+    void Int(int64_t value);
+    void Uint(uint64_t value);
+
+    // Written with the fewest digits that parse back to the same value. JSON has no infinity
+    // or NaN, they are written as the strings "inf", "-inf" and "nan".
+    void Double(double value);
+    void Float(float value);
+
+    void Bool(bool value);
+    void Null();
+
+    // Ends the current line, which should hold one complete top level value
+    void EndLine();
+
+    // Writes everything buffered to the output
+    void Flush();
+
+private:
+    // Flushes unless length more characters fit
+    void Reserve(size_t length);
+    void Append(const char *data, size_t length);
+    void AppendEscaped(const char *value, size_t length);
+
+    // Writes the comma that separates a value from the one before it
+    void BeginValue();
+
+    std::vector<char> buffer;
+    size_t used = 0;
+    bool needsComma = false;
+    std::streambuf *output = nullptr;
+};
@@ -0,0 +1,145 @@
+#include "LatencyHistogram.h"
+#include <cstdio>
+
+// Returns the index of the highest set bit of a non-zero value
+static uint32_t GetHighestBit(uint64_t value)
+{
+    uint32_t bit = 0;
+    for (uint32_t shift = 32; 0 != shift; shift /= 2)
+    {
+        if (0 != (value >> shift))
+        {
+            value >>= shift;
+            bit += shift;
+        }
+    }
+
+    return bit;
+}
+
+// Values below latency_histogram_sub_buckets have a bucket each. Above that, a value is
+// shifted right until it has latency_histogram_sub_bucket_bits significant bits, and the
+// shift selects the half-sized group of buckets its top bits are counted in
+static uint32_t GetBucketIndex(uint64_t value)
+{
+    if (value < latency_histogram_sub_buckets)
+    {
+        return static_cast<uint32_t>(value);
+    }
+
+    const uint32_t shift = GetHighestBit(value) - (latency_histogram_sub_bucket_bits - 1);
+    const uint32_t halfSubBuckets = latency_histogram_sub_buckets / 2;
+
+    return latency_histogram_sub_buckets + (shift - 1) * halfSubBuckets + static_cast<uint32_t>(value >> shift) - halfSubBuckets;
+}
+
+// Returns the highest value counted in a bucket
+static uint64_t GetBucketHighestValue(uint32_t index)
+{
+    if (index < latency_histogram_sub_buckets)
+    {
+        return index;
+    }
+
+    const uint32_t halfSubBuckets = latency_histogram_sub_buckets / 2;
+    const uint32_t shift = (index - latency_histogram_sub_buckets) / halfSubBuckets + 1;
+    const uint64_t subBucket = (index - latency_histogram_sub_buckets) % halfSubBuckets + halfSubBuckets;
+
+    return ((subBucket + 1) << shift) - 1;
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    Reset();
+}
+
+void LatencyHistogram::Record(uint64_t nanoseconds)
+{
+    counts[GetBucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    totalCount.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    uint64_t current = minimum.load(std::memory_order_relaxed);
+    while (nanoseconds < current && !minimum.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed))
+    {
+    }
+
+    current = maximum.load(std::memory_order_relaxed);
+    while (nanoseconds > current && !maximum.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::Reset()
+{
+    for (std::atomic<uint64_t> &count : counts)
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+
+    totalCount.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    minimum.store(UINT64_MAX, std::memory_order_relaxed);
+    maximum.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const
+{
+    return totalCount.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetMinimum() const
+{
+    return 0 != GetCount() ? minimum.load(std::memory_order_relaxed) : 0;
+}
+
+uint64_t LatencyHistogram::GetMaximum() const
+{
+    return maximum.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::GetMean() const
+{
+    const uint64_t count = GetCount();
+    return 0 != count ? static_cast<double>(sum.load(std::memory_order_relaxed)) / count : 0.0;
+}
+
+uint64_t LatencyHistogram::GetValueAtPercentile(double percentile) const
+{
+    // Records that land while the buckets are being walked are simply not seen yet
+    const uint64_t count = GetCount();
+    if (0 == count)
+    {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * count + 0.5);
+    rank = rank < 1 ? 1 : rank;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < latency_histogram_bucket_count; i++)
+    {
+        seen += counts[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            const uint64_t value = GetBucketHighestValue(i);
+            return value < GetMaximum() ? value : GetMaximum();
+        }
+    }
+
+    return GetMaximum();
+}
+
+void PrintLatencyHistogramHeader()
+{
+    printf("%-24s %10s %10s %10s %10s %10s %10s %10s %10s\n", "Latency (us)", "Count", "Min", "Mean", "p50", "p90", "p99", "p99.9", "Max");
+}
+
+void PrintLatencyHistogram(const char *name, const LatencyHistogram &histogram)
+{
+    printf("%-24s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", name, static_cast<unsigned long long>(histogram.GetCount()),
+        histogram.GetMinimum() / 1000.0, histogram.GetMean() / 1000.0,
+        histogram.GetValueAtPercentile(50.0) / 1000.0, histogram.GetValueAtPercentile(90.0) / 1000.0,
+        histogram.GetValueAtPercentile(99.0) / 1000.0, histogram.GetValueAtPercentile(99.9) / 1000.0,
+        histogram.GetMaximum() / 1000.0);
+}
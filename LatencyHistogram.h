@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// A high dynamic range histogram of latencies in nanoseconds, in the style of HdrHistogram.
+// Values are counted in log-linear buckets: every power of two range is split into
+// latency_histogram_sub_buckets / 2 linear buckets, so any value from 1 ns to the full
+// 64-bit range is kept within 1% of its true value. Record() is lock-free and may be
+// called from any number of threads while another thread reads the histogram.
+static const uint32_t latency_histogram_sub_bucket_bits = 8;
+static const uint32_t latency_histogram_sub_buckets = 1u << latency_histogram_sub_bucket_bits;
+static const uint32_t latency_histogram_bucket_count = latency_histogram_sub_buckets + (64 - latency_histogram_sub_bucket_bits) * (latency_histogram_sub_buckets / 2);
+
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    void Record(uint64_t nanoseconds);
+    void Reset();
+
+    uint64_t GetCount() const;
+    uint64_t GetMinimum() const;
+    uint64_t GetMaximum() const;
+    double GetMean() const;
+
+    // Returns the highest value equivalent to the recorded value at the percentile (0-100)
+    uint64_t GetValueAtPercentile(double percentile) const;
+
+private:
+    std::atomic<uint64_t> counts[latency_histogram_bucket_count];
+    std::atomic<uint64_t> totalCount;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> minimum;
+    std::atomic<uint64_t> maximum;
+};
+
+// Prints the column names of PrintLatencyHistogram, the values are in microseconds
+void PrintLatencyHistogramHeader();
+void PrintLatencyHistogram(const char *name, const LatencyHistogram &histogram);
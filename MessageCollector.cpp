@@ -0,0 +1,210 @@
+#include "MessageCollector.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The size a thread's buffer grows to before its thread flushes
+static const size_t message_collector_flush_size = 64 * 1024;
+
+// Where a line is in the text of a buffer
+struct CollectedLine
+{
+    uint64_t sequence = 0;
+    uint32_t offset = 0;
+    uint32_t length = 0;
+};
+
+// The lines of one thread. Buffers are never freed, the list only grows up to the most threads
+// that collected lines at once.
+struct ThreadLines
+{
+    // Guards text and lines, which the flush swaps with flushText and flushLines
+    std::mutex mutex;
+    std::string text;
+    std::vector<CollectedLine> lines;
+
+    // Only used by the flush, kept to reuse their capacity
+    std::string flushText;
+    std::vector<CollectedLine> flushLines;
+
+    // Set while a thread owns the buffer
+    std::atomic<bool> claimed{ true };
+
+    ThreadLines *next = nullptr;
+};
+
+static std::atomic<ThreadLines *> threadLinesHead(nullptr);
+static std::atomic<uint64_t> nextLineSequence(0);
+
+// Releases the thread's buffer when the thread exits, for a later thread to take over
+struct ThreadLinesOwner
+{
+    ThreadLines *threadLines = nullptr;
+
+    ~ThreadLinesOwner()
+    {
+        if (nullptr != threadLines)
+        {
+            threadLines->claimed.store(false, std::memory_order_release);
+        }
+    }
+};
+
+static thread_local ThreadLinesOwner threadLinesOwner;
+
+// Returns the buffer of the calling thread, taking over a released one or adding a new one to the list
+static ThreadLines &GetThreadLines()
+{
+    if (nullptr != threadLinesOwner.threadLines)
+    {
+        return *threadLinesOwner.threadLines;
+    }
+
+    for (ThreadLines *threadLines = threadLinesHead.load(std::memory_order_acquire); nullptr != threadLines; threadLines = threadLines->next)
+    {
+        bool claimed = false;
+        if (threadLines->claimed.compare_exchange_strong(claimed, true, std::memory_order_acquire))
+        {
+            threadLinesOwner.threadLines = threadLines;
+            return *threadLines;
+        }
+    }
+
+    ThreadLines *const threadLines = new ThreadLines;
+    threadLines->next = threadLinesHead.load(std::memory_order_relaxed);
+    while (!threadLinesHead.compare_exchange_weak(threadLines->next, threadLines, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+
+    threadLinesOwner.threadLines = threadLines;
+    return *threadLines;
+}
+
+// Serializes the flushes, and guards the members below it
+static std::mutex flushMutex;
+
+// The lines held back by the last flush, and the ones of the flush in progress
+static std::string heldText;
+static std::vector<CollectedLine> heldLines;
+static std::string nextHeldText;
+static std::vector<CollectedLine> nextHeldLines;
+
+// The sequence number of the next line to write
+static uint64_t nextWrittenSequence = 0;
+
+// A line of any of the swapped out buffers, in the merge of a flush
+struct MergedLine
+{
+    uint64_t sequence;
+    const char *text;
+    uint32_t length;
+};
+
+static std::vector<MergedLine> mergedLines;
+static std::string flushOutput;
+
+// Adds the lines of a buffer to the merge
+static void AddMergedLines(const std::string &text, const std::vector<CollectedLine> &lines)
+{
+    for (const CollectedLine &line : lines)
+    {
+        mergedLines.push_back({ line.sequence, text.data() + line.offset, line.length });
+    }
+}
+
+// Merges and writes the lines of every buffer, flushMutex must be held
+static void FlushLocked()
+{
+    mergedLines.clear();
+    AddMergedLines(heldText, heldLines);
+
+    for (ThreadLines *threadLines = threadLinesHead.load(std::memory_order_acquire); nullptr != threadLines; threadLines = threadLines->next)
+    {
+        threadLines->flushText.clear();
+        threadLines->flushLines.clear();
+        {
+            std::lock_guard<std::mutex> lock(threadLines->mutex);
+            threadLines->text.swap(threadLines->flushText);
+            threadLines->lines.swap(threadLines->flushLines);
+        }
+
+        AddMergedLines(threadLines->flushText, threadLines->flushLines);
+    }
+
+    // The lines of each buffer are already in order, the sort only interleaves them
+    std::sort(mergedLines.begin(), mergedLines.end(), [](const MergedLine &a, const MergedLine &b) { return a.sequence < b.sequence; });
+
+    flushOutput.clear();
+    nextHeldText.clear();
+    nextHeldLines.clear();
+
+    for (const MergedLine &line : mergedLines)
+    {
+        if (line.sequence == nextWrittenSequence && nextHeldLines.empty())
+        {
+            flushOutput.append(line.text, line.length);
+            flushOutput += '\n';
+            nextWrittenSequence++;
+        }
+        else
+        {
+            nextHeldLines.push_back({ line.sequence, static_cast<uint32_t>(nextHeldText.size()), line.length });
+            nextHeldText.append(line.text, line.length);
+        }
+    }
+
+    heldText.swap(nextHeldText);
+    heldLines.swap(nextHeldLines);
+
+    if (flushOutput.empty())
+    {
+        return;
+    }
+
+    std::streambuf *const destination = std::cout.rdbuf();
+    if (nullptr != destination)
+    {
+        destination->sputn(flushOutput.data(), static_cast<std::streamsize>(flushOutput.size()));
+        destination->pubsync();
+    }
+}
+
+void CollectLine(const char *text, size_t length)
+{
+    ThreadLines &threadLines = GetThreadLines();
+
+    bool full = false;
+    {
+        std::lock_guard<std::mutex> lock(threadLines.mutex);
+
+        // The number is taken under the lock, so a flush that swaps the buffer out after it sees the line
+        CollectedLine line;
+        line.sequence = nextLineSequence.fetch_add(1, std::memory_order_relaxed);
+        line.offset = static_cast<uint32_t>(threadLines.text.size());
+        line.length = static_cast<uint32_t>(length);
+
+        threadLines.text.append(text, length);
+        threadLines.lines.push_back(line);
+
+        full = threadLines.text.size() >= message_collector_flush_size;
+    }
+
+    if (full)
+    {
+        std::unique_lock<std::mutex> lock(flushMutex, std::try_to_lock);
+        if (lock.owns_lock())
+        {
+            FlushLocked();
+        }
+    }
+}
+
+void FlushCollectedLines()
+{
+    std::lock_guard<std::mutex> lock(flushMutex);
+    FlushLocked();
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+// Collects the lines the callbacks write from any thread, and writes them to std::cout whole and
+// in the order they were collected, without a lock shared by the writing threads.
+//
+// Each thread gets a buffer of its own the first time it collects a line. The buffers are kept on
+// a lock-free list for the whole process, and a buffer whose thread has exited is taken over by
+// the next new thread. Collecting a line takes its sequence number from one atomic counter and
+// appends the line to the thread's buffer, under a lock of that buffer that only a flush contends
+// for. A flush swaps out every buffer, merges their lines by sequence number, and writes the lines
+// up to the first number that is missing. That line was numbered but not yet in its buffer when
+// the buffer was swapped out, so it and the lines after it are held back for the next flush.
+
+// Collects one line, without its newline. A thread whose buffer has grown past
+// message_collector_flush_size flushes, unless another thread is already flushing.
+void CollectLine(const char *text, size_t length);
+
+// Writes every line collected so far to std::cout's stream buffer at the time of the flush,
+// except any held back as above. Flushes are serialized with each other only.
+void FlushCollectedLines();
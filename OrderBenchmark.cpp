@@ -0,0 +1,122 @@
+#include "Benchmark.h"
+#include "PrintfRecord.h"
+#include "RadixSort.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+// Times one way of ordering the keys and prints its row. The keys are restored from arrival
+// before every run, outside the timed part, since every run sorts them in place.
+template <typename Sort>
+static void MeasureSort(const BenchmarkOptions &options, const char *name, const std::vector<uint64_t> &arrival, std::vector<uint64_t> &keys, Sort sort)
+{
+    std::vector<double> samples;
+    for (uint32_t i = 0; i < options.warmupIterations + options.iterations; i++)
+    {
+        keys = arrival;
+
+        const BenchmarkClock::time_point start = BenchmarkClock::now();
+        sort(keys);
+        const double nanoseconds = std::chrono::duration<double, std::nano>(BenchmarkClock::now() - start).count();
+
+        if (i >= options.warmupIterations)
+        {
+            samples.push_back(nanoseconds / arrival.size());
+        }
+    }
+
+    PrintStatisticsRow(name, ComputeSampleStatistics(samples));
+}
+
+// Sorts --records printf keys by invocation the way --order=invocation does, with the radix sort
+// on one thread and on every hardware thread, against std::stable_sort and against a plain copy
+// of the keys, which is the memory bandwidth bound of one pass
+int RunOrderBenchmark(const BenchmarkOptions &options)
+{
+    if (0 == options.records)
+    {
+        fprintf(stderr, "The order benchmark needs at least one record\n");
+        return EXIT_FAILURE;
+    }
+
+    // The layer reads the messages back roughly in the order subgroups of 32 invocations wrote
+    // them, so the invocations arrive in runs of 32 that are shuffled among each other
+    static const uint32_t subgroup_size = 32;
+
+    std::vector<uint32_t> subgroups((options.records + subgroup_size - 1) / subgroup_size);
+    for (uint32_t i = 0; i < subgroups.size(); i++)
+    {
+        subgroups[i] = i;
+    }
+    std::shuffle(subgroups.begin(), subgroups.end(), std::mt19937(12345));
+
+    std::vector<uint64_t> arrival;
+    arrival.reserve(options.records);
+    for (uint32_t subgroup : subgroups)
+    {
+        for (uint32_t invocation = subgroup * subgroup_size; invocation < (subgroup + 1) * subgroup_size && invocation < options.records; invocation++)
+        {
+            arrival.push_back((static_cast<uint64_t>(invocation) << 32) | arrival.size());
+        }
+    }
+
+    const uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<uint64_t> keys;
+    std::vector<uint64_t> scratch(arrival.size());
+
+    printf("Order benchmark: %u records in runs of %u invocations\n", options.records, subgroup_size);
+    PrintStatisticsHeader("ns per record");
+
+    MeasureSort(options, "copy (one pass)", arrival, keys, [&](std::vector<uint64_t> &sorted)
+    {
+        memcpy(scratch.data(), sorted.data(), sorted.size() * sizeof(uint64_t));
+    });
+
+    MeasureSort(options, "radix sort, 1 thread", arrival, keys, [&](std::vector<uint64_t> &sorted)
+    {
+        RadixSortByUpperWord(sorted, scratch, 1);
+    });
+
+    if (threadCount > 1)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "radix sort, %u threads", threadCount);
+        MeasureSort(options, name, arrival, keys, [&](std::vector<uint64_t> &sorted)
+        {
+            RadixSortByUpperWord(sorted, scratch, threadCount);
+        });
+    }
+
+    MeasureSort(options, "std::stable_sort", arrival, keys, [&](std::vector<uint64_t> &sorted)
+    {
+        std::stable_sort(sorted.begin(), sorted.end(), [](uint64_t a, uint64_t b) { return (a >> 32) < (b >> 32); });
+    });
+
+    // The whole cost of the mode, gathering the keys from the records included
+    std::vector<PrintfRecord> records(arrival.size());
+    for (size_t i = 0; i < arrival.size(); i++)
+    {
+        records[i].invocation = static_cast<uint32_t>(arrival[i] >> 32);
+    }
+
+    std::vector<uint32_t> order;
+    MeasureSort(options, "OrderPrintfRecordsByInvocation", arrival, keys, [&](std::vector<uint64_t> &)
+    {
+        OrderPrintfRecordsByInvocation(records, order);
+    });
+
+    for (size_t i = 1; i < order.size(); i++)
+    {
+        if (records[order[i - 1]].invocation > records[order[i]].invocation)
+        {
+            fprintf(stderr, "OrderPrintfRecordsByInvocation left record %zu out of order\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,216 @@
+#include "Benchmark.h"
+#include "VulkanCompute.h"
+#include "AllocationTracking.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+// Each step of the setup and dispatch path in main() and RunComputeShader(), timed separately
+enum BenchmarkPhase
+{
+    PHASE_VERIFY_INSTANCE_LAYERS,
+    PHASE_VERIFY_INSTANCE_EXTENSIONS,
+    PHASE_CREATE_INSTANCE,
+    PHASE_CREATE_MESSENGERS,
+    PHASE_ENUMERATE_DEVICES,
+    PHASE_GET_COMPUTE_QUEUE,
+    PHASE_CREATE_DEVICE,
+    PHASE_READ_FILE,
+    PHASE_CREATE_SHADER_MODULE,
+    PHASE_CREATE_PIPELINE,
+    PHASE_RECORD,
+    PHASE_SUBMIT,
+    PHASE_WAIT,
+    PHASE_READ_QUERIES,
+    PHASE_TEARDOWN,
+    PHASE_COUNT
+};
+
+static const char *const phaseNames[PHASE_COUNT] = {
+    "VerifyInstanceLayers",
+    "VerifyInstanceExtensions",
+    "CreateHeadlessVulkanInstance",
+    "CreateDebugMessenger+Report",
+    "EnumerateDevices",
+    "GetBestComputeQueue",
+    "CreateDevice",
+    "readFile",
+    "CreateComputeShaderModule",
+    "CreateComputePipeline",
+    "RecordComputeDispatch",
+    "SubmitComputeDispatch",
+    "WaitForComputeDispatch",
+    "ReportComputeDispatch",
+    "Teardown"
+};
+
+#define RETURN_ON_BAD_RESULT(result) { const VkResult checkedResult = (result); if (VK_SUCCESS != checkedResult) { return checkedResult; } }
+
+// Runs the whole setup, dispatch and teardown path once, appending the time of each phase to samples
+static VkResult RunPhaseIteration(const BenchmarkOptions &options, std::vector<double> (&samples)[PHASE_COUNT])
+{
+    {
+        PhaseTimer timer(samples[PHASE_VERIFY_INSTANCE_LAYERS]);
+        if (!VerifyInstanceLayers())
+        {
+            return VK_ERROR_EXTENSION_NOT_PRESENT;
+        }
+    }
+
+    {
+        PhaseTimer timer(samples[PHASE_VERIFY_INSTANCE_EXTENSIONS]);
+        if (!VerifyInstanceExtensions())
+        {
+            return VK_ERROR_EXTENSION_NOT_PRESENT;
+        }
+    }
+
+    VkInstance instance = {};
+    {
+        PhaseTimer timer(samples[PHASE_CREATE_INSTANCE]);
+        RETURN_ON_BAD_RESULT(CreateHeadlessVulkanInstance(instance));
+    }
+
+    VkDebugUtilsMessengerEXT debugMessenger = {};
+    VkDebugReportCallbackEXT reportCallback = {};
+    {
+        PhaseTimer timer(samples[PHASE_CREATE_MESSENGERS]);
+        RETURN_ON_BAD_RESULT(CreateDebugMessenger(instance, &debugMessenger));
+        RETURN_ON_BAD_RESULT(CreateReportCallback(instance, &reportCallback));
+    }
+
+    VkPhysicalDevice physicalDevice = {};
+    {
+        PhaseTimer timer(samples[PHASE_ENUMERATE_DEVICES]);
+
+        VkPhysicalDevice *physicalDevices = nullptr;
+        uint32_t physicalDeviceCount = 0;
+        RETURN_ON_BAD_RESULT(EnumerateDevices(instance, physicalDevices, physicalDeviceCount));
+
+        const VkResult result = SelectPhysicalDevice(physicalDevices, physicalDeviceCount, options.deviceName, physicalDevice);
+        free(physicalDevices);
+        RETURN_ON_BAD_RESULT(result);
+    }
+
+    uint32_t queueFamilyIndex = 0;
+    QuerySupport querySupport = {};
+    {
+        PhaseTimer timer(samples[PHASE_GET_COMPUTE_QUEUE]);
+        RETURN_ON_BAD_RESULT(GetBestComputeQueue(physicalDevice, queueFamilyIndex));
+        GetQuerySupport(physicalDevice, queueFamilyIndex, querySupport);
+    }
+
+    VkDevice device = {};
+    {
+        PhaseTimer timer(samples[PHASE_CREATE_DEVICE]);
+        RETURN_ON_BAD_RESULT(CreateDevice(physicalDevice, queueFamilyIndex, querySupport, device));
+    }
+
+    std::vector<uint32_t> shaderCode;
+    {
+        PhaseTimer timer(samples[PHASE_READ_FILE]);
+        shaderCode = readFile(options.shaderPath);
+    }
+
+    ComputeDispatch dispatch = {};
+    {
+        PhaseTimer timer(samples[PHASE_CREATE_SHADER_MODULE]);
+        RETURN_ON_BAD_RESULT(CreateComputeShaderModule(device, shaderCode, dispatch));
+    }
+
+    {
+        PhaseTimer timer(samples[PHASE_CREATE_PIPELINE]);
+        RETURN_ON_BAD_RESULT(CreateComputePipeline(device, dispatch));
+    }
+
+    {
+        PhaseTimer timer(samples[PHASE_RECORD]);
+        RETURN_ON_BAD_RESULT(RecordComputeDispatch(device, queueFamilyIndex, querySupport, dispatch));
+    }
+
+    {
+        PhaseTimer timer(samples[PHASE_SUBMIT]);
+        RETURN_ON_BAD_RESULT(SubmitComputeDispatch(device, queueFamilyIndex, dispatch));
+    }
+
+    {
+        PhaseTimer timer(samples[PHASE_WAIT]);
+        RETURN_ON_BAD_RESULT(WaitForComputeDispatch(device, dispatch));
+    }
+
+    {
+        PhaseTimer timer(samples[PHASE_READ_QUERIES]);
+        RETURN_ON_BAD_RESULT(ReportComputeDispatch(device, querySupport, dispatch));
+    }
+
+    {
+        PhaseTimer timer(samples[PHASE_TEARDOWN]);
+
+        DestroyComputeDispatch(device, dispatch);
+        vkDestroyDevice(device, GetVulkanAllocator());
+
+        DestroyDebugMessenger(instance, debugMessenger);
+        DestroyReportCallback(instance, reportCallback);
+
+        vkDestroyInstance(instance, nullptr);
+    }
+
+    return VK_SUCCESS;
+}
+
+#undef RETURN_ON_BAD_RESULT
+
+// Times every phase of the setup and dispatch path over many iterations and prints their statistics
+// Each iteration creates and destroys everything, including the instance, so that the setup cost
+// of every phase is measured and not just the steady-state dispatch.
+int RunPhaseBenchmark(const BenchmarkOptions &options)
+{
+    std::vector<double> samples[PHASE_COUNT];
+    std::vector<double> warmupSamples[PHASE_COUNT];
+
+    for (std::vector<double> &phaseSamples : samples)
+    {
+        phaseSamples.reserve(options.iterations);
+    }
+
+    // The callbacks print every message, which would dominate the timings if it reached the console
+    NullStreamBuffer nullStreamBuffer;
+    std::streambuf *const coutStreamBuffer = std::cout.rdbuf(&nullStreamBuffer);
+
+    VkResult result = VK_SUCCESS;
+    for (uint32_t i = 0; i < options.warmupIterations && VK_SUCCESS == result; i++)
+    {
+        result = RunPhaseIteration(options, warmupSamples);
+    }
+
+    for (uint32_t i = 0; i < options.iterations && VK_SUCCESS == result; i++)
+    {
+        result = RunPhaseIteration(options, samples);
+    }
+
+    std::cout.rdbuf(coutStreamBuffer);
+
+    if (VK_SUCCESS != result)
+    {
+        fprintf(stderr, "Phase benchmark failed with VkResult %d\n", static_cast<int>(result));
+        return EXIT_FAILURE;
+    }
+
+    printf("Phase benchmark: %u iterations (%u warmup) of %s\n", options.iterations, options.warmupIterations, options.shaderPath.c_str());
+    PrintStatisticsHeader("microseconds");
+
+    std::vector<double> totals(options.iterations, 0.0);
+    for (uint32_t phase = 0; phase < PHASE_COUNT; phase++)
+    {
+        PrintStatisticsRow(phaseNames[phase], ComputeSampleStatistics(samples[phase]));
+
+        for (size_t i = 0; i < samples[phase].size(); i++)
+        {
+            totals[i] += samples[phase][i];
+        }
+    }
+
+    PrintStatisticsRow("Total", ComputeSampleStatistics(totals));
+
+    return EXIT_SUCCESS;
+}
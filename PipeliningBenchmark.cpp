@@ -0,0 +1,144 @@
+#include "Benchmark.h"
+#include "VulkanCompute.h"
+#include "AllocationTracking.h"
+#include "ComputePipelining.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+// The dispatches cycle through pipelining_threshold_count print thresholds, out of 65536, so each
+// one prints a different number of messages for the callbacks to decode
+static const uint32_t pipelining_threshold_step = 16;
+static const uint32_t pipelining_threshold_count = 4;
+
+#define RETURN_ON_BAD_RESULT(result) { const VkResult checkedResult = (result); if (VK_SUCCESS != checkedResult) { return checkedResult; } }
+
+// Dispatches the kernel count times with changing print thresholds, and reports every dispatch
+static VkResult RunPipelinedDispatches(PipelinedDispatcher &dispatcher, const std::vector<uint32_t> &shaderCode, uint32_t groupCount, uint32_t count)
+{
+    ComputeJob job;
+    job.shaderCode = &shaderCode;
+    job.groupCountX = groupCount;
+    job.pushConstantSize = sizeof(uint32_t);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        job.pushConstants[0] = (i % pipelining_threshold_count) * pipelining_threshold_step;
+        RETURN_ON_BAD_RESULT(dispatcher.Dispatch(job));
+    }
+
+    return dispatcher.Flush();
+}
+
+// Sets up a device and runs --iterations dispatches with each frame count from one to --frames
+static VkResult RunPipeliningSweep(const BenchmarkOptions &options)
+{
+    if (!VerifyInstanceLayers() || !VerifyInstanceExtensions())
+    {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    VkInstance instance = {};
+    RETURN_ON_BAD_RESULT(CreateHeadlessVulkanInstance(instance));
+
+    VkDebugUtilsMessengerEXT debugMessenger = {};
+    RETURN_ON_BAD_RESULT(CreateDebugMessenger(instance, &debugMessenger));
+
+    VkDebugReportCallbackEXT reportCallback = {};
+    RETURN_ON_BAD_RESULT(CreateReportCallback(instance, &reportCallback));
+
+    VkPhysicalDevice *physicalDevices = nullptr;
+    uint32_t physicalDeviceCount = 0;
+    RETURN_ON_BAD_RESULT(EnumerateDevices(instance, physicalDevices, physicalDeviceCount));
+
+    VkPhysicalDevice physicalDevice = {};
+    const VkResult selectResult = SelectPhysicalDevice(physicalDevices, physicalDeviceCount, options.deviceName, physicalDevice);
+    free(physicalDevices);
+    RETURN_ON_BAD_RESULT(selectResult);
+
+    uint32_t queueFamilyIndex = 0;
+    RETURN_ON_BAD_RESULT(GetBestComputeQueue(physicalDevice, queueFamilyIndex));
+
+    QuerySupport querySupport = {};
+    GetQuerySupport(physicalDevice, queueFamilyIndex, querySupport);
+
+    VkDevice device = {};
+    RETURN_ON_BAD_RESULT(CreateDevice(physicalDevice, queueFamilyIndex, querySupport, device));
+
+    ComputeQueueTarget target;
+    target.device = device;
+    target.queueFamilyIndex = queueFamilyIndex;
+    target.querySupport = querySupport;
+
+    // The kernel reads its print threshold from the push constants
+    const std::vector<uint32_t> shaderCode = readFile("PrintfScalingShader.comp.spv");
+    const uint32_t groupCount = std::max(1u, options.invocations / shader_local_size_x);
+
+    printf("%8s %14s %10s\n", "frames", "dispatches/s", "speedup");
+
+    double sequentialRate = 0.0;
+    VkResult result = VK_SUCCESS;
+    for (uint32_t frameCount = 1; VK_SUCCESS == result && frameCount <= std::max(1u, options.frames); frameCount++)
+    {
+        PipelinedDispatcher dispatcher;
+        result = dispatcher.Initialize(target, frameCount);
+
+        if (VK_SUCCESS == result)
+        {
+            result = RunPipelinedDispatches(dispatcher, shaderCode, groupCount, options.warmupIterations);
+        }
+
+        if (VK_SUCCESS == result)
+        {
+            const BenchmarkClock::time_point start = BenchmarkClock::now();
+            result = RunPipelinedDispatches(dispatcher, shaderCode, groupCount, options.iterations);
+            const double seconds = std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+
+            const double rate = options.iterations / seconds;
+            if (1 == frameCount)
+            {
+                sequentialRate = rate;
+            }
+
+            printf("%8u %14.1f %9.2fx\n", dispatcher.GetFrameCount(), rate, rate / sequentialRate);
+            fflush(stdout);
+        }
+
+        dispatcher.Destroy();
+    }
+
+    vkDeviceWaitIdle(device);
+    vkDestroyDevice(device, GetVulkanAllocator());
+
+    DestroyDebugMessenger(instance, debugMessenger);
+    DestroyReportCallback(instance, reportCallback);
+
+    vkDestroyInstance(instance, nullptr);
+
+    return result;
+}
+
+#undef RETURN_ON_BAD_RESULT
+
+// Dispatches PrintfScalingShader --iterations times with changing print thresholds, first one at
+// a time and then pipelined over up to --frames frames, and reports dispatches per second and the
+// speedup of overlapping the recording and decoding with the execution
+int RunPipeliningBenchmark(const BenchmarkOptions &options)
+{
+    // The results are printed with printf, the callbacks would flood the console otherwise
+    NullStreamBuffer nullStreamBuffer;
+    std::streambuf *const coutStreamBuffer = std::cout.rdbuf(&nullStreamBuffer);
+
+    const VkResult result = RunPipeliningSweep(options);
+
+    std::cout.rdbuf(coutStreamBuffer);
+
+    if (VK_SUCCESS != result)
+    {
+        fprintf(stderr, "Pipelining benchmark failed with VkResult %d\n", static_cast<int>(result));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,233 @@
+#include "PrintfAggregation.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// Returns the histogram bucket of a value that is not a NaN
+static uint32_t GetHistogramBucket(double value)
+{
+    if (0.0 == value)
+    {
+        return printf_histogram_magnitudes;
+    }
+
+    // frexp gives |value| = mantissa * 2^exponent with the mantissa in [0.5, 1), so the magnitude
+    // is in [2^(exponent - 1), 2^exponent). Infinities land in the largest magnitude.
+    int exponent = printf_histogram_max_exponent;
+    if (std::isfinite(value))
+    {
+        std::frexp(value, &exponent);
+    }
+
+    const int32_t magnitude = std::min(std::max(exponent - 1, printf_histogram_min_exponent), printf_histogram_max_exponent - 1) - printf_histogram_min_exponent;
+
+    return value > 0.0 ? printf_histogram_magnitudes + 1 + magnitude : printf_histogram_magnitudes - 1 - magnitude;
+}
+
+// Converts a 64-bit argument to the value it prints as, by the type of its conversion
+static inline double GetArgumentValue(PrintfOpType type, uint64_t argument)
+{
+    switch (type)
+    {
+        case PRINTF_OP_SIGNED: return static_cast<double>(static_cast<int64_t>(argument));
+        case PRINTF_OP_UNSIGNED: return static_cast<double>(argument);
+        default:
+        {
+            double value = 0.0;
+            memcpy(&value, &argument, sizeof(value));
+            return value;
+        }
+    }
+}
+
+PrintfAggregator::FormatSummary &PrintfAggregator::GetFormatSummary(uint32_t formatId)
+{
+    // There are only a few formats, the unknown one included
+    for (FormatSummary &summary : formats)
+    {
+        if (summary.formatId == formatId)
+        {
+            return summary;
+        }
+    }
+
+    formats.emplace_back();
+    FormatSummary &summary = formats.back();
+    summary.formatId = formatId;
+
+    if (printf_unknown_format != formatId)
+    {
+        const PrintfFormatView &format = GetPrintfFormat(formatId);
+        for (size_t i = 0; i < format.count; i++)
+        {
+            if (PRINTF_OP_LITERAL != format.ops[i].type)
+            {
+                summary.arguments.emplace_back();
+                summary.arguments.back().name = GetPrintfArgumentName(format, i, static_cast<uint32_t>(summary.arguments.size() - 1));
+                summary.arguments.back().type = format.ops[i].type;
+            }
+        }
+    }
+
+    return summary;
+}
+
+void PrintfAggregator::Add(const std::vector<PrintfRecord> &records)
+{
+    FormatSummary *summary = nullptr;
+
+    for (const PrintfRecord &record : records)
+    {
+        // The messages of a dispatch mostly share one format
+        if (nullptr == summary || summary->formatId != record.formatId)
+        {
+            summary = &GetFormatSummary(record.formatId);
+        }
+
+        summary->messageCount++;
+
+        const size_t argumentCount = std::min<size_t>(record.argumentCount, summary->arguments.size());
+        for (size_t i = 0; i < argumentCount; i++)
+        {
+            PrintfArgumentSummary &argument = summary->arguments[i];
+            const double value = GetArgumentValue(argument.type, record.arguments[i]);
+
+            if (std::isnan(value))
+            {
+                argument.nanCount++;
+                continue;
+            }
+
+            if (0 == argument.count)
+            {
+                argument.minimum = value;
+                argument.maximum = value;
+            }
+
+            argument.count++;
+            argument.minimum = std::min(argument.minimum, value);
+            argument.maximum = std::max(argument.maximum, value);
+            argument.sum += value;
+            argument.distinct.Add(record.arguments[i]);
+            argument.histogram[GetHistogramBucket(value)]++;
+        }
+    }
+
+    messageCount += records.size();
+}
+
+// Appends a number with the fewest digits that read back as the same double, so integers
+// below 2^53 come out exactly
+static void AppendNumber(std::string &output, double value)
+{
+    char buffer[32];
+    const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    output.append(buffer, result.ptr);
+}
+
+// Appends the range of values a histogram bucket counts
+static void AppendBucketRange(std::string &output, uint32_t bucket)
+{
+    if (printf_histogram_magnitudes == bucket)
+    {
+        output += "0";
+        return;
+    }
+
+    const bool positive = bucket > printf_histogram_magnitudes;
+    const int32_t magnitude = static_cast<int32_t>(positive ? bucket - printf_histogram_magnitudes - 1 : printf_histogram_magnitudes - 1 - bucket);
+
+    // The buckets at either end also hold the magnitudes beyond them
+    const double lower = 0 == magnitude ? 0.0 : std::ldexp(1.0, magnitude + printf_histogram_min_exponent);
+    const double upper = printf_histogram_magnitudes - 1 == static_cast<uint32_t>(magnitude) ? INFINITY : std::ldexp(1.0, magnitude + printf_histogram_min_exponent + 1);
+
+    if (positive)
+    {
+        output += 0.0 == lower ? "(" : "[";
+        AppendNumber(output, lower);
+        output += ", ";
+        AppendNumber(output, upper);
+        output += ")";
+    }
+    else
+    {
+        output += "(";
+        AppendNumber(output, -upper);
+        output += ", ";
+        AppendNumber(output, -lower);
+        output += 0.0 == lower ? ")" : "]";
+    }
+}
+
+void PrintfAggregator::Report(uint32_t correlationId)
+{
+    std::string prefix = "[PRINTF SUMMARY] : dispatch " + std::to_string(correlationId) + " : ";
+    std::string lines = prefix + std::to_string(messageCount) + " messages in " + std::to_string(formats.size()) + " formats\n";
+
+    for (const FormatSummary &summary : formats)
+    {
+        lines += prefix;
+        if (printf_unknown_format == summary.formatId)
+        {
+            lines += "no known format";
+        }
+        else
+        {
+            lines += "format \"";
+            lines += GetPrintfFormat(summary.formatId).format;
+            lines += "\"";
+        }
+        lines += " : " + std::to_string(summary.messageCount) + " messages\n";
+
+        for (const PrintfArgumentSummary &argument : summary.arguments)
+        {
+            lines += prefix + "\"" + argument.name + "\" : ";
+
+            if (0 == argument.count)
+            {
+                lines += "no values";
+            }
+            else
+            {
+                lines += "min ";
+                AppendNumber(lines, argument.minimum);
+                lines += ", max ";
+                AppendNumber(lines, argument.maximum);
+                lines += ", mean ";
+                AppendNumber(lines, argument.sum / static_cast<double>(argument.count));
+                lines += ", about " + std::to_string(argument.distinct.Estimate()) + " distinct";
+            }
+
+            if (0 != argument.nanCount)
+            {
+                lines += ", " + std::to_string(argument.nanCount) + " NaN";
+            }
+            lines += "\n";
+
+            if (0 == argument.count)
+            {
+                continue;
+            }
+
+            lines += prefix + "\"" + argument.name + "\" histogram :";
+            for (uint32_t bucket = 0; bucket < printf_histogram_buckets; bucket++)
+            {
+                if (0 != argument.histogram[bucket])
+                {
+                    lines += " ";
+                    AppendBucketRange(lines, bucket);
+                    lines += " " + std::to_string(argument.histogram[bucket]);
+                }
+            }
+            lines += "\n";
+        }
+    }
+
+    std::cout << lines;
+    std::cout.flush();
+
+    formats.clear();
+    messageCount = 0;
+}
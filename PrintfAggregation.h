@@ -0,0 +1,65 @@
+#pragma once
+
+#include "HyperLogLog.h"
+#include "PrintfRecord.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Summarizes the printf values of a dispatch instead of writing its messages. The arguments the
+// callbacks decoded into the records feed one set of accumulators per format and argument
+// position: count, minimum, maximum, mean, a HyperLogLog estimate of the distinct values and a
+// histogram, and no message is ever rendered as text. A dispatch of any size summarizes to a few
+// lines per format. The messages that matched no format are only counted.
+//
+// The histogram has fixed buckets, one per power of two of the magnitude on either side of zero,
+// so it needs no range up front: [1, 2), [2, 4), ... up to 2^63 and beyond, and down to
+// 2^printf_histogram_min_exponent, below which the values share the buckets next to zero.
+static const int32_t printf_histogram_min_exponent = -16;
+static const int32_t printf_histogram_max_exponent = 64;
+static const uint32_t printf_histogram_magnitudes = printf_histogram_max_exponent - printf_histogram_min_exponent;
+
+// The negative magnitudes from the largest down, zero, then the positive magnitudes from the smallest up
+static const uint32_t printf_histogram_buckets = printf_histogram_magnitudes * 2 + 1;
+
+struct PrintfArgumentSummary
+{
+    std::string name;
+    PrintfOpType type = PRINTF_OP_SIGNED;
+
+    // NaNs are counted apart and left out of everything else
+    uint64_t count = 0;
+    uint64_t nanCount = 0;
+    double minimum = 0.0;
+    double maximum = 0.0;
+    double sum = 0.0;
+
+    // Of the 64-bit argument values, so -0.0 and 0.0 are distinct
+    HyperLogLog distinct;
+
+    uint64_t histogram[printf_histogram_buckets] = {};
+};
+
+// Accumulates the records of a dispatch by format. Only one thread may use it at a time.
+class PrintfAggregator
+{
+public:
+    void Add(const std::vector<PrintfRecord> &records);
+
+    // Writes the summary of the records added since the last report to std::cout as
+    // "[PRINTF SUMMARY] : dispatch <id> : ..." lines, and starts over
+    void Report(uint32_t correlationId);
+
+private:
+    struct FormatSummary
+    {
+        uint32_t formatId = printf_unknown_format;
+        uint64_t messageCount = 0;
+        std::vector<PrintfArgumentSummary> arguments;
+    };
+
+    FormatSummary &GetFormatSummary(uint32_t formatId);
+
+    std::vector<FormatSummary> formats;
+    uint64_t messageCount = 0;
+};
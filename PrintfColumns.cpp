@@ -0,0 +1,394 @@
+#include "PrintfColumns.h"
+#include "FileSeek.h"
+#include <algorithm>
+#include <cstring>
+
+PrintfColumnWriter printfColumnWriter;
+
+PrintfColumnWriter::~PrintfColumnWriter()
+{
+    Close();
+}
+
+bool PrintfColumnWriter::Open(const char *path)
+{
+    Close();
+
+    file = fopen(path, "wb");
+    if (nullptr == file)
+    {
+        return false;
+    }
+
+    PrintfColumnFileHeader header = {};
+    memcpy(header.magic, printf_column_file_magic, sizeof(header.magic));
+    header.version = printf_column_file_version;
+    header.headerSize = sizeof(header);
+    fwrite(&header, sizeof(header), 1, file);
+
+    // Pads the file header so the first chunk is aligned too
+    const uint8_t padding[printf_column_alignment - sizeof(header)] = {};
+    fwrite(padding, sizeof(padding), 1, file);
+
+    fileOffset = printf_column_alignment;
+    index.clear();
+
+    return true;
+}
+
+void PrintfColumnWriter::Close()
+{
+    if (nullptr == file)
+    {
+        return;
+    }
+
+    for (PendingChunk &chunk : pendingChunks)
+    {
+        if (0 != chunk.rowCount)
+        {
+            WriteChunk(chunk);
+        }
+    }
+
+    PrintfColumnFooter footer = {};
+    footer.indexOffset = fileOffset;
+    footer.chunkCount = static_cast<uint32_t>(index.size());
+    footer.magic = printf_column_index_magic;
+
+    fwrite(index.data(), sizeof(PrintfColumnIndexEntry), index.size(), file);
+    fwrite(&footer, sizeof(footer), 1, file);
+
+    fclose(file);
+    file = nullptr;
+    pendingChunks.clear();
+    index.clear();
+}
+
+PrintfColumnWriter::PendingChunk &PrintfColumnWriter::GetPendingChunk(uint32_t formatId)
+{
+    // There are only a few formats, the unknown one included
+    for (PendingChunk &chunk : pendingChunks)
+    {
+        if (chunk.formatId == formatId)
+        {
+            return chunk;
+        }
+    }
+
+    pendingChunks.emplace_back();
+    pendingChunks.back().formatId = formatId;
+    pendingChunks.back().textOffsets.push_back(0);
+
+    return pendingChunks.back();
+}
+
+void PrintfColumnWriter::Append(const std::vector<PrintfRecord> &records)
+{
+    if (nullptr == file)
+    {
+        return;
+    }
+
+    // The records arrive in the order the subgroups wrote them, appending them by invocation
+    // gives every chunk a narrow invocation range in the index
+    thread_local std::vector<uint32_t> order;
+    const bool arrivalOrdered = std::is_sorted(records.begin(), records.end(), [](const PrintfRecord &a, const PrintfRecord &b) { return a.invocation < b.invocation; });
+    if (!arrivalOrdered)
+    {
+        OrderPrintfRecordsByInvocation(records, order);
+    }
+
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const PrintfRecord &record = records[arrivalOrdered ? i : order[i]];
+        PendingChunk &chunk = GetPendingChunk(record.formatId);
+
+        chunk.sequences.push_back(record.sequence);
+        chunk.correlationIds.push_back(record.correlationId);
+        chunk.invocations.push_back(record.invocation);
+        chunk.hostTimes.push_back(record.hostTime);
+
+        if (printf_unknown_format == record.formatId)
+        {
+            chunk.text += record.text;
+            chunk.textOffsets.push_back(static_cast<uint32_t>(chunk.text.size()));
+        }
+        else
+        {
+            for (uint32_t argument = 0; argument < record.argumentCount; argument++)
+            {
+                chunk.arguments[argument].push_back(record.arguments[argument]);
+            }
+        }
+
+        if (++chunk.rowCount == printf_column_chunk_rows)
+        {
+            WriteChunk(chunk);
+        }
+    }
+}
+
+// Returns the column type of a conversion, from its type and the size of its argument in the shader
+static PrintfColumnType GetColumnType(const PrintfOp &op)
+{
+    switch (op.type)
+    {
+        case PRINTF_OP_SIGNED: return 8 == op.size ? PRINTF_COLUMN_INT64 : PRINTF_COLUMN_INT32;
+        case PRINTF_OP_UNSIGNED: return 8 == op.size ? PRINTF_COLUMN_UINT64 : PRINTF_COLUMN_UINT32;
+        default: return 8 == op.size ? PRINTF_COLUMN_FLOAT64 : PRINTF_COLUMN_FLOAT32;
+    }
+}
+
+// A column of a chunk while the chunk is laid out
+struct ChunkColumn
+{
+    PrintfColumnType type;
+    std::string name;
+    const void *values;
+    size_t valuesSize;
+    const void *data;
+    size_t dataSize;
+
+    // The values are the 64-bit arguments of a 32-bit column, narrowed as they are appended
+    bool narrowed = false;
+};
+
+// Appends bytes to the chunk and returns their offset, padding first to the column alignment when asked
+static uint64_t AppendChunkBytes(std::vector<uint8_t> &chunk, const void *bytes, size_t size, bool aligned)
+{
+    if (aligned)
+    {
+        chunk.resize((chunk.size() + printf_column_alignment - 1) / printf_column_alignment * printf_column_alignment);
+    }
+
+    const uint64_t offset = chunk.size();
+    chunk.insert(chunk.end(), static_cast<const uint8_t *>(bytes), static_cast<const uint8_t *>(bytes) + size);
+
+    return offset;
+}
+
+// Appends the 64-bit arguments of a FLOAT32, INT32 or UINT32 column narrowed to 32 bits, aligned, and returns their offset
+static uint64_t AppendNarrowedValues(std::vector<uint8_t> &chunk, PrintfColumnType type, const uint64_t *values, size_t rowCount)
+{
+    const uint64_t offset = AppendChunkBytes(chunk, nullptr, 0, true);
+    chunk.resize(offset + rowCount * sizeof(uint32_t));
+
+    uint8_t *destination = chunk.data() + offset;
+    for (size_t row = 0; row < rowCount; row++, destination += sizeof(uint32_t))
+    {
+        if (PRINTF_COLUMN_FLOAT32 == type)
+        {
+            double value = 0.0;
+            memcpy(&value, &values[row], sizeof(value));
+            const float narrowed = static_cast<float>(value);
+            memcpy(destination, &narrowed, sizeof(narrowed));
+        }
+        else
+        {
+            const uint32_t narrowed = static_cast<uint32_t>(values[row]);
+            memcpy(destination, &narrowed, sizeof(narrowed));
+        }
+    }
+
+    return offset;
+}
+
+void PrintfColumnWriter::WriteChunk(PendingChunk &chunk)
+{
+    PrintfColumnIndexEntry entry = {};
+    entry.chunkOffset = fileOffset;
+    entry.formatId = chunk.formatId;
+    entry.rowCount = chunk.rowCount;
+
+    const auto correlationIds = std::minmax_element(chunk.correlationIds.begin(), chunk.correlationIds.end());
+    entry.minCorrelationId = *correlationIds.first;
+    entry.maxCorrelationId = *correlationIds.second;
+
+    const auto invocations = std::minmax_element(chunk.invocations.begin(), chunk.invocations.end());
+    entry.minInvocation = *invocations.first;
+    entry.maxInvocation = *invocations.second;
+
+    std::vector<ChunkColumn> columns;
+    columns.push_back({ PRINTF_COLUMN_UINT64, "sequence", chunk.sequences.data(), chunk.sequences.size() * sizeof(uint64_t), nullptr, 0 });
+    columns.push_back({ PRINTF_COLUMN_UINT32, "correlationId", chunk.correlationIds.data(), chunk.correlationIds.size() * sizeof(uint32_t), nullptr, 0 });
+    columns.push_back({ PRINTF_COLUMN_UINT32, "invocation", chunk.invocations.data(), chunk.invocations.size() * sizeof(uint32_t), nullptr, 0 });
+    columns.push_back({ PRINTF_COLUMN_INT64, "hostTimeNs", chunk.hostTimes.data(), chunk.hostTimes.size() * sizeof(int64_t), nullptr, 0 });
+
+    const char *formatString = "";
+
+    if (printf_unknown_format == chunk.formatId)
+    {
+        columns.push_back({ PRINTF_COLUMN_TEXT, "text", chunk.textOffsets.data(), chunk.textOffsets.size() * sizeof(uint32_t), chunk.text.data(), chunk.text.size() });
+    }
+    else
+    {
+        const PrintfFormatView &format = GetPrintfFormat(chunk.formatId);
+        formatString = format.format;
+
+        uint32_t argument = 0;
+        for (size_t i = 0; i < format.count; i++)
+        {
+            const PrintfOp &op = format.ops[i];
+            if (PRINTF_OP_LITERAL == op.type)
+            {
+                continue;
+            }
+
+            const std::vector<uint64_t> &values = chunk.arguments[argument];
+            const PrintfColumnType type = GetColumnType(op);
+            const bool narrowed = PRINTF_COLUMN_FLOAT32 == type || PRINTF_COLUMN_INT32 == type || PRINTF_COLUMN_UINT32 == type;
+            const size_t valuesSize = values.size() * (narrowed ? sizeof(uint32_t) : sizeof(uint64_t));
+
+            columns.push_back({ type, GetPrintfArgumentName(format, i, argument), values.data(), valuesSize, nullptr, 0, narrowed });
+            argument++;
+        }
+    }
+
+    // The header and descriptors are filled in once the offsets of the buffers are known
+    std::vector<uint8_t> &bytes = chunkBuffer;
+    bytes.assign(sizeof(PrintfColumnChunkHeader) + columns.size() * sizeof(PrintfColumnDescriptor), 0);
+
+    PrintfColumnChunkHeader header = {};
+    header.magic = printf_column_chunk_magic;
+    header.formatId = chunk.formatId;
+    header.rowCount = chunk.rowCount;
+    header.columnCount = static_cast<uint32_t>(columns.size());
+    header.formatLength = static_cast<uint32_t>(strlen(formatString));
+    header.formatOffset = static_cast<uint32_t>(AppendChunkBytes(bytes, formatString, header.formatLength, false));
+
+    std::vector<PrintfColumnDescriptor> descriptors(columns.size());
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        descriptors[i].type = columns[i].type;
+        descriptors[i].nameLength = static_cast<uint32_t>(columns[i].name.size());
+        descriptors[i].nameOffset = AppendChunkBytes(bytes, columns[i].name.data(), columns[i].name.size(), false);
+    }
+
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        descriptors[i].valuesSize = columns[i].valuesSize;
+        if (columns[i].narrowed)
+        {
+            descriptors[i].valuesOffset = AppendNarrowedValues(bytes, columns[i].type, static_cast<const uint64_t *>(columns[i].values), columns[i].valuesSize / sizeof(uint32_t));
+        }
+        else
+        {
+            descriptors[i].valuesOffset = AppendChunkBytes(bytes, columns[i].values, columns[i].valuesSize, true);
+        }
+
+        if (nullptr != columns[i].data)
+        {
+            descriptors[i].dataSize = columns[i].dataSize;
+            descriptors[i].dataOffset = AppendChunkBytes(bytes, columns[i].data, columns[i].dataSize, true);
+        }
+    }
+
+    bytes.resize((bytes.size() + printf_column_alignment - 1) / printf_column_alignment * printf_column_alignment);
+    header.chunkSize = bytes.size();
+
+    memcpy(bytes.data(), &header, sizeof(header));
+    memcpy(bytes.data() + sizeof(header), descriptors.data(), descriptors.size() * sizeof(PrintfColumnDescriptor));
+
+    fwrite(bytes.data(), 1, bytes.size(), file);
+
+    entry.chunkSize = header.chunkSize;
+    index.push_back(entry);
+    fileOffset += header.chunkSize;
+
+    // The pending rows keep their capacity for the next chunk of the format
+    chunk.rowCount = 0;
+    chunk.sequences.clear();
+    chunk.correlationIds.clear();
+    chunk.invocations.clear();
+    chunk.hostTimes.clear();
+    for (std::vector<uint64_t> &values : chunk.arguments)
+    {
+        values.clear();
+    }
+    chunk.textOffsets.assign(1, 0);
+    chunk.text.clear();
+}
+
+PrintfColumnReader::~PrintfColumnReader()
+{
+    Close();
+}
+
+bool PrintfColumnReader::Open(const char *path)
+{
+    Close();
+
+    file = fopen(path, "rb");
+    if (nullptr == file)
+    {
+        return false;
+    }
+
+    PrintfColumnFileHeader header = {};
+    PrintfColumnFooter footer = {};
+
+    bool valid = 1 == fread(&header, sizeof(header), 1, file) &&
+        0 == memcmp(header.magic, printf_column_file_magic, sizeof(header.magic)) &&
+        printf_column_file_version == header.version &&
+        0 == SeekFile(file, 0, SEEK_END);
+
+    const uint64_t fileSize = valid ? TellFile(file) : 0;
+
+    valid = valid && fileSize >= printf_column_alignment + sizeof(footer) &&
+        0 == SeekFile(file, fileSize - sizeof(footer), SEEK_SET) &&
+        1 == fread(&footer, sizeof(footer), 1, file) &&
+        printf_column_index_magic == footer.magic &&
+        footer.indexOffset + static_cast<uint64_t>(footer.chunkCount) * sizeof(PrintfColumnIndexEntry) + sizeof(footer) == fileSize;
+
+    if (valid)
+    {
+        index.resize(footer.chunkCount);
+        valid = 0 == SeekFile(file, footer.indexOffset, SEEK_SET) &&
+            index.size() == fread(index.data(), sizeof(PrintfColumnIndexEntry), index.size(), file);
+    }
+
+    for (const PrintfColumnIndexEntry &entry : index)
+    {
+        valid = valid && entry.chunkSize >= sizeof(PrintfColumnChunkHeader) && entry.chunkOffset + entry.chunkSize <= footer.indexOffset;
+    }
+
+    if (!valid)
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void PrintfColumnReader::Close()
+{
+    if (nullptr != file)
+    {
+        fclose(file);
+        file = nullptr;
+    }
+
+    index.clear();
+}
+
+bool PrintfColumnReader::ReadChunk(uint32_t chunk, std::vector<uint64_t> &bytes)
+{
+    const PrintfColumnIndexEntry &entry = index[chunk];
+
+    // Held in 64-bit words so the buffers of the chunk keep their alignment in memory
+    bytes.resize((entry.chunkSize + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+
+    if (0 != SeekFile(file, entry.chunkOffset, SEEK_SET) || 1 != fread(bytes.data(), entry.chunkSize, 1, file))
+    {
+        return false;
+    }
+
+    PrintfColumnChunkHeader header = {};
+    memcpy(&header, bytes.data(), sizeof(header));
+
+    return printf_column_chunk_magic == header.magic && entry.chunkSize == header.chunkSize &&
+        entry.rowCount == header.rowCount && header.columnCount >= printf_column_fixed_count &&
+        sizeof(header) + static_cast<uint64_t>(header.columnCount) * sizeof(PrintfColumnDescriptor) <= header.chunkSize;
+}
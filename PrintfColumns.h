@@ -0,0 +1,191 @@
+#pragma once
+
+#include "PrintfRecord.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// A binary output of the captured printf records for analytics. The records are grouped by
+// format id, and each field and argument position is stored as a contiguous typed column, so
+// a tool can map the file and scan a column such as "GLSL GI ID X value is" with SIMD without
+// parsing any text.
+//
+// The file is a PrintfColumnFileHeader followed by chunks, each holding up to
+// printf_column_chunk_rows records of one format. A chunk starts with a PrintfColumnChunkHeader
+// and its PrintfColumnDescriptors, then the format string and the column names, then the column
+// buffers. All offsets are from the start of the chunk, every buffer and every chunk starts on
+// a 64 byte boundary, and all values are little-endian. As in Arrow, a text column is a buffer
+// of rowCount + 1 uint32 offsets into a buffer of UTF-8 bytes.
+//
+// Every chunk has the columns "sequence" (uint64), "correlationId" (uint32), "invocation" (uint32,
+// printf_unknown_invocation for messages without one) and "hostTimeNs" (int64), then one column
+// per argument named after the literal text in front of it. The messages printed with an
+// unknown format have the format id printf_unknown_format and one "text" column instead of
+// arguments.
+//
+// After the last chunk comes a sparse index, one PrintfColumnIndexEntry per chunk with its format
+// id and the ranges of correlation ids and invocations of its rows, then a PrintfColumnFooter at
+// the very end of the file that locates the index. A reader seeks to the footer, reads the index
+// and skips every chunk whose ranges miss the query, so asking for a few invocations of one
+// dispatch reads a few chunks of a multi-gigabyte file. The writer orders the records of each
+// dispatch by invocation before splitting them into chunks, which keeps the invocation ranges of
+// the chunks narrow.
+
+static const uint32_t printf_column_chunk_rows = 65536;
+static const uint32_t printf_column_alignment = 64;
+
+static const char printf_column_file_magic[8] = { 'V', 'K', 'P', 'F', 'C', 'O', 'L', '\0' };
+static const uint32_t printf_column_file_version = 2;
+static const uint32_t printf_column_chunk_magic = 0x4b4e4843; // "CHNK"
+static const uint32_t printf_column_index_magic = 0x58444943; // "CIDX"
+
+// The columns every chunk starts with, the argument or text columns follow them
+static const uint32_t printf_column_fixed_count = 4;
+
+enum PrintfColumnType : uint8_t
+{
+    PRINTF_COLUMN_INT32,
+    PRINTF_COLUMN_UINT32,
+    PRINTF_COLUMN_INT64,
+    PRINTF_COLUMN_UINT64,
+    PRINTF_COLUMN_FLOAT32,
+    PRINTF_COLUMN_FLOAT64,
+    PRINTF_COLUMN_TEXT
+};
+
+struct PrintfColumnFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+};
+
+struct PrintfColumnChunkHeader
+{
+    uint32_t magic;
+    uint32_t formatId;
+
+    // The bytes from the start of this header to the start of the next chunk
+    uint64_t chunkSize;
+
+    uint32_t rowCount;
+    uint32_t columnCount;
+
+    // The format string follows the descriptors, it is empty for printf_unknown_format
+    uint32_t formatOffset;
+    uint32_t formatLength;
+};
+
+struct PrintfColumnDescriptor
+{
+    PrintfColumnType type;
+    uint8_t reserved[3];
+    uint32_t nameLength;
+    uint64_t nameOffset;
+
+    uint64_t valuesOffset;
+    uint64_t valuesSize;
+
+    // The UTF-8 bytes of a text column, zero for the other types
+    uint64_t dataOffset;
+    uint64_t dataSize;
+};
+
+struct PrintfColumnIndexEntry
+{
+    // The offset of the chunk header from the start of the file, and the chunkSize of the header
+    uint64_t chunkOffset;
+    uint64_t chunkSize;
+
+    uint32_t formatId;
+    uint32_t rowCount;
+
+    // Inclusive ranges over the rows of the chunk
+    uint32_t minCorrelationId;
+    uint32_t maxCorrelationId;
+    uint32_t minInvocation;
+    uint32_t maxInvocation;
+};
+
+struct PrintfColumnFooter
+{
+    uint64_t indexOffset;
+    uint32_t chunkCount;
+    uint32_t magic;
+};
+
+static_assert(16 == sizeof(PrintfColumnFileHeader), "The file header is part of the file format");
+static_assert(32 == sizeof(PrintfColumnChunkHeader), "The chunk header is part of the file format");
+static_assert(48 == sizeof(PrintfColumnDescriptor), "The column descriptor is part of the file format");
+static_assert(40 == sizeof(PrintfColumnIndexEntry), "The index entry is part of the file format");
+static_assert(16 == sizeof(PrintfColumnFooter), "The footer is part of the file format");
+
+// Collects printf records by format and writes them to a column file a chunk at a time.
+// Only one thread may use it at a time.
+class PrintfColumnWriter
+{
+public:
+    ~PrintfColumnWriter();
+
+    bool Open(const char *path);
+    bool IsOpen() const { return nullptr != file; }
+
+    // Writes out the chunks that are still partly filled and the index, and closes the file
+    void Close();
+
+    void Append(const std::vector<PrintfRecord> &records);
+
+private:
+    // The rows of one format that have not been written yet. The arguments are held as the
+    // 64-bit values of PrintfRecord until the chunk is written with the column types.
+    struct PendingChunk
+    {
+        uint32_t formatId = printf_unknown_format;
+        uint32_t rowCount = 0;
+        std::vector<uint64_t> sequences;
+        std::vector<uint32_t> correlationIds;
+        std::vector<uint32_t> invocations;
+        std::vector<int64_t> hostTimes;
+        std::vector<uint64_t> arguments[printf_max_arguments];
+        std::vector<uint32_t> textOffsets;
+        std::string text;
+    };
+
+    PendingChunk &GetPendingChunk(uint32_t formatId);
+    void WriteChunk(PendingChunk &chunk);
+
+    FILE *file = nullptr;
+    uint64_t fileOffset = 0;
+    std::vector<PendingChunk> pendingChunks;
+    std::vector<PrintfColumnIndexEntry> index;
+
+    // The bytes of the chunk being written, kept to be reused by the next one
+    std::vector<uint8_t> chunkBuffer;
+};
+
+// Reads the chunks of a column file through its index. Only one thread may use it.
+class PrintfColumnReader
+{
+public:
+    ~PrintfColumnReader();
+
+    // Fails for files that are not column files, that have an older version or no index,
+    // such as the files of a run that did not get to close them
+    bool Open(const char *path);
+    void Close();
+
+    uint32_t GetChunkCount() const { return static_cast<uint32_t>(index.size()); }
+    const PrintfColumnIndexEntry &GetChunk(uint32_t chunk) const { return index[chunk]; }
+
+    // Reads a whole chunk into bytes, its header, descriptors and buffers at the offsets they
+    // give from the start of bytes, which is aligned for every column type
+    bool ReadChunk(uint32_t chunk, std::vector<uint64_t> &bytes);
+
+private:
+    FILE *file = nullptr;
+    std::vector<PrintfColumnIndexEntry> index;
+};
+
+// The writer main() opens with --columnar=PATH, ReportComputeDispatch appends each dispatch's records to it
+extern PrintfColumnWriter printfColumnWriter;
@@ -0,0 +1,283 @@
+#include "PrintfDiff.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+PrintfDiff printfDiff;
+
+// The shader language names the kernels print in front of their messages, which the signatures
+// leave out so that the GLSL and HLSL versions of a message hash the same
+static const char *const printf_language_names[] = { "GLSL ", "HLSL " };
+
+// Skips a shader language name at the start of a format or message text
+static const char *SkipLanguageName(const char *text)
+{
+    for (const char *name : printf_language_names)
+    {
+        if (0 == strncmp(text, name, strlen(name)))
+        {
+            return text + strlen(name);
+        }
+    }
+
+    return text;
+}
+
+// The 64-bit FNV-1a hash of a text without its language name
+static uint64_t HashText(const char *text)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char *character = SkipLanguageName(text); '\0' != *character; character++)
+    {
+        hash = (hash ^ static_cast<uint8_t>(*character)) * 0x100000001b3ull;
+    }
+
+    return MixHash(hash);
+}
+
+// Hashes a message from the hash of its format and its arguments, or from its text
+static inline uint64_t HashRecord(const PrintfRecord &record, std::vector<uint64_t> &formatHashes)
+{
+    if (printf_unknown_format == record.formatId)
+    {
+        return HashText(record.text.c_str());
+    }
+
+    // The format ids are dense, each format is hashed the first time one of its messages is
+    if (record.formatId >= formatHashes.size())
+    {
+        formatHashes.resize(record.formatId + 1, 0);
+    }
+
+    uint64_t &formatHash = formatHashes[record.formatId];
+    if (0 == formatHash)
+    {
+        formatHash = HashText(GetPrintfFormat(record.formatId).format);
+    }
+
+    uint64_t hash = formatHash;
+    for (uint32_t i = 0; i < record.argumentCount; i++)
+    {
+        hash = MixHash(hash ^ record.arguments[i]) + i;
+    }
+
+    return hash;
+}
+
+void ComputePrintfSignature(const std::vector<PrintfRecord> &records, uint32_t correlationId, PrintfSignature &signature)
+{
+    thread_local std::vector<uint64_t> formatHashes;
+
+    signature.correlationId = correlationId;
+    signature.messageCount = records.size();
+    signature.unknownInvocationHash = 0;
+    signature.invocationHashes.clear();
+
+    for (const PrintfRecord &record : records)
+    {
+        const uint64_t recordHash = HashRecord(record, formatHashes);
+
+        if (printf_unknown_invocation == record.invocation)
+        {
+            signature.unknownInvocationHash = MixHash(signature.unknownInvocationHash ^ recordHash);
+            continue;
+        }
+
+        if (record.invocation >= signature.invocationHashes.size())
+        {
+            signature.invocationHashes.resize(record.invocation + 1, 0);
+        }
+
+        // Mixing after each message makes the hash depend on the order the invocation printed in
+        uint64_t &hash = signature.invocationHashes[record.invocation];
+        hash = MixHash(hash ^ recordHash);
+    }
+}
+
+uint32_t ComparePrintfSignatures(const PrintfSignature &a, const PrintfSignature &b, std::vector<uint32_t> &differing, size_t maxListed)
+{
+    differing.clear();
+
+    // The invocations past the end of the shorter signature printed nothing in it
+    const std::vector<uint64_t> &shorter = a.invocationHashes.size() < b.invocationHashes.size() ? a.invocationHashes : b.invocationHashes;
+    const std::vector<uint64_t> &longer = a.invocationHashes.size() < b.invocationHashes.size() ? b.invocationHashes : a.invocationHashes;
+
+    uint32_t differingCount = 0;
+    for (size_t invocation = 0; invocation < longer.size(); invocation++)
+    {
+        const uint64_t shorterHash = invocation < shorter.size() ? shorter[invocation] : 0;
+        if (shorterHash != longer[invocation])
+        {
+            if (differing.size() < maxListed)
+            {
+                differing.push_back(static_cast<uint32_t>(invocation));
+            }
+            differingCount++;
+        }
+    }
+
+    if (a.unknownInvocationHash != b.unknownInvocationHash)
+    {
+        if (differing.size() < maxListed)
+        {
+            differing.push_back(printf_unknown_invocation);
+        }
+        differingCount++;
+    }
+
+    return differingCount;
+}
+
+PrintfDiff::~PrintfDiff()
+{
+    Close();
+}
+
+bool PrintfDiff::OpenSignatureOutput(const char *path)
+{
+    output = fopen(path, "wb");
+    if (nullptr == output)
+    {
+        return false;
+    }
+
+    PrintfSignatureFileHeader header = {};
+    memcpy(header.magic, printf_signature_file_magic, sizeof(header.magic));
+    header.version = printf_signature_file_version;
+    header.headerSize = sizeof(header);
+    fwrite(&header, sizeof(header), 1, output);
+
+    return true;
+}
+
+bool PrintfDiff::OpenBaseline(const char *path)
+{
+    baseline = fopen(path, "rb");
+    if (nullptr == baseline)
+    {
+        return false;
+    }
+
+    PrintfSignatureFileHeader header = {};
+    if (1 != fread(&header, sizeof(header), 1, baseline) || 0 != memcmp(header.magic, printf_signature_file_magic, sizeof(header.magic)) ||
+        printf_signature_file_version != header.version)
+    {
+        fclose(baseline);
+        baseline = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void PrintfDiff::Close()
+{
+    if (nullptr != output)
+    {
+        fclose(output);
+        output = nullptr;
+    }
+
+    if (nullptr != baseline)
+    {
+        fclose(baseline);
+        baseline = nullptr;
+    }
+}
+
+// Reads the next signature of the baseline file into expected, returns false at its end
+bool PrintfDiff::ReadBaseline()
+{
+    PrintfSignatureHeader header = {};
+    if (1 != fread(&header, sizeof(header), 1, baseline))
+    {
+        return false;
+    }
+
+    expected.correlationId = header.correlationId;
+    expected.messageCount = header.messageCount;
+    expected.unknownInvocationHash = header.unknownInvocationHash;
+    expected.invocationHashes.resize(header.invocationCount);
+
+    return expected.invocationHashes.size() == fread(expected.invocationHashes.data(), sizeof(uint64_t), expected.invocationHashes.size(), baseline);
+}
+
+// Prints how many invocations of the current dispatch differ from the other signature, and the first of them
+void PrintfDiff::Report(const char *against, const PrintfSignature &other)
+{
+    const uint32_t differingCount = ComparePrintfSignatures(current, other, differing, printf_diff_listed_invocations);
+    const size_t invocationCount = std::max(current.invocationHashes.size(), other.invocationHashes.size());
+
+    std::cout << "[PRINTF DIFF] : dispatch " << current.correlationId << " against " << against << " " << other.correlationId << " : " <<
+        current.messageCount << " messages against " << other.messageCount << ", " << differingCount << " of " << invocationCount << " invocations differ";
+
+    for (size_t i = 0; i < differing.size(); i++)
+    {
+        std::cout << (0 == i ? " : " : " ");
+        if (printf_unknown_invocation == differing[i])
+        {
+            std::cout << "(no invocation)";
+        }
+        else
+        {
+            std::cout << differing[i];
+        }
+    }
+
+    if (differingCount > differing.size())
+    {
+        std::cout << " ...";
+    }
+
+    std::cout << std::endl;
+
+    if (0 != differingCount)
+    {
+        failedComparisons++;
+    }
+}
+
+void PrintfDiff::AddDispatch(uint32_t correlationId, const std::vector<PrintfRecord> &records)
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+
+    ComputePrintfSignature(records, correlationId, current);
+
+    if (nullptr != output)
+    {
+        PrintfSignatureHeader header = {};
+        header.correlationId = current.correlationId;
+        header.invocationCount = static_cast<uint32_t>(current.invocationHashes.size());
+        header.messageCount = current.messageCount;
+        header.unknownInvocationHash = current.unknownInvocationHash;
+
+        fwrite(&header, sizeof(header), 1, output);
+        fwrite(current.invocationHashes.data(), sizeof(uint64_t), current.invocationHashes.size(), output);
+    }
+
+    if (nullptr != baseline)
+    {
+        if (ReadBaseline())
+        {
+            Report("baseline dispatch", expected);
+        }
+        else
+        {
+            std::cout << "[PRINTF DIFF] : dispatch " << correlationId << " has no baseline signature" << std::endl;
+            failedComparisons++;
+        }
+    }
+
+    if (comparePairs && 1 == dispatchCount % 2)
+    {
+        Report("dispatch", previous);
+    }
+
+    // The signature buffers swap instead of copying, and keep their capacity for the next dispatch
+    std::swap(current, previous);
+    dispatchCount++;
+}
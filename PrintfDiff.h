@@ -0,0 +1,113 @@
+#pragma once
+
+#include "PrintfRecord.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Compares the printf output of dispatches invocation by invocation, between the GLSL and HLSL
+// versions of a kernel, or between this run and a signature file saved by an earlier run, on
+// another build or driver.
+//
+// A dispatch is reduced to its signature, one 64-bit hash per invocation of the messages that
+// invocation printed, folded in the order it printed them. A message is hashed from its format
+// and argument values, or from its text when no format matched, after normalizing away the
+// shader language name in front of it, so "GLSL GI ID X value is: 5" and "HLSL GI ID X value
+// is: 5" hash the same. The message order between invocations is not part of the signature,
+// only the order within each invocation is. Building and comparing signatures is linear in the
+// messages and invocations, and takes 8 bytes per invocation of the dispatch whatever the number
+// of messages, so millions of records compare in a fraction of a second.
+//
+// A signature file is a PrintfSignatureFileHeader followed by one PrintfSignatureHeader per
+// dispatch, each followed by its invocationCount uint64 hashes. All values are little-endian.
+
+// The most differing invocations listed in a report, all of them are counted
+static const size_t printf_diff_listed_invocations = 16;
+
+static const char printf_signature_file_magic[8] = { 'V', 'K', 'P', 'F', 'S', 'I', 'G', '\0' };
+static const uint32_t printf_signature_file_version = 1;
+
+struct PrintfSignatureFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+};
+
+struct PrintfSignatureHeader
+{
+    uint32_t correlationId;
+    uint32_t invocationCount;
+    uint64_t messageCount;
+
+    // The hash of the messages printed without an invocation
+    uint64_t unknownInvocationHash;
+};
+
+static_assert(16 == sizeof(PrintfSignatureFileHeader), "The file header is part of the file format");
+static_assert(24 == sizeof(PrintfSignatureHeader), "The signature header is part of the file format");
+
+struct PrintfSignature
+{
+    uint32_t correlationId = 0;
+    uint64_t messageCount = 0;
+    uint64_t unknownInvocationHash = 0;
+
+    // Indexed by invocation, zero for the invocations that printed nothing
+    std::vector<uint64_t> invocationHashes;
+};
+
+// Replaces signature with the signature of the records of a dispatch, in their arrival order
+void ComputePrintfSignature(const std::vector<PrintfRecord> &records, uint32_t correlationId, PrintfSignature &signature);
+
+// Returns how many invocations differ between two signatures, the messages without an invocation
+// counting as one more, and lists the first maxListed of them in differing, in invocation order
+uint32_t ComparePrintfSignatures(const PrintfSignature &a, const PrintfSignature &b, std::vector<uint32_t> &differing, size_t maxListed);
+
+// Builds the signature of every dispatch ReportComputeDispatch reports, and compares or saves it
+// as main() sets it up. Only one thread may use it at a time.
+class PrintfDiff
+{
+public:
+    ~PrintfDiff();
+
+    // Compares each second dispatch with the one before it, in main() the HLSL dispatch with the GLSL one
+    void SetComparePairs(bool compare) { comparePairs = compare; }
+
+    // Saves the signature of every dispatch to a file
+    bool OpenSignatureOutput(const char *path);
+
+    // Compares every dispatch with the signature at the same position in a file OpenSignatureOutput wrote
+    bool OpenBaseline(const char *path);
+
+    bool IsEnabled() const { return comparePairs || nullptr != output || nullptr != baseline; }
+
+    // Closes the files, with the signatures of the dispatches added so far
+    void Close();
+
+    void AddDispatch(uint32_t correlationId, const std::vector<PrintfRecord> &records);
+
+    // The comparisons that found differing invocations, or a baseline without the dispatch
+    uint32_t GetFailedComparisonCount() const { return failedComparisons; }
+
+private:
+    bool ReadBaseline();
+    void Report(const char *against, const PrintfSignature &other);
+
+    bool comparePairs = false;
+    FILE *output = nullptr;
+    FILE *baseline = nullptr;
+
+    uint32_t dispatchCount = 0;
+    uint32_t failedComparisons = 0;
+
+    // The signatures of the dispatch being added, of the one before it, and of its baseline
+    PrintfSignature current;
+    PrintfSignature previous;
+    PrintfSignature expected;
+    std::vector<uint32_t> differing;
+};
+
+// The comparisons main() sets up with --diff-languages, --save-signatures and --diff-against,
+// ReportComputeDispatch adds each dispatch's records to it
+extern PrintfDiff printfDiff;
@@ -0,0 +1,468 @@
+#include "PrintfFormat.h"
+#include "IntegerFormat.h"
+#include <atomic>
+#include <cctype>
+#include <cfloat>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// The formats of the shipped shaders, after their "[dispatch %u] " correlation tag
+#define GLSL_SHADER_FORMAT "GLSL GI ID X value is: %d"
+#define HLSL_SHADER_FORMAT "HLSL GI ID X value is: %d"
+
+static constexpr PrintfOpList<CountPrintfOps(GLSL_SHADER_FORMAT)> glsl_shader_format = PRINTF_FORMAT(GLSL_SHADER_FORMAT);
+static constexpr PrintfOpList<CountPrintfOps(HLSL_SHADER_FORMAT)> hlsl_shader_format = PRINTF_FORMAT(HLSL_SHADER_FORMAT);
+
+static_assert(glsl_shader_format.valid && 2 == glsl_shader_format.count, "GLSL shader format must parse into a literal and a conversion");
+static_assert(hlsl_shader_format.valid && 2 == hlsl_shader_format.count, "HLSL shader format must parse into a literal and a conversion");
+
+// Ids are indices into this table. The compile time formats come first, and the run time
+// formats are appended after them with their ops in runtimeFormatOps.
+static const uint32_t max_printf_formats = 256;
+
+static PrintfFormatView formats[max_printf_formats] = {
+    { GLSL_SHADER_FORMAT, glsl_shader_format.ops, glsl_shader_format.count, glsl_shader_format.argumentCount },
+    { HLSL_SHADER_FORMAT, hlsl_shader_format.ops, hlsl_shader_format.count, hlsl_shader_format.argumentCount }
+};
+static std::atomic<uint32_t> formatCount(2);
+
+static std::mutex registerMutex;
+static std::deque<std::vector<PrintfOp>> runtimeFormatOps;
+
+uint32_t RegisterPrintfFormat(const char *format)
+{
+    std::lock_guard<std::mutex> lock(registerMutex);
+
+    const uint32_t count = formatCount.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (formats[i].format == format)
+        {
+            return i;
+        }
+    }
+
+    if (count == max_printf_formats)
+    {
+        return printf_unknown_format;
+    }
+
+    std::vector<PrintfOp> ops;
+    size_t argumentCount = 0;
+    size_t position = 0;
+    while ('\0' != format[position])
+    {
+        PrintfOp op;
+        position = ParsePrintfOp(format, position, op);
+        if (PRINTF_OP_INVALID == op.type)
+        {
+            return printf_unknown_format;
+        }
+
+        argumentCount += PRINTF_OP_LITERAL != op.type ? 1 : 0;
+        ops.push_back(op);
+    }
+
+    if (argumentCount > printf_max_arguments)
+    {
+        return printf_unknown_format;
+    }
+
+    runtimeFormatOps.push_back(std::move(ops));
+
+    formats[count] = { format, runtimeFormatOps.back().data(), runtimeFormatOps.back().size(), argumentCount };
+    formatCount.store(count + 1, std::memory_order_release);
+
+    return count;
+}
+
+const PrintfFormatView &GetPrintfFormat(uint32_t formatId)
+{
+    static const PrintfFormatView unregistered_format = { "", nullptr, 0, 0 };
+
+    if (formatId >= formatCount.load(std::memory_order_acquire))
+    {
+        return unregistered_format;
+    }
+
+    return formats[formatId];
+}
+
+// Reads the argument of one conversion from the text, returns the position after it or nullptr
+static const char *ParsePrintfArgument(const PrintfOp &op, const char *text, uint64_t &argument)
+{
+    char *end = nullptr;
+
+    switch (op.type)
+    {
+        case PRINTF_OP_SIGNED:
+        {
+            argument = static_cast<uint64_t>(strtoll(text, &end, 10));
+            break;
+        }
+        case PRINTF_OP_UNSIGNED:
+        {
+            const int base = 'o' == op.conversion ? 8 : ('x' == op.conversion || 'X' == op.conversion ? 16 : 10);
+            argument = strtoull(text, &end, base);
+            break;
+        }
+        case PRINTF_OP_FLOAT:
+        {
+            const double value = strtod(text, &end);
+            memcpy(&argument, &value, sizeof(argument));
+            break;
+        }
+        default:
+        {
+            return nullptr;
+        }
+    }
+
+    return end != text ? end : nullptr;
+}
+
+// Matches the text against one format, filling in the arguments when it matches
+static bool MatchFormat(const PrintfFormatView &format, const char *text, uint64_t *arguments)
+{
+    uint32_t argument = 0;
+
+    for (size_t i = 0; i < format.count; i++)
+    {
+        const PrintfOp &op = format.ops[i];
+
+        if (PRINTF_OP_LITERAL == op.type)
+        {
+            if (0 != strncmp(text, format.format + op.offset, op.length))
+            {
+                return false;
+            }
+
+            text += op.length;
+            continue;
+        }
+
+        // Leading padding is skipped by the strto functions, the width is reapplied when the message is rendered
+        text = ParsePrintfArgument(op, text, arguments[argument++]);
+        if (nullptr == text)
+        {
+            return false;
+        }
+    }
+
+    return '\0' == *text;
+}
+
+uint32_t MatchPrintfFormat(const char *text, uint64_t arguments[printf_max_arguments], uint32_t &argumentCount)
+{
+    const uint32_t count = formatCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (MatchFormat(formats[i], text, arguments))
+        {
+            argumentCount = static_cast<uint32_t>(formats[i].argumentCount);
+            return i;
+        }
+    }
+
+    argumentCount = 0;
+    return printf_unknown_format;
+}
+
+// Appends digits of an unsigned value in a base, most significant first
+static void AppendDigits(uint64_t value, uint32_t base, bool upperCase, int32_t precision, std::string &output)
+{
+    char buffer[32];
+    size_t length = 0;
+
+    if (10 == base)
+    {
+        length = FormatDecimal(value, buffer);
+    }
+    else if (16 == base)
+    {
+        length = FormatHex(value, upperCase, buffer);
+    }
+    else
+    {
+        char *position = buffer + sizeof(buffer);
+        do
+        {
+            *--position = static_cast<char>('0' + (value & 7));
+            value >>= 3;
+        } while (0 != value);
+
+        length = static_cast<size_t>(buffer + sizeof(buffer) - position);
+        memmove(buffer, position, length);
+    }
+
+    // A precision is the minimum number of digits, and printf prints no digits for zero with a precision of zero
+    if (0 == precision && 1 == length && '0' == buffer[0])
+    {
+        return;
+    }
+
+    if (precision > 0 && length < static_cast<size_t>(precision))
+    {
+        output.append(static_cast<size_t>(precision) - length, '0');
+    }
+
+    output.append(buffer, length);
+}
+
+// Pads the conversion appended from start to the width of the op, with zeros after the
+// sign and prefix that end at digitsStart when the '0' flag applies, otherwise with spaces
+static void PadConversion(const PrintfOp &op, size_t start, size_t digitsStart, bool zeroPaddable, std::string &output)
+{
+    const size_t length = output.size() - start;
+    if (length >= op.width)
+    {
+        return;
+    }
+
+    const size_t padding = op.width - length;
+    if (0 != (op.flags & PRINTF_FLAG_LEFT))
+    {
+        output.append(padding, ' ');
+    }
+    else if (0 != (op.flags & PRINTF_FLAG_ZERO) && zeroPaddable)
+    {
+        output.insert(digitsStart, padding, '0');
+    }
+    else
+    {
+        output.insert(start, padding, ' ');
+    }
+}
+
+// Appends one integer conversion with its flags, width and precision
+static void RenderInteger(const PrintfOp &op, uint64_t argument, std::string &output)
+{
+    char prefix[2] = {};
+    size_t prefixLength = 0;
+    uint64_t magnitude = argument;
+    uint32_t base = 10;
+
+    if (PRINTF_OP_SIGNED == op.type)
+    {
+        const int64_t value = static_cast<int64_t>(argument);
+        magnitude = value < 0 ? 0 - argument : argument;
+
+        if (value < 0)
+        {
+            prefix[prefixLength++] = '-';
+        }
+        else if (0 != (op.flags & PRINTF_FLAG_PLUS))
+        {
+            prefix[prefixLength++] = '+';
+        }
+        else if (0 != (op.flags & PRINTF_FLAG_SPACE))
+        {
+            prefix[prefixLength++] = ' ';
+        }
+    }
+    else if ('x' == op.conversion || 'X' == op.conversion)
+    {
+        base = 16;
+        if (0 != (op.flags & PRINTF_FLAG_ALTERNATE) && 0 != argument)
+        {
+            prefix[prefixLength++] = '0';
+            prefix[prefixLength++] = op.conversion;
+        }
+    }
+    else if ('o' == op.conversion)
+    {
+        base = 8;
+    }
+
+    const size_t start = output.size();
+    output.append(prefix, prefixLength);
+    const size_t digitsStart = output.size();
+
+    AppendDigits(magnitude, base, 'X' == op.conversion, op.precision, output);
+
+    // '#' makes the first octal digit a zero, which zero and a padding precision already give
+    if ('o' == op.conversion && 0 != (op.flags & PRINTF_FLAG_ALTERNATE) && (output.size() == digitsStart || '0' != output[digitsStart]))
+    {
+        output.insert(digitsStart, 1, '0');
+    }
+
+    PadConversion(op, start, digitsStart, op.precision < 0, output);
+}
+
+// Appends one floating point conversion with snprintf, for the '#' flag std::to_chars has no equivalent of
+static void RenderFloatWithSnprintf(const PrintfOp &op, double value, const char *format, std::string &output)
+{
+    // The conversion spec is reused from the format string, without any length modifier
+    char spec[32] = {};
+    size_t specLength = 0;
+    for (size_t i = 0; i < op.length && specLength + 1 < sizeof(spec); i++)
+    {
+        if ('l' != format[op.offset + i])
+        {
+            spec[specLength++] = format[op.offset + i];
+        }
+    }
+
+    char buffer[512];
+    const int length = snprintf(buffer, sizeof(buffer), spec, value);
+    if (length > 0)
+    {
+        output.append(buffer, static_cast<size_t>(length) < sizeof(buffer) ? static_cast<size_t>(length) : sizeof(buffer) - 1);
+    }
+}
+
+// Appends one floating point conversion, rounded as printf would round it. The "f", "e" and
+// "g" conversions take printf's default precision of 6 when they have none, so the text is the
+// same as the layer's, which rounded the argument to that many digits before it was parsed.
+// Without a precision "a" is written exactly, as printf writes it.
+static void RenderFloat(const PrintfOp &op, uint64_t argument, const char *format, std::string &output)
+{
+    double value = 0.0;
+    memcpy(&value, &argument, sizeof(value));
+
+    if (0 != (op.flags & PRINTF_FLAG_ALTERNATE))
+    {
+        RenderFloatWithSnprintf(op, value, format, output);
+        return;
+    }
+
+    const char conversion = static_cast<char>(tolower(op.conversion));
+    std::chars_format notation = std::chars_format::general;
+    if ('f' == conversion)
+    {
+        notation = std::chars_format::fixed;
+    }
+    else if ('e' == conversion)
+    {
+        notation = std::chars_format::scientific;
+    }
+    else if ('a' == conversion)
+    {
+        notation = std::chars_format::hex;
+    }
+
+    // Doubles of up to 309 integer digits and 127 fraction digits fit
+    char buffer[512];
+    const double magnitude = std::fabs(value);
+
+    const int32_t precision = op.precision < 0 && 'a' != conversion ? 6 : op.precision;
+
+    std::to_chars_result result;
+    if (precision >= 0)
+    {
+        result = std::to_chars(buffer, buffer + sizeof(buffer), magnitude, notation, precision);
+    }
+    else if (4 == op.size && magnitude <= FLT_MAX)
+    {
+        result = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<float>(magnitude), notation);
+    }
+    else
+    {
+        result = std::to_chars(buffer, buffer + sizeof(buffer), magnitude, notation);
+    }
+
+    if (std::errc() != result.ec)
+    {
+        RenderFloatWithSnprintf(op, value, format, output);
+        return;
+    }
+
+    const size_t start = output.size();
+    if (std::signbit(value))
+    {
+        output.push_back('-');
+    }
+    else if (0 != (op.flags & PRINTF_FLAG_PLUS))
+    {
+        output.push_back('+');
+    }
+    else if (0 != (op.flags & PRINTF_FLAG_SPACE))
+    {
+        output.push_back(' ');
+    }
+
+    if ('a' == conversion && std::isfinite(value))
+    {
+        output.push_back('0');
+        output.push_back('A' == op.conversion ? 'X' : 'x');
+    }
+
+    const size_t digitsStart = output.size();
+    output.append(buffer, static_cast<size_t>(result.ptr - buffer));
+
+    if (isupper(static_cast<unsigned char>(op.conversion)))
+    {
+        for (size_t i = digitsStart; i < output.size(); i++)
+        {
+            output[i] = static_cast<char>(toupper(static_cast<unsigned char>(output[i])));
+        }
+    }
+
+    PadConversion(op, start, digitsStart, std::isfinite(value), output);
+}
+
+void RenderPrintfFormat(const PrintfFormatView &format, const uint64_t *arguments, std::string &output)
+{
+    uint32_t argument = 0;
+
+    for (size_t i = 0; i < format.count; i++)
+    {
+        const PrintfOp &op = format.ops[i];
+
+        switch (op.type)
+        {
+            case PRINTF_OP_LITERAL:
+            {
+                output.append(format.format + op.offset, op.length);
+                break;
+            }
+            case PRINTF_OP_SIGNED:
+            case PRINTF_OP_UNSIGNED:
+            {
+                RenderInteger(op, arguments[argument++], output);
+                break;
+            }
+            case PRINTF_OP_FLOAT:
+            {
+                RenderFloat(op, arguments[argument++], format.format, output);
+                break;
+            }
+            default:
+            {
+                break;
+            }
+        }
+    }
+}
+
+std::string GetPrintfArgumentName(const PrintfFormatView &format, size_t opIndex, uint32_t argumentIndex)
+{
+    if (opIndex > 0 && PRINTF_OP_LITERAL == format.ops[opIndex - 1].type)
+    {
+        const PrintfOp &literal = format.ops[opIndex - 1];
+        const char *start = format.format + literal.offset;
+        const char *end = start + literal.length;
+
+        while (start < end && nullptr != strchr(" :=,;(", *start))
+        {
+            start++;
+        }
+        while (end > start && nullptr != strchr(" :=,;(", end[-1]))
+        {
+            end--;
+        }
+
+        if (end > start)
+        {
+            return std::string(start, end);
+        }
+    }
+
+    return "arg" + std::to_string(argumentIndex);
+}
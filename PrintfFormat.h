@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A printf format string parsed into a list of ops, each either a span of literal text or one
+// conversion with its flags, width and precision. Rendering a message then walks the ops and
+// formats the arguments, without parsing the format string again.
+//
+// The formats of the shipped shaders are parsed at compile time with PRINTF_FORMAT, other
+// formats are parsed once at run time by RegisterPrintfFormat.
+
+enum PrintfOpType : uint8_t
+{
+    PRINTF_OP_LITERAL,
+    PRINTF_OP_SIGNED,    // %d %i
+    PRINTF_OP_UNSIGNED,  // %u %o %x %X
+    PRINTF_OP_FLOAT,     // %f %F %e %E %g %G %a %A
+    PRINTF_OP_INVALID    // Anything debugPrintfEXT does not support, or vectors (%v)
+};
+
+enum PrintfFlags : uint8_t
+{
+    PRINTF_FLAG_LEFT = 1,       // -
+    PRINTF_FLAG_PLUS = 2,       // +
+    PRINTF_FLAG_SPACE = 4,      // ' '
+    PRINTF_FLAG_ALTERNATE = 8,  // #
+    PRINTF_FLAG_ZERO = 16       // 0
+};
+
+struct PrintfOp
+{
+    PrintfOpType type = PRINTF_OP_LITERAL;
+
+    // The conversion character, for example 'd' or 'x'
+    char conversion = 0;
+    uint8_t flags = 0;
+    uint8_t width = 0;
+
+    // -1 when the conversion has no precision
+    int8_t precision = -1;
+
+    // The size of the argument in the shader, 8 with the "l" length modifier
+    uint8_t size = 4;
+
+    // The span of the format string this op covers, literal ops copy it as it is
+    uint16_t offset = 0;
+    uint16_t length = 0;
+};
+
+// The most arguments a format can take
+static const uint32_t printf_max_arguments = 8;
+
+// Parses the op starting at position into op, returns the position after it
+// "%%" is a literal op covering only the second '%'
+constexpr size_t ParsePrintfOp(const char *format, size_t position, PrintfOp &op)
+{
+    op = PrintfOp();
+    op.offset = static_cast<uint16_t>(position);
+
+    if ('%' != format[position] || '%' == format[position + 1])
+    {
+        size_t end = '%' == format[position] ? position + 1 : position;
+        op.offset = static_cast<uint16_t>(end);
+        end++;
+
+        while ('\0' != format[end] && '%' != format[end])
+        {
+            end++;
+        }
+
+        op.length = static_cast<uint16_t>(end - op.offset);
+        return end;
+    }
+
+    size_t end = position + 1;
+
+    for (bool flag = true; flag; )
+    {
+        switch (format[end])
+        {
+            case '-': op.flags |= PRINTF_FLAG_LEFT; end++; break;
+            case '+': op.flags |= PRINTF_FLAG_PLUS; end++; break;
+            case ' ': op.flags |= PRINTF_FLAG_SPACE; end++; break;
+            case '#': op.flags |= PRINTF_FLAG_ALTERNATE; end++; break;
+            case '0': op.flags |= PRINTF_FLAG_ZERO; end++; break;
+            default: flag = false; break;
+        }
+    }
+
+    uint32_t width = 0;
+    while (format[end] >= '0' && format[end] <= '9')
+    {
+        width = width * 10 + static_cast<uint32_t>(format[end++] - '0');
+    }
+    op.width = static_cast<uint8_t>(width < 255 ? width : 255);
+
+    if ('.' == format[end])
+    {
+        uint32_t precision = 0;
+        end++;
+        while (format[end] >= '0' && format[end] <= '9')
+        {
+            precision = precision * 10 + static_cast<uint32_t>(format[end++] - '0');
+        }
+        op.precision = static_cast<int8_t>(precision < 127 ? precision : 127);
+    }
+
+    // 64-bit arguments are written "%lu", "%ld" or "%lx", the arguments are always held as 64 bits
+    while ('l' == format[end])
+    {
+        op.size = 8;
+        end++;
+    }
+
+    op.conversion = format[end];
+    switch (format[end])
+    {
+        case 'd': case 'i':
+            op.type = PRINTF_OP_SIGNED;
+            break;
+        case 'u': case 'o': case 'x': case 'X':
+            op.type = PRINTF_OP_UNSIGNED;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            op.type = PRINTF_OP_FLOAT;
+            break;
+        default:
+            op.type = PRINTF_OP_INVALID;
+            break;
+    }
+
+    if ('\0' != format[end])
+    {
+        end++;
+    }
+
+    op.length = static_cast<uint16_t>(end - position);
+    return end;
+}
+
+constexpr size_t CountPrintfOps(const char *format)
+{
+    size_t count = 0;
+    size_t position = 0;
+    while ('\0' != format[position])
+    {
+        PrintfOp op;
+        position = ParsePrintfOp(format, position, op);
+        count++;
+    }
+
+    return count;
+}
+
+template <size_t N>
+struct PrintfOpList
+{
+    PrintfOp ops[N > 0 ? N : 1] = {};
+    size_t count = 0;
+    size_t argumentCount = 0;
+    bool valid = true;
+};
+
+template <size_t N>
+constexpr PrintfOpList<N> ParsePrintfFormat(const char *format)
+{
+    PrintfOpList<N> list;
+
+    size_t position = 0;
+    while ('\0' != format[position] && list.count < N)
+    {
+        PrintfOp &op = list.ops[list.count++];
+        position = ParsePrintfOp(format, position, op);
+
+        list.valid = list.valid && PRINTF_OP_INVALID != op.type;
+        list.argumentCount += PRINTF_OP_LITERAL != op.type ? 1 : 0;
+    }
+
+    list.valid = list.valid && list.argumentCount <= printf_max_arguments;
+
+    return list;
+}
+
+// Parses a string literal into a PrintfOpList at compile time
+#define PRINTF_FORMAT(format) ParsePrintfFormat<CountPrintfOps(format)>(format)
+
+// A parsed format, wherever its ops are stored
+struct PrintfFormatView
+{
+    const char *format = nullptr;
+    const PrintfOp *ops = nullptr;
+    size_t count = 0;
+    size_t argumentCount = 0;
+};
+
+// The format id of messages that match no known format, which are kept as text
+static const uint32_t printf_unknown_format = ~0u;
+
+// Parses a format at run time and returns its id, or printf_unknown_format if it cannot be parsed
+// The format string must outlive the registry. Registering the same pointer twice returns the same id.
+uint32_t RegisterPrintfFormat(const char *format);
+
+// Returns the format with an id returned by RegisterPrintfFormat or MatchPrintfFormat. Any other
+// id, such as printf_unknown_format or one read from a file, gets an empty format without ops.
+const PrintfFormatView &GetPrintfFormat(uint32_t formatId);
+
+// Finds the known format the text of a message was printed with and extracts its arguments
+// Returns printf_unknown_format if no format matches
+uint32_t MatchPrintfFormat(const char *text, uint64_t arguments[printf_max_arguments], uint32_t &argumentCount);
+
+// Appends a message rendered from its format and arguments
+void RenderPrintfFormat(const PrintfFormatView &format, const uint64_t *arguments, std::string &output);
+
+// Names the argument of the conversion at opIndex after the literal text in front of it, without
+// the separators around it, so "GLSL GI ID X value is: %d" gives "GLSL GI ID X value is". An
+// argument without literal text in front of it is named "arg" and its argumentIndex.
+std::string GetPrintfArgumentName(const PrintfFormatView &format, size_t opIndex, uint32_t argumentIndex);
@@ -0,0 +1,243 @@
+#include "PrintfQuery.h"
+#include "IntegerFormat.h"
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+// The bytes of one value of each column type, a text column holds uint32 offsets
+static const size_t column_type_sizes[] = { 4, 4, 8, 8, 4, 8, 4 };
+
+// Returns the values of a column if they lie inside the chunk, aligned, and with one value per
+// row, or one more for the offsets of a text column. Returns nullptr otherwise.
+static const uint8_t *GetColumnValues(const uint8_t *chunk, const PrintfColumnChunkHeader &header, const PrintfColumnDescriptor &descriptor)
+{
+    if (descriptor.type > PRINTF_COLUMN_TEXT)
+    {
+        return nullptr;
+    }
+
+    const size_t valueSize = column_type_sizes[descriptor.type];
+    const uint64_t valueCount = header.rowCount + (PRINTF_COLUMN_TEXT == descriptor.type ? 1 : 0);
+
+    if (descriptor.valuesSize != valueCount * valueSize || 0 != descriptor.valuesOffset % valueSize ||
+        descriptor.valuesOffset > header.chunkSize || header.chunkSize - descriptor.valuesOffset < descriptor.valuesSize)
+    {
+        return nullptr;
+    }
+
+    return chunk + descriptor.valuesOffset;
+}
+
+// Widens a value of an argument column back to the 64-bit argument RenderPrintfFormat takes
+static uint64_t WidenArgument(PrintfColumnType type, const uint8_t *values, uint32_t row)
+{
+    switch (type)
+    {
+        case PRINTF_COLUMN_INT32:
+        {
+            int32_t value = 0;
+            memcpy(&value, values + row * sizeof(value), sizeof(value));
+            return static_cast<uint64_t>(static_cast<int64_t>(value));
+        }
+        case PRINTF_COLUMN_UINT32:
+        {
+            uint32_t value = 0;
+            memcpy(&value, values + row * sizeof(value), sizeof(value));
+            return value;
+        }
+        case PRINTF_COLUMN_FLOAT32:
+        {
+            float value = 0.0f;
+            memcpy(&value, values + row * sizeof(value), sizeof(value));
+
+            const double widened = value;
+            uint64_t bits = 0;
+            memcpy(&bits, &widened, sizeof(bits));
+            return bits;
+        }
+        case PRINTF_COLUMN_INT64:
+        case PRINTF_COLUMN_UINT64:
+        case PRINTF_COLUMN_FLOAT64:
+        {
+            uint64_t value = 0;
+            memcpy(&value, values + row * sizeof(value), sizeof(value));
+            return value;
+        }
+        case PRINTF_COLUMN_TEXT:
+            break;
+    }
+
+    // RunPrintfQuery only takes text columns in the chunks of messages with an unknown format
+    return 0;
+}
+
+// Registers the format string of a chunk with the format registry, once per distinct string,
+// and returns its id in this process, which need not be the id it had in the file
+static uint32_t GetQueryFormat(const uint8_t *chunk, const PrintfColumnChunkHeader &header)
+{
+    // The registry keeps pointers to the strings, the keys of a map never move
+    static std::map<std::string, uint32_t> formats;
+
+    if (header.formatOffset > header.chunkSize || header.chunkSize - header.formatOffset < header.formatLength)
+    {
+        return printf_unknown_format;
+    }
+
+    const std::string format(reinterpret_cast<const char *>(chunk) + header.formatOffset, header.formatLength);
+
+    auto found = formats.find(format);
+    if (formats.end() == found)
+    {
+        found = formats.emplace(format, printf_unknown_format).first;
+        found->second = RegisterPrintfFormat(found->first.c_str());
+    }
+
+    return found->second;
+}
+
+// Returns whether the index entry of a chunk leaves room for a row the query matches
+static bool MayMatch(const PrintfColumnIndexEntry &entry, const PrintfQuery &query)
+{
+    return entry.minCorrelationId <= query.lastCorrelationId && entry.maxCorrelationId >= query.firstCorrelationId &&
+        entry.minInvocation <= query.lastInvocation && entry.maxInvocation >= query.firstInvocation &&
+        (!query.matchFormat || entry.formatId == query.formatId);
+}
+
+bool RunPrintfQuery(PrintfColumnReader &reader, const PrintfQuery &query, FILE *output, PrintfQueryStatistics &statistics)
+{
+    std::vector<uint64_t> chunkWords;
+    std::string lines;
+    char number[integer_format_max_length];
+
+    for (uint32_t chunk = 0; chunk < reader.GetChunkCount(); chunk++)
+    {
+        if (!MayMatch(reader.GetChunk(chunk), query))
+        {
+            statistics.chunksSkipped++;
+            continue;
+        }
+
+        if (!reader.ReadChunk(chunk, chunkWords))
+        {
+            return false;
+        }
+
+        statistics.chunksRead++;
+
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(chunkWords.data());
+
+        PrintfColumnChunkHeader header = {};
+        memcpy(&header, bytes, sizeof(header));
+        const PrintfColumnDescriptor *descriptors = reinterpret_cast<const PrintfColumnDescriptor *>(bytes + sizeof(header));
+
+        if (PRINTF_COLUMN_UINT32 != descriptors[1].type || PRINTF_COLUMN_UINT32 != descriptors[2].type)
+        {
+            return false;
+        }
+
+        const uint32_t *correlationIds = reinterpret_cast<const uint32_t *>(GetColumnValues(bytes, header, descriptors[1]));
+        const uint32_t *invocations = reinterpret_cast<const uint32_t *>(GetColumnValues(bytes, header, descriptors[2]));
+        if (nullptr == correlationIds || nullptr == invocations)
+        {
+            return false;
+        }
+
+        // The argument columns, or the text column of the messages with an unknown format
+        const uint32_t argumentCount = header.columnCount - printf_column_fixed_count;
+        const uint8_t *arguments[printf_max_arguments] = {};
+        const char *text = nullptr;
+        uint32_t formatId = printf_unknown_format;
+
+        if (argumentCount > printf_max_arguments)
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < argumentCount; i++)
+        {
+            // A text column holds 4-byte offsets, which WidenArgument cannot read as an argument
+            const PrintfColumnDescriptor &descriptor = descriptors[printf_column_fixed_count + i];
+            if (PRINTF_COLUMN_TEXT == descriptor.type && printf_unknown_format != header.formatId)
+            {
+                return false;
+            }
+
+            arguments[i] = GetColumnValues(bytes, header, descriptor);
+            if (nullptr == arguments[i])
+            {
+                return false;
+            }
+        }
+
+        if (printf_unknown_format == header.formatId)
+        {
+            const PrintfColumnDescriptor &textColumn = descriptors[printf_column_fixed_count];
+            if (1 != argumentCount || PRINTF_COLUMN_TEXT != textColumn.type ||
+                textColumn.dataOffset > header.chunkSize || header.chunkSize - textColumn.dataOffset < textColumn.dataSize)
+            {
+                return false;
+            }
+
+            text = reinterpret_cast<const char *>(bytes) + textColumn.dataOffset;
+        }
+        else
+        {
+            formatId = GetQueryFormat(bytes, header);
+            if (printf_unknown_format == formatId || GetPrintfFormat(formatId).argumentCount != argumentCount)
+            {
+                return false;
+            }
+        }
+
+        statistics.rowsScanned += header.rowCount;
+
+        lines.clear();
+        for (uint32_t row = 0; row < header.rowCount; row++)
+        {
+            if (correlationIds[row] < query.firstCorrelationId || correlationIds[row] > query.lastCorrelationId ||
+                invocations[row] < query.firstInvocation || invocations[row] > query.lastInvocation)
+            {
+                continue;
+            }
+
+            statistics.rowsMatched++;
+
+            lines += PRINTF_CORRELATION_TAG;
+            lines.append(number, FormatDecimal(correlationIds[row], number));
+            if (printf_unknown_invocation != invocations[row])
+            {
+                lines += PRINTF_INVOCATION_TAG;
+                lines.append(number, FormatDecimal(invocations[row], number));
+            }
+            lines += "] ";
+
+            if (nullptr != text)
+            {
+                const uint32_t *offsets = reinterpret_cast<const uint32_t *>(arguments[0]);
+                if (offsets[row] > offsets[row + 1] || offsets[row + 1] > descriptors[printf_column_fixed_count].dataSize)
+                {
+                    return false;
+                }
+
+                lines.append(text + offsets[row], offsets[row + 1] - offsets[row]);
+            }
+            else
+            {
+                uint64_t values[printf_max_arguments] = {};
+                for (uint32_t i = 0; i < argumentCount; i++)
+                {
+                    values[i] = WidenArgument(descriptors[printf_column_fixed_count + i].type, arguments[i], row);
+                }
+
+                RenderPrintfFormat(GetPrintfFormat(formatId), values, lines);
+            }
+
+            lines += '\n';
+        }
+
+        fwrite(lines.data(), 1, lines.size(), output);
+    }
+
+    return true;
+}
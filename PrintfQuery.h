@@ -0,0 +1,36 @@
+#pragma once
+
+#include "PrintfColumns.h"
+#include <cstdint>
+#include <cstdio>
+
+// Answers questions such as "the messages of invocations 4096 to 8191 of dispatch 17" from a
+// column file. The index of the file gives the correlation id, format and invocation ranges of
+// every chunk, so only the chunks that can hold a match are read, and only their correlationId
+// and invocation columns are scanned before the matching rows are rendered back to text.
+
+// All ranges are inclusive, the default query matches every message
+struct PrintfQuery
+{
+    uint32_t firstCorrelationId = 0;
+    uint32_t lastCorrelationId = ~0u;
+    uint32_t firstInvocation = 0;
+    uint32_t lastInvocation = ~0u;
+
+    // The format id of the file to match, when matchFormat is set
+    bool matchFormat = false;
+    uint32_t formatId = printf_unknown_format;
+};
+
+struct PrintfQueryStatistics
+{
+    uint32_t chunksRead = 0;
+    uint32_t chunksSkipped = 0;
+    uint64_t rowsScanned = 0;
+    uint64_t rowsMatched = 0;
+};
+
+// Writes the matching messages to output as "[dispatch N invocation I] text" lines, a chunk at
+// a time, so the messages are grouped by format in the order the chunks were written. Within a
+// dispatch and format they come in invocation order. Returns false if a chunk is corrupt.
+bool RunPrintfQuery(PrintfColumnReader &reader, const PrintfQuery &query, FILE *output, PrintfQueryStatistics &statistics);
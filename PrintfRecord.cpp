@@ -0,0 +1,186 @@
+#include "PrintfRecord.h"
+#include "ClockCalibration.h"
+#include "RadixSort.h"
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+// The records of one dispatch
+struct PrintfCaptureSlot
+{
+    std::mutex mutex;
+    uint32_t correlationId = 0;
+    std::vector<PrintfRecord> records;
+};
+
+static PrintfCaptureSlot captureSlots[printf_capture_slots];
+static std::atomic<uint64_t> nextSequence(0);
+
+// Parses the decimal number at digit, returns nullptr if there is none
+static const char *ParseTagNumber(const char *digit, uint32_t &value)
+{
+    if (*digit < '0' || *digit > '9')
+    {
+        return nullptr;
+    }
+
+    value = 0;
+    while (*digit >= '0' && *digit <= '9')
+    {
+        value = value * 10 + static_cast<uint32_t>(*digit - '0');
+        digit++;
+    }
+
+    return digit;
+}
+
+bool DecodePrintfRecord(const char *message, uint32_t &correlationId, uint32_t &invocation, const char *&text)
+{
+    const char *tag = strstr(message, PRINTF_CORRELATION_TAG);
+    if (nullptr == tag)
+    {
+        return false;
+    }
+
+    uint32_t id = 0;
+    const char *digit = ParseTagNumber(tag + strlen(PRINTF_CORRELATION_TAG), id);
+    if (nullptr == digit)
+    {
+        return false;
+    }
+
+    uint32_t index = printf_unknown_invocation;
+    if (0 == strncmp(digit, PRINTF_INVOCATION_TAG, strlen(PRINTF_INVOCATION_TAG)))
+    {
+        digit = ParseTagNumber(digit + strlen(PRINTF_INVOCATION_TAG), index);
+        if (nullptr == digit)
+        {
+            return false;
+        }
+    }
+
+    if (']' != *digit)
+    {
+        return false;
+    }
+
+    digit++;
+    if (' ' == *digit)
+    {
+        digit++;
+    }
+
+    correlationId = id;
+    invocation = index;
+    text = digit;
+
+    return true;
+}
+
+void BeginPrintfCapture(uint32_t correlationId)
+{
+    PrintfCaptureSlot &slot = captureSlots[correlationId % printf_capture_slots];
+
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    slot.correlationId = correlationId;
+    slot.records.clear();
+}
+
+bool ParsePrintfMessage(const char *message, PrintfRecord &record, const char *&text)
+{
+    if (!DecodePrintfRecord(message, record.correlationId, record.invocation, text))
+    {
+        return false;
+    }
+
+    record.hostTime = GetHostNanoseconds();
+    record.formatId = MatchPrintfFormat(text, record.arguments, record.argumentCount);
+
+    return true;
+}
+
+void StorePrintfRecord(PrintfRecord &&record)
+{
+    record.sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);
+
+    PrintfCaptureSlot &slot = captureSlots[record.correlationId % printf_capture_slots];
+
+    std::lock_guard<std::mutex> lock(slot.mutex);
+
+    // A message for a dispatch whose slot has been reused is late, and is dropped
+    if (slot.correlationId != record.correlationId)
+    {
+        return;
+    }
+
+    slot.records.push_back(std::move(record));
+}
+
+bool CapturePrintfMessage(const char *message)
+{
+    PrintfRecord record = {};
+
+    const char *text = nullptr;
+    if (!ParsePrintfMessage(message, record, text))
+    {
+        return false;
+    }
+
+    if (printf_unknown_format == record.formatId)
+    {
+        record.text = text;
+    }
+
+    StorePrintfRecord(std::move(record));
+
+    return true;
+}
+
+std::vector<PrintfRecord> TakePrintfRecords(uint32_t correlationId)
+{
+    PrintfCaptureSlot &slot = captureSlots[correlationId % printf_capture_slots];
+
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    if (slot.correlationId != correlationId)
+    {
+        return {};
+    }
+
+    std::vector<PrintfRecord> records;
+    records.swap(slot.records);
+
+    return records;
+}
+
+void RenderPrintfRecord(const PrintfRecord &record, std::string &output)
+{
+    if (printf_unknown_format == record.formatId)
+    {
+        output += record.text;
+        return;
+    }
+
+    RenderPrintfFormat(GetPrintfFormat(record.formatId), record.arguments, output);
+}
+
+void OrderPrintfRecordsByInvocation(const std::vector<PrintfRecord> &records, std::vector<uint32_t> &order)
+{
+    // The record indices ride in the lower word of the keys, in arrival order, which the stable sort keeps for each invocation
+    // The buffers are kept from one dispatch to the next, so their pages are only mapped once
+    thread_local std::vector<uint64_t> keys;
+    thread_local std::vector<uint64_t> scratch;
+
+    keys.resize(records.size());
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        keys[i] = (static_cast<uint64_t>(records[i].invocation) << 32) | i;
+    }
+
+    RadixSortByUpperWord(keys, scratch, GetRadixSortThreadCount(keys.size()));
+
+    order.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        order[i] = static_cast<uint32_t>(keys[i]);
+    }
+}
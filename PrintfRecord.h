@@ -0,0 +1,68 @@
+#pragma once
+
+#include "PrintfFormat.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Every shader prints the correlation id it receives in its push constants at the start of
+// each message, as "[dispatch <id>] <text>", so that a message can be traced back to the
+// dispatch that produced it even when several dispatches are in flight. The shipped shaders
+// also print the index of their invocation, as "[dispatch <id> invocation <index>] <text>",
+// where the index is workgroup index * workgroup size + local invocation index.
+#define PRINTF_CORRELATION_TAG "[dispatch "
+#define PRINTF_INVOCATION_TAG " invocation "
+
+// The invocation of messages whose tag does not have one, they are ordered after all the others
+static const uint32_t printf_unknown_invocation = ~0u;
+
+// The number of dispatches whose records are kept at once, a dispatch's records are found in
+// slot (correlation id % printf_capture_slots) and are dropped when that slot is reused
+static const uint32_t printf_capture_slots = 64;
+
+// One printf message captured by VulkanDebugCallback
+struct PrintfRecord
+{
+    uint32_t correlationId = 0;
+    uint32_t invocation = printf_unknown_invocation;
+
+    // The order the message arrived in among all captured messages
+    uint64_t sequence = 0;
+
+    // When the message arrived, on the host clock of GetHostNanoseconds
+    int64_t hostTime = 0;
+
+    // Messages printed with a known format are kept as the format id and their arguments,
+    // see PrintfFormat.h, and only the others keep their text (without the correlation tag)
+    uint32_t formatId = printf_unknown_format;
+    uint32_t argumentCount = 0;
+    uint64_t arguments[printf_max_arguments] = {};
+    std::string text;
+};
+
+// Splits the correlation id and invocation off a printf message, returns false if the message has no tag
+// The validation layer may put its own header in front of the shader's text, so the tag is searched for
+bool DecodePrintfRecord(const char *message, uint32_t &correlationId, uint32_t &invocation, const char *&text);
+
+// Clears the records of the slot a dispatch is about to use, called before it is submitted
+void BeginPrintfCapture(uint32_t correlationId);
+
+// Stamps a printf message with its correlation id and stores it with its dispatch
+// Returns false if the message has no correlation tag
+bool CapturePrintfMessage(const char *message);
+
+// The two halves of CapturePrintfMessage, for callers that look at the record before it is stored.
+// ParsePrintfMessage fills in everything but the sequence and, for unknown formats, the text, which
+// it points to instead. StorePrintfRecord assigns the sequence and moves the record into its slot.
+bool ParsePrintfMessage(const char *message, PrintfRecord &record, const char *&text);
+void StorePrintfRecord(PrintfRecord &&record);
+
+// Removes and returns the records of a dispatch, in arrival order
+std::vector<PrintfRecord> TakePrintfRecords(uint32_t correlationId);
+
+// Appends the text of a record, without its correlation tag
+void RenderPrintfRecord(const PrintfRecord &record, std::string &output);
+
+// Fills order with the indices of the records sorted by invocation, the records of one invocation
+// staying in the order they arrived in, which is the order the invocation printed them in
+void OrderPrintfRecordsByInvocation(const std::vector<PrintfRecord> &records, std::vector<uint32_t> &order);
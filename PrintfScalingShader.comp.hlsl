@@ -0,0 +1,22 @@
+// glslangValidator -V -e main $(ProjectDir)\PrintfScalingShader.comp.hlsl -o $(ProjectDir)\PrintfScalingShader.hlsl.spv
+
+// correlationId identifies the dispatch, and starts every message with the index of the
+// invocation in (workgroup, local invocation) order, which the messages can be sorted by
+// printThreshold selects the fraction of invocations that print, out of 65536
+struct PushConstants
+{
+	uint correlationId;
+	uint printThreshold;
+};
+
+[[vk::push_constant]] ConstantBuffer<PushConstants> pushConstants;
+
+[numthreads(512, 1, 1)]
+void main( uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex )
+{
+	// Spread the printing invocations over the whole dispatch with a multiplicative hash
+	if (((DTid[0] * 2654435761u) >> 16) < pushConstants.printThreshold)
+	{
+		printf("[dispatch %u invocation %u] HLSL GI ID X value is: %d", pushConstants.correlationId, Gid[0] * 512 + GI, DTid[0]);
+	}
+}
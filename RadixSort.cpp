@@ -0,0 +1,229 @@
+#include "RadixSort.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+static const uint32_t radix_bits = 8;
+static const uint32_t radix_size = 1 << radix_bits;
+
+// Items up to this count are sorted in one piece, both buffers of them stay in the L2 cache
+static const size_t radix_sort_cache_items = 32 * 1024;
+
+// Below this many items per thread, starting a thread for a pass costs more than it saves
+static const size_t radix_sort_items_per_thread = 64 * 1024;
+
+uint32_t GetRadixSortThreadCount(size_t count)
+{
+    const size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    return static_cast<uint32_t>(std::max<size_t>(1, std::min(hardwareThreads, count / radix_sort_items_per_thread)));
+}
+
+static inline uint32_t GetDigit(uint64_t item, uint32_t shift, uint32_t mask)
+{
+    return static_cast<uint32_t>(item >> (32 + shift)) & mask;
+}
+
+// Runs work(part, begin, end) over partCount contiguous parts of count items, the calling thread takes the first part
+template <typename Work>
+static void ForEachPart(size_t count, uint32_t partCount, const Work &work)
+{
+    const size_t partSize = (count + partCount - 1) / partCount;
+
+    std::vector<std::thread> threads;
+    for (uint32_t part = 1; part < partCount; part++)
+    {
+        const size_t begin = std::min(count, part * partSize);
+        const size_t end = std::min(count, begin + partSize);
+        threads.emplace_back([&work, part, begin, end]() { work(part, begin, end); });
+    }
+
+    work(0, 0, std::min(count, partSize));
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+// The number of passes of at most radix_bits that cover the key bits [lowBit, highBit)
+static inline uint32_t GetPassCount(uint32_t lowBit, uint32_t highBit)
+{
+    return (highBit - lowBit + radix_bits - 1) / radix_bits;
+}
+
+// Sorts count items by the key bits [lowBit, highBit) with one thread, in passes of equal width
+// that alternate between the two buffers. The result is in source after an even number of
+// passes and in destination after an odd one.
+static void SortDigits(uint64_t *source, uint64_t *destination, size_t count, uint32_t lowBit, uint32_t highBit)
+{
+    const uint32_t passCount = GetPassCount(lowBit, highBit);
+    if (0 == passCount)
+    {
+        return;
+    }
+
+    const uint32_t bits = (highBit - lowBit + passCount - 1) / passCount;
+    const uint32_t mask = (1u << bits) - 1;
+
+    size_t offsets[radix_size];
+
+    for (uint32_t pass = 0; pass < passCount; pass++)
+    {
+        const uint32_t shift = lowBit + pass * bits;
+
+        std::fill(offsets, offsets + radix_size, 0);
+        for (size_t i = 0; i < count; i++)
+        {
+            offsets[GetDigit(source[i], shift, mask)]++;
+        }
+
+        size_t offset = 0;
+        for (uint32_t digit = 0; digit <= mask; digit++)
+        {
+            const size_t digitCount = offsets[digit];
+            offsets[digit] = offset;
+            offset += digitCount;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const uint64_t item = source[i];
+            destination[offsets[GetDigit(item, shift, mask)]++] = item;
+        }
+
+        std::swap(source, destination);
+    }
+}
+
+void RadixSortByUpperWord(std::vector<uint64_t> &items, std::vector<uint64_t> &scratch, uint32_t threadCount)
+{
+    const size_t count = items.size();
+    if (count < 2)
+    {
+        return;
+    }
+
+    threadCount = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(threadCount, count)));
+    scratch.resize(count);
+
+    // The key bits that differ between any two keys, only the passes over them reorder anything
+    std::vector<uint64_t> partBits(threadCount * 2, 0);
+    ForEachPart(count, threadCount, [&](uint32_t part, size_t begin, size_t end)
+    {
+        uint64_t allSet = ~0ull;
+        uint64_t anySet = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            allSet &= items[i];
+            anySet |= items[i];
+        }
+        partBits[part * 2] = allSet;
+        partBits[part * 2 + 1] = anySet;
+    });
+
+    uint64_t allSet = ~0ull;
+    uint64_t anySet = 0;
+    for (uint32_t part = 0; part < threadCount; part++)
+    {
+        // A part past the end of the items is empty and leaves its masks as they started
+        allSet &= partBits[part * 2];
+        anySet |= partBits[part * 2 + 1];
+    }
+
+    const uint32_t differingBits = static_cast<uint32_t>((allSet ^ anySet) >> 32);
+    if (0 == differingBits)
+    {
+        return;
+    }
+
+    uint32_t lowBit = 0;
+    while (0 == (differingBits & (1u << lowBit)))
+    {
+        lowBit++;
+    }
+
+    uint32_t highBit = 32;
+    while (0 == (differingBits & (1u << (highBit - 1))))
+    {
+        highBit--;
+    }
+
+    if (count <= radix_sort_cache_items)
+    {
+        SortDigits(items.data(), scratch.data(), count, lowBit, highBit);
+        if (1 == GetPassCount(lowBit, highBit) % 2)
+        {
+            items.swap(scratch);
+        }
+        return;
+    }
+
+    // Passes over the whole array scatter into far more memory than the caches hold, so only
+    // the first pass does, on the highest digit. It splits the items into buckets that are then
+    // sorted on their own by the lower digits, in the cache, and on as many threads as there are.
+    const uint32_t topBits = std::min(radix_bits, highBit - lowBit);
+    const uint32_t topShift = highBit - topBits;
+    const uint32_t topMask = (1u << topBits) - 1;
+
+    // offsets[part * radix_size + digit] is first the count of the digit in the part, then where the part scatters it
+    std::vector<size_t> offsets(threadCount * radix_size);
+
+    ForEachPart(count, threadCount, [&](uint32_t part, size_t begin, size_t end)
+    {
+        size_t *const partOffsets = &offsets[part * radix_size];
+        std::fill(partOffsets, partOffsets + radix_size, 0);
+
+        for (size_t i = begin; i < end; i++)
+        {
+            partOffsets[GetDigit(items[i], topShift, topMask)]++;
+        }
+    });
+
+    size_t bucketStarts[radix_size + 1] = {};
+    size_t offset = 0;
+    for (uint32_t digit = 0; digit < radix_size; digit++)
+    {
+        bucketStarts[digit] = offset;
+        for (uint32_t part = 0; part < threadCount; part++)
+        {
+            const size_t digitCount = offsets[part * radix_size + digit];
+            offsets[part * radix_size + digit] = offset;
+            offset += digitCount;
+        }
+    }
+    bucketStarts[radix_size] = offset;
+
+    ForEachPart(count, threadCount, [&](uint32_t part, size_t begin, size_t end)
+    {
+        size_t *const partOffsets = &offsets[part * radix_size];
+        uint64_t *const destination = scratch.data();
+
+        for (size_t i = begin; i < end; i++)
+        {
+            const uint64_t item = items[i];
+            destination[partOffsets[GetDigit(item, topShift, topMask)]++] = item;
+        }
+    });
+
+    // Every bucket takes the same number of passes, so all of them end up in the same buffer
+    const uint32_t bucketPassCount = GetPassCount(lowBit, topShift);
+
+    if (bucketPassCount > 0)
+    {
+        std::atomic<uint32_t> nextBucket(0);
+        ForEachPart(threadCount, threadCount, [&](uint32_t, size_t, size_t)
+        {
+            for (uint32_t bucket = nextBucket++; bucket < radix_size; bucket = nextBucket++)
+            {
+                const size_t start = bucketStarts[bucket];
+                SortDigits(scratch.data() + start, items.data() + start, bucketStarts[bucket + 1] - start, lowBit, topShift);
+            }
+        });
+    }
+
+    // The first pass left the items in scratch, and each pass of the buckets moved them across
+    if (0 == bucketPassCount % 2)
+    {
+        items.swap(scratch);
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A radix sort of 64-bit items by their upper 32 bits, 8 bits per pass. It is stable, so the
+// lower 32 bits can carry an index or a sequence that keeps the items with equal keys in their
+// original order. Only the bits that differ between the keys are sorted on, so keys below 2^24
+// take at most three passes and keys below 2^16 at most two.
+//
+// Up to 32K items are sorted by least significant digit passes, which stay in the cache. Larger
+// arrays take one most significant digit pass first, on the highest 8 differing bits, split over
+// the threads by contiguous parts: every thread counts the digits of its part, the counts are
+// summed into one offset per (digit, thread), and every thread then scatters its part behind the
+// parts of the threads before it. Each bucket this pass makes holds its items in their original
+// order, and the buckets are then sorted on their own by least significant digit passes over the
+// lower bits, in the cache, with the threads taking the next unsorted bucket until none are left.
+// Every pass keeps equal digits in order and the buckets follow each other by their high digit,
+// so the whole sort is stable.
+
+// The threads worth using to sort count items, up to one per hardware thread
+uint32_t GetRadixSortThreadCount(size_t count);
+
+// Sorts items by their upper 32 bits, scratch is resized to the size of items and used as the
+// second buffer of the passes
+void RadixSortByUpperWord(std::vector<uint64_t> &items, std::vector<uint64_t> &scratch, uint32_t threadCount);
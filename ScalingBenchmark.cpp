@@ -0,0 +1,247 @@
+#include "Benchmark.h"
+#include "VulkanCompute.h"
+#include "AllocationTracking.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+// The printf backends the tool supports, each compiled from PrintfScalingShader
+struct PrintfBackend
+{
+    const char *name;
+    const char *shaderPath;
+};
+
+static const PrintfBackend printfBackends[] = {
+    { "GLSL debugPrintfEXT", "PrintfScalingShader.comp.spv" },
+    { "HLSL printf", "PrintfScalingShader.hlsl.spv" }
+};
+
+// Time spent inside the callbacks, accumulated by the wrappers the benchmark registers
+static std::atomic<uint64_t> callbackNanoseconds(0);
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL TimedDebugCallback(
+    VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+    VkDebugUtilsMessageTypeFlagsEXT messageType,
+    const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
+    void *pUserData)
+{
+    const BenchmarkClock::time_point start = BenchmarkClock::now();
+    const VkBool32 result = VulkanDebugCallback(messageSeverity, messageType, pCallbackData, pUserData);
+    callbackNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(BenchmarkClock::now() - start).count(), std::memory_order_relaxed);
+
+    return result;
+}
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL TimedReportCallback(
+    VkDebugReportFlagsEXT flags,
+    VkDebugReportObjectTypeEXT objectType,
+    uint64_t object,
+    size_t location,
+    int32_t messageCode,
+    const char *pLayerPrefix,
+    const char *pMessage,
+    void *pUserData)
+{
+    const BenchmarkClock::time_point start = BenchmarkClock::now();
+    const VkBool32 result = VulkanReportCallback(flags, objectType, object, location, messageCode, pLayerPrefix, pMessage, pUserData);
+    callbackNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(BenchmarkClock::now() - start).count(), std::memory_order_relaxed);
+
+    return result;
+}
+
+// Converts a print fraction into the threshold PrintfScalingShader compares its hash against
+static uint32_t GetPrintThreshold(double fraction)
+{
+    return static_cast<uint32_t>(std::min(std::max(fraction, 0.0), 1.0) * 65536.0);
+}
+
+// Counts the invocations of a dispatch that PrintfScalingShader makes print for a threshold
+static uint64_t CountPrintingInvocations(uint32_t invocations, uint32_t printThreshold)
+{
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < invocations; i++)
+    {
+        if (((i * 2654435761u) >> 16) < printThreshold)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+// The measurements of one dispatch, in milliseconds
+struct ScalingSample
+{
+    double wall = 0.0;
+    double gpu = 0.0;
+    double wait = 0.0;
+    double callback = 0.0;
+    uint64_t messages = 0;
+};
+
+#define RETURN_ON_BAD_RESULT(result) { const VkResult checkedResult = (result); if (VK_SUCCESS != checkedResult) { return checkedResult; } }
+
+// Dispatches the scaling shader once and measures it
+static VkResult RunScalingDispatch(VkDevice device, uint32_t queueFamilyIndex, const QuerySupport &querySupport,
+    const std::vector<uint32_t> &shaderCode, uint32_t groupCount, uint32_t printThreshold, ScalingSample &sample)
+{
+    ComputeDispatch dispatch = {};
+    dispatch.groupCountX = groupCount;
+    dispatch.pushConstants[0] = printThreshold;
+    dispatch.pushConstantSize = sizeof(uint32_t);
+
+    RETURN_ON_BAD_RESULT(CreateComputeShaderModule(device, shaderCode, dispatch));
+    RETURN_ON_BAD_RESULT(CreateComputePipeline(device, dispatch));
+    RETURN_ON_BAD_RESULT(RecordComputeDispatch(device, queueFamilyIndex, querySupport, dispatch));
+
+    const uint64_t callbackNanosecondsBefore = callbackNanoseconds.load(std::memory_order_relaxed);
+    const uint64_t messagesBefore = printfMessageCount.load(std::memory_order_relaxed);
+
+    const BenchmarkClock::time_point submitStart = BenchmarkClock::now();
+    RETURN_ON_BAD_RESULT(SubmitComputeDispatch(device, queueFamilyIndex, dispatch));
+
+    const BenchmarkClock::time_point waitStart = BenchmarkClock::now();
+    RETURN_ON_BAD_RESULT(WaitForComputeDispatch(device, dispatch));
+    const BenchmarkClock::time_point waitEnd = BenchmarkClock::now();
+
+    sample.wall = std::chrono::duration<double, std::milli>(waitEnd - submitStart).count();
+    sample.wait = std::chrono::duration<double, std::milli>(waitEnd - waitStart).count();
+    sample.callback = (callbackNanoseconds.load(std::memory_order_relaxed) - callbackNanosecondsBefore) / 1000000.0;
+    sample.messages = printfMessageCount.load(std::memory_order_relaxed) - messagesBefore;
+
+    RETURN_ON_BAD_RESULT(GetComputeDispatchGpuTime(device, querySupport, dispatch, sample.gpu));
+
+    DestroyComputeDispatch(device, dispatch);
+
+    return VK_SUCCESS;
+}
+
+// Sets up a device with timed callbacks and sweeps every backend over every print fraction
+static VkResult RunScalingSweep(const BenchmarkOptions &options, const std::vector<double> &fractions, FILE *csv)
+{
+    if (!VerifyInstanceLayers() || !VerifyInstanceExtensions())
+    {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    VkInstance instance = {};
+    RETURN_ON_BAD_RESULT(CreateHeadlessVulkanInstance(instance));
+
+    VkDebugUtilsMessengerEXT debugMessenger = {};
+    RETURN_ON_BAD_RESULT(CreateDebugMessenger(instance, &debugMessenger, TimedDebugCallback));
+
+    VkDebugReportCallbackEXT reportCallback = {};
+    RETURN_ON_BAD_RESULT(CreateReportCallback(instance, &reportCallback, TimedReportCallback));
+
+    VkPhysicalDevice *physicalDevices = nullptr;
+    uint32_t physicalDeviceCount = 0;
+    RETURN_ON_BAD_RESULT(EnumerateDevices(instance, physicalDevices, physicalDeviceCount));
+
+    VkPhysicalDevice physicalDevice = {};
+    const VkResult selectResult = SelectPhysicalDevice(physicalDevices, physicalDeviceCount, options.deviceName, physicalDevice);
+    free(physicalDevices);
+    RETURN_ON_BAD_RESULT(selectResult);
+
+    uint32_t queueFamilyIndex = 0;
+    RETURN_ON_BAD_RESULT(GetBestComputeQueue(physicalDevice, queueFamilyIndex));
+
+    QuerySupport querySupport = {};
+    GetQuerySupport(physicalDevice, queueFamilyIndex, querySupport);
+
+    VkDevice device = {};
+    RETURN_ON_BAD_RESULT(CreateDevice(physicalDevice, queueFamilyIndex, querySupport, device));
+
+    const uint32_t groupCount = std::max(1u, (options.invocations + shader_local_size_x - 1) / shader_local_size_x);
+    const uint32_t invocations = groupCount * shader_local_size_x;
+
+    for (const PrintfBackend &backend : printfBackends)
+    {
+        const std::vector<uint32_t> shaderCode = readFile(backend.shaderPath);
+
+        for (double fraction : fractions)
+        {
+            const uint32_t printThreshold = GetPrintThreshold(fraction);
+
+            std::vector<double> wall, gpu, wait, callback, readback;
+            uint64_t messages = 0;
+
+            for (uint32_t i = 0; i < options.iterations; i++)
+            {
+                ScalingSample sample = {};
+                RETURN_ON_BAD_RESULT(RunScalingDispatch(device, queueFamilyIndex, querySupport, shaderCode, groupCount, printThreshold, sample));
+
+                // The validation layer reads the printf buffer back and calls the callbacks inside the
+                // wait, so whatever part of the wait is neither GPU execution nor callbacks is the layer
+                wall.push_back(sample.wall);
+                gpu.push_back(sample.gpu);
+                wait.push_back(sample.wait);
+                callback.push_back(sample.callback);
+                readback.push_back(std::max(0.0, sample.wait - sample.gpu - sample.callback));
+                messages = sample.messages;
+            }
+
+            fprintf(csv, "%s,%u,%.6f,%llu,%llu,%.4f,%.4f,%.4f,%.4f,%.4f\n", backend.name, invocations, fraction,
+                static_cast<unsigned long long>(CountPrintingInvocations(invocations, printThreshold)), static_cast<unsigned long long>(messages),
+                ComputeSampleStatistics(wall).median, ComputeSampleStatistics(gpu).median, ComputeSampleStatistics(wait).median,
+                ComputeSampleStatistics(readback).median, ComputeSampleStatistics(callback).median);
+            fflush(csv);
+        }
+    }
+
+    vkDestroyDevice(device, GetVulkanAllocator());
+
+    DestroyDebugMessenger(instance, debugMessenger);
+    DestroyReportCallback(instance, reportCallback);
+
+    vkDestroyInstance(instance, nullptr);
+
+    return VK_SUCCESS;
+}
+
+#undef RETURN_ON_BAD_RESULT
+
+// Sweeps the fraction of printing invocations of a dispatch for each printf backend and writes
+// the median wall, GPU, layer readback and callback time of each point to a CSV file
+int RunScalingBenchmark(const BenchmarkOptions &options)
+{
+    std::vector<double> fractions;
+    std::stringstream fractionList(options.fractions);
+    std::string fraction;
+    while (std::getline(fractionList, fraction, ','))
+    {
+        fractions.push_back(strtod(fraction.c_str(), nullptr));
+    }
+
+    FILE *csv = fopen(options.csvPath.c_str(), "w");
+    if (nullptr == csv)
+    {
+        fprintf(stderr, "Failed to open %s\n", options.csvPath.c_str());
+        return EXIT_FAILURE;
+    }
+
+    fprintf(csv, "backend,invocations,print_fraction,expected_messages,messages,wall_ms,gpu_ms,wait_ms,readback_ms,callback_ms\n");
+
+    // The callbacks format every message, but the console would dominate the timings
+    NullStreamBuffer nullStreamBuffer;
+    std::streambuf *const coutStreamBuffer = std::cout.rdbuf(&nullStreamBuffer);
+
+    const VkResult result = RunScalingSweep(options, fractions, csv);
+
+    std::cout.rdbuf(coutStreamBuffer);
+    fclose(csv);
+
+    if (VK_SUCCESS != result)
+    {
+        fprintf(stderr, "Scaling benchmark failed with VkResult %d\n", static_cast<int>(result));
+        return EXIT_FAILURE;
+    }
+
+    printf("Scaling benchmark results written to %s\n", options.csvPath.c_str());
+
+    return EXIT_SUCCESS;
+}
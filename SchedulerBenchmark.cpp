@@ -0,0 +1,182 @@
+#include "Benchmark.h"
+#include "VulkanCompute.h"
+#include "AllocationTracking.h"
+#include "ComputeScheduler.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+// One job in scheduler_long_job_period dispatches scheduler_long_job_groups workgroups, the others
+// scheduler_short_job_groups, so the queues the long jobs land on fall behind the others
+static const uint32_t scheduler_long_job_period = 8;
+static const uint32_t scheduler_long_job_groups = 512;
+static const uint32_t scheduler_short_job_groups = 16;
+
+#define RETURN_ON_BAD_RESULT(result) { const VkResult checkedResult = (result); if (VK_SUCCESS != checkedResult) { return checkedResult; } }
+
+// Submits count jobs of uneven length to the queues in turn, waits for them, and returns how long that took in seconds
+static VkResult RunUnevenJobs(ComputeScheduler &scheduler, const std::vector<uint32_t> &shaderCode, uint32_t count, double &seconds)
+{
+    const BenchmarkClock::time_point start = BenchmarkClock::now();
+
+    ComputeJob job;
+    job.shaderCode = &shaderCode;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        job.groupCountX = 0 == i % scheduler_long_job_period ? scheduler_long_job_groups : scheduler_short_job_groups;
+        scheduler.Submit(job);
+    }
+
+    const VkResult result = scheduler.WaitIdle();
+    seconds = std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+
+    return result;
+}
+
+// Runs the uneven jobs with stealing off and on, and prints the throughput and the balance of the queues
+static VkResult RunSchedulerComparison(const std::vector<ComputeQueueTarget> &targets, const std::vector<uint32_t> &shaderCode, const BenchmarkOptions &options)
+{
+    printf("%8s %8s %12s %8s %22s\n", "stealing", "queues", "jobs/s", "stolen", "busy min/max (ms)");
+
+    for (const bool stealing : { false, true })
+    {
+        ComputeScheduler scheduler;
+        for (const ComputeQueueTarget &target : targets)
+        {
+            scheduler.AddQueue(target);
+        }
+        scheduler.SetStealing(stealing);
+
+        RETURN_ON_BAD_RESULT(scheduler.Start());
+
+        double seconds = 0.0;
+        RETURN_ON_BAD_RESULT(RunUnevenJobs(scheduler, shaderCode, options.warmupIterations, seconds));
+
+        // The statistics are counted from Start, the warmup jobs are taken off
+        std::vector<ComputeQueueStatistics> warmup(scheduler.GetQueueCount());
+        for (uint32_t i = 0; i < scheduler.GetQueueCount(); i++)
+        {
+            warmup[i] = scheduler.GetQueueStatistics(i);
+        }
+
+        RETURN_ON_BAD_RESULT(RunUnevenJobs(scheduler, shaderCode, options.iterations, seconds));
+
+        uint64_t stolen = 0;
+        int64_t minimumBusy = INT64_MAX;
+        int64_t maximumBusy = 0;
+        for (uint32_t i = 0; i < scheduler.GetQueueCount(); i++)
+        {
+            const ComputeQueueStatistics statistics = scheduler.GetQueueStatistics(i);
+            const int64_t busy = statistics.busyNanoseconds - warmup[i].busyNanoseconds;
+
+            stolen += statistics.jobsStolen - warmup[i].jobsStolen;
+            minimumBusy = std::min(minimumBusy, busy);
+            maximumBusy = std::max(maximumBusy, busy);
+        }
+
+        printf("%8s %8u %12.1f %8llu %10.1f / %9.1f\n", stealing ? "on" : "off", scheduler.GetQueueCount(), options.iterations / seconds,
+            static_cast<unsigned long long>(stolen), minimumBusy / 1e6, maximumBusy / 1e6);
+        fflush(stdout);
+
+        scheduler.Stop();
+    }
+
+    return VK_SUCCESS;
+}
+
+// Sets up a device with every queue of its compute family, or --queues of them, and compares the scheduling
+static VkResult RunSchedulerSweep(const BenchmarkOptions &options)
+{
+    if (!VerifyInstanceLayers() || !VerifyInstanceExtensions())
+    {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    VkInstance instance = {};
+    RETURN_ON_BAD_RESULT(CreateHeadlessVulkanInstance(instance));
+
+    VkDebugUtilsMessengerEXT debugMessenger = {};
+    RETURN_ON_BAD_RESULT(CreateDebugMessenger(instance, &debugMessenger));
+
+    VkDebugReportCallbackEXT reportCallback = {};
+    RETURN_ON_BAD_RESULT(CreateReportCallback(instance, &reportCallback));
+
+    VkPhysicalDevice *physicalDevices = nullptr;
+    uint32_t physicalDeviceCount = 0;
+    RETURN_ON_BAD_RESULT(EnumerateDevices(instance, physicalDevices, physicalDeviceCount));
+
+    VkPhysicalDevice physicalDevice = {};
+    const VkResult selectResult = SelectPhysicalDevice(physicalDevices, physicalDeviceCount, options.deviceName, physicalDevice);
+    free(physicalDevices);
+    RETURN_ON_BAD_RESULT(selectResult);
+
+    uint32_t queueFamilyIndex = 0;
+    RETURN_ON_BAD_RESULT(GetBestComputeQueue(physicalDevice, queueFamilyIndex));
+
+    uint32_t queueCount = 0;
+    RETURN_ON_BAD_RESULT(GetComputeQueueCount(physicalDevice, queueFamilyIndex, queueCount));
+    if (0 != options.queues)
+    {
+        queueCount = std::min(queueCount, options.queues);
+    }
+
+    QuerySupport querySupport = {};
+    GetQuerySupport(physicalDevice, queueFamilyIndex, querySupport);
+
+    VkDevice device = {};
+    RETURN_ON_BAD_RESULT(CreateDevice(physicalDevice, queueFamilyIndex, querySupport, device, queueCount));
+
+    std::vector<ComputeQueueTarget> targets(queueCount);
+    for (uint32_t i = 0; i < queueCount; i++)
+    {
+        targets[i].device = device;
+        targets[i].queueFamilyIndex = queueFamilyIndex;
+        targets[i].queueIndex = i;
+        targets[i].querySupport = querySupport;
+    }
+
+    if (queueCount < 2)
+    {
+        fprintf(stderr, "The compute queue family has one queue, there is nothing to steal from\n");
+    }
+
+    const std::vector<uint32_t> shaderCode = readFile(options.shaderPath);
+    const VkResult result = RunSchedulerComparison(targets, shaderCode, options);
+
+    vkDeviceWaitIdle(device);
+    vkDestroyDevice(device, GetVulkanAllocator());
+
+    DestroyDebugMessenger(instance, debugMessenger);
+    DestroyReportCallback(instance, reportCallback);
+
+    vkDestroyInstance(instance, nullptr);
+
+    return result;
+}
+
+#undef RETURN_ON_BAD_RESULT
+
+// Dispatches --iterations jobs of uneven length over the queues of the compute family, first with
+// each queue running only the jobs submitted to it and then with work stealing, and reports the
+// throughput and how evenly busy the queues were
+int RunSchedulerBenchmark(const BenchmarkOptions &options)
+{
+    // The results are printed with printf, the callbacks would flood the console otherwise
+    NullStreamBuffer nullStreamBuffer;
+    std::streambuf *const coutStreamBuffer = std::cout.rdbuf(&nullStreamBuffer);
+
+    const VkResult result = RunSchedulerSweep(options);
+
+    std::cout.rdbuf(coutStreamBuffer);
+
+    if (VK_SUCCESS != result)
+    {
+        fprintf(stderr, "Scheduler benchmark failed with VkResult %d\n", static_cast<int>(result));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
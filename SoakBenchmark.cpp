@@ -0,0 +1,181 @@
+#include "Benchmark.h"
+#include "VulkanCompute.h"
+#include "AllocationTracking.h"
+#include "LatencyHistogram.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+// The soak benchmark records into these for its whole run, they are printed at every report interval
+static LatencyHistogram submitLatency;
+static LatencyHistogram completionLatency;
+static LatencyHistogram deliveryLatency;
+
+// When the dispatch whose messages are being delivered was submitted, in nanoseconds of BenchmarkClock
+static std::atomic<int64_t> submitTime(0);
+
+static int64_t GetBenchmarkNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(BenchmarkClock::now().time_since_epoch()).count();
+}
+
+// Records the time from submission to the arrival of every printf message
+static VKAPI_ATTR VkBool32 VKAPI_CALL DeliveryTimedDebugCallback(
+    VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+    VkDebugUtilsMessageTypeFlagsEXT messageType,
+    const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
+    void *pUserData)
+{
+    const int64_t arrivalTime = GetBenchmarkNanoseconds();
+    const uint64_t messagesBefore = printfMessageCount.load(std::memory_order_relaxed);
+
+    const VkBool32 result = VulkanDebugCallback(messageSeverity, messageType, pCallbackData, pUserData);
+
+    if (printfMessageCount.load(std::memory_order_relaxed) != messagesBefore)
+    {
+        deliveryLatency.Record(static_cast<uint64_t>(arrivalTime - submitTime.load(std::memory_order_relaxed)));
+    }
+
+    return result;
+}
+
+static void PrintSoakReport(double elapsedSeconds, uint64_t dispatches)
+{
+    printf("\n[SOAK] %.0f s, %llu dispatches\n", elapsedSeconds, static_cast<unsigned long long>(dispatches));
+    PrintLatencyHistogramHeader();
+    PrintLatencyHistogram("submit", submitLatency);
+    PrintLatencyHistogram("submit to fence signal", completionLatency);
+    PrintLatencyHistogram("message delivery", deliveryLatency);
+    fflush(stdout);
+}
+
+#define RETURN_ON_BAD_RESULT(result) { const VkResult checkedResult = (result); if (VK_SUCCESS != checkedResult) { return checkedResult; } }
+
+// Dispatches the shader once, waiting on a fence, and records its latencies
+static VkResult RunSoakDispatch(VkDevice device, uint32_t queueFamilyIndex, const QuerySupport &querySupport,
+    const std::vector<uint32_t> &shaderCode, VkFence fence)
+{
+    ComputeDispatch dispatch = {};
+    dispatch.fence = fence;
+
+    RETURN_ON_BAD_RESULT(CreateComputeShaderModule(device, shaderCode, dispatch));
+    RETURN_ON_BAD_RESULT(CreateComputePipeline(device, dispatch));
+    RETURN_ON_BAD_RESULT(RecordComputeDispatch(device, queueFamilyIndex, querySupport, dispatch));
+
+    const int64_t submitStart = GetBenchmarkNanoseconds();
+    submitTime.store(submitStart, std::memory_order_relaxed);
+    RETURN_ON_BAD_RESULT(SubmitComputeDispatch(device, queueFamilyIndex, dispatch));
+    const int64_t submitEnd = GetBenchmarkNanoseconds();
+
+    // The host only sees the fence signal once the wait returns, which also includes the
+    // validation layer reading back the printf buffer and delivering the messages
+    RETURN_ON_BAD_RESULT(WaitForComputeDispatch(device, dispatch));
+    const int64_t signalTime = GetBenchmarkNanoseconds();
+
+    submitLatency.Record(static_cast<uint64_t>(submitEnd - submitStart));
+    completionLatency.Record(static_cast<uint64_t>(signalTime - submitStart));
+
+    DestroyComputeDispatch(device, dispatch);
+
+    return VK_SUCCESS;
+}
+
+// Sets up a device and dispatches until the soak duration has passed
+static VkResult RunSoak(const BenchmarkOptions &options)
+{
+    if (!VerifyInstanceLayers() || !VerifyInstanceExtensions())
+    {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    VkInstance instance = {};
+    RETURN_ON_BAD_RESULT(CreateHeadlessVulkanInstance(instance));
+
+    VkDebugUtilsMessengerEXT debugMessenger = {};
+    RETURN_ON_BAD_RESULT(CreateDebugMessenger(instance, &debugMessenger, DeliveryTimedDebugCallback));
+
+    VkDebugReportCallbackEXT reportCallback = {};
+    RETURN_ON_BAD_RESULT(CreateReportCallback(instance, &reportCallback));
+
+    VkPhysicalDevice *physicalDevices = nullptr;
+    uint32_t physicalDeviceCount = 0;
+    RETURN_ON_BAD_RESULT(EnumerateDevices(instance, physicalDevices, physicalDeviceCount));
+
+    VkPhysicalDevice physicalDevice = {};
+    const VkResult selectResult = SelectPhysicalDevice(physicalDevices, physicalDeviceCount, options.deviceName, physicalDevice);
+    free(physicalDevices);
+    RETURN_ON_BAD_RESULT(selectResult);
+
+    uint32_t queueFamilyIndex = 0;
+    RETURN_ON_BAD_RESULT(GetBestComputeQueue(physicalDevice, queueFamilyIndex));
+
+    QuerySupport querySupport = {};
+    GetQuerySupport(physicalDevice, queueFamilyIndex, querySupport);
+
+    VkDevice device = {};
+    RETURN_ON_BAD_RESULT(CreateDevice(physicalDevice, queueFamilyIndex, querySupport, device));
+
+    VkFenceCreateInfo fenceCreateInfo = {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence = VK_NULL_HANDLE;
+    RETURN_ON_BAD_RESULT(vkCreateFence(device, &fenceCreateInfo, GetVulkanAllocator(), &fence));
+
+    const std::vector<uint32_t> shaderCode = readFile(options.shaderPath);
+
+    const BenchmarkClock::time_point start = BenchmarkClock::now();
+    const BenchmarkClock::time_point end = start + std::chrono::seconds(options.soakSeconds);
+    BenchmarkClock::time_point nextReport = start + std::chrono::seconds(options.reportIntervalSeconds);
+    uint64_t dispatches = 0;
+
+    VkResult result = VK_SUCCESS;
+    while (VK_SUCCESS == result && BenchmarkClock::now() < end)
+    {
+        result = RunSoakDispatch(device, queueFamilyIndex, querySupport, shaderCode, fence);
+        dispatches++;
+
+        if (0 != options.reportIntervalSeconds && BenchmarkClock::now() >= nextReport)
+        {
+            PrintSoakReport(std::chrono::duration<double>(BenchmarkClock::now() - start).count(), dispatches);
+            nextReport += std::chrono::seconds(options.reportIntervalSeconds);
+        }
+    }
+
+    PrintSoakReport(std::chrono::duration<double>(BenchmarkClock::now() - start).count(), dispatches);
+
+    vkDeviceWaitIdle(device);
+    vkDestroyFence(device, fence, GetVulkanAllocator());
+    vkDestroyDevice(device, GetVulkanAllocator());
+
+    DestroyDebugMessenger(instance, debugMessenger);
+    DestroyReportCallback(instance, reportCallback);
+
+    vkDestroyInstance(instance, nullptr);
+
+    return result;
+}
+
+#undef RETURN_ON_BAD_RESULT
+
+// Dispatches repeatedly for --duration seconds and prints HDR histograms of the submit,
+// submit to fence signal and message delivery latencies every --report-interval seconds
+// and at exit, so the tail latencies are visible and not just the averages
+int RunSoakBenchmark(const BenchmarkOptions &options)
+{
+    // The histograms are printed with printf, the callbacks would flood the console otherwise
+    NullStreamBuffer nullStreamBuffer;
+    std::streambuf *const coutStreamBuffer = std::cout.rdbuf(&nullStreamBuffer);
+
+    const VkResult result = RunSoak(options);
+
+    std::cout.rdbuf(coutStreamBuffer);
+
+    if (VK_SUCCESS != result)
+    {
+        fprintf(stderr, "Soak benchmark failed with VkResult %d\n", static_cast<int>(result));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+#include "Tracing.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A recorded trace event
+// Spans use both start and end, instants only use start
+struct TraceEvent
+{
+    const char *name;
+    char phase;
+    uint32_t threadId;
+    uint64_t start;
+    uint64_t end;
+    int64_t dispatchIndex;
+};
+
+// Each recording thread appends to its own buffer without any locking. The buffers are
+// owned by traceBuffers, so that their events are still there after the thread exits,
+// and the mutex is only taken the first time a thread records an event.
+struct TraceThreadBuffer
+{
+    uint32_t threadId = 0;
+    std::vector<TraceEvent> events;
+};
+
+static std::mutex traceBuffersMutex;
+static std::vector<std::unique_ptr<TraceThreadBuffer>> traceBuffers;
+
+static TraceThreadBuffer &GetThreadBuffer()
+{
+    thread_local TraceThreadBuffer *threadBuffer = nullptr;
+
+    if (nullptr == threadBuffer)
+    {
+        std::unique_ptr<TraceThreadBuffer> buffer(new TraceThreadBuffer());
+        buffer->events.reserve(4096);
+
+        std::lock_guard<std::mutex> lock(traceBuffersMutex);
+
+        // Thread id 0 is the GPU pseudo thread
+        buffer->threadId = static_cast<uint32_t>(traceBuffers.size()) + 1;
+        threadBuffer = buffer.get();
+        traceBuffers.push_back(std::move(buffer));
+    }
+
+    return *threadBuffer;
+}
+
+// The steady_clock time the trace clock starts at
+static std::chrono::steady_clock::time_point GetTraceEpoch()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return epoch;
+}
+
+uint64_t TraceNow()
+{
+    const std::chrono::steady_clock::time_point epoch = GetTraceEpoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+uint64_t TraceFromHostNanoseconds(int64_t hostNanoseconds)
+{
+    const int64_t epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(GetTraceEpoch().time_since_epoch()).count();
+    return hostNanoseconds > epoch ? static_cast<uint64_t>(hostNanoseconds - epoch) : 0;
+}
+
+void TraceSpan(const char *name, uint64_t start, uint64_t end)
+{
+    TraceThreadBuffer &buffer = GetThreadBuffer();
+    buffer.events.push_back({ name, 'X', buffer.threadId, start, end, -1 });
+}
+
+void TraceInstant(const char *name)
+{
+    TraceThreadBuffer &buffer = GetThreadBuffer();
+    buffer.events.push_back({ name, 'i', buffer.threadId, TraceNow(), 0, -1 });
+}
+
+void TraceGpuRange(const char *name, uint64_t start, uint64_t end, uint32_t dispatchIndex)
+{
+    TraceThreadBuffer &buffer = GetThreadBuffer();
+    buffer.events.push_back({ name, 'X', trace_gpu_thread_id, start, end, static_cast<int64_t>(dispatchIndex) });
+}
+
+// Writes one thread name metadata event, so the timeline shows "GPU" and "CPU n" instead of bare ids
+static void WriteThreadName(FILE *file, uint32_t threadId, bool &first)
+{
+    if (trace_gpu_thread_id == threadId)
+    {
+        fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"GPU\"}}", first ? "" : ",", threadId);
+    }
+    else
+    {
+        fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"CPU %u\"}}", first ? "" : ",", threadId, threadId);
+    }
+
+    first = false;
+}
+
+bool WriteTraceFile(const char *filename)
+{
+    FILE *file = fopen(filename, "w");
+    if (nullptr == file)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(traceBuffersMutex);
+
+    bool first = true;
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    WriteThreadName(file, trace_gpu_thread_id, first);
+    for (const std::unique_ptr<TraceThreadBuffer> &buffer : traceBuffers)
+    {
+        WriteThreadName(file, buffer->threadId, first);
+    }
+
+    // Chrome trace timestamps are in microseconds, fractions keep the nanosecond resolution
+    for (const std::unique_ptr<TraceThreadBuffer> &buffer : traceBuffers)
+    {
+        for (const TraceEvent &event : buffer->events)
+        {
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f", event.name, event.phase, event.threadId, event.start / 1000.0);
+
+            if ('X' == event.phase)
+            {
+                fprintf(file, ",\"dur\":%.3f", (event.end - event.start) / 1000.0);
+            }
+            else
+            {
+                fprintf(file, ",\"s\":\"t\"");
+            }
+
+            if (event.dispatchIndex >= 0)
+            {
+                fprintf(file, ",\"args\":{\"dispatch\":%lld}", static_cast<long long>(event.dispatchIndex));
+            }
+
+            fprintf(file, "}");
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+
+    return 0 == fclose(file);
+}
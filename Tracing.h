@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+
+// If this macro is set to "true" the phases of main() and RunComputeShader(), the GPU time
+// of each dispatch and the arrival of each printf message are recorded and written to
+// TRACE_OUTPUT_FILE as Chrome trace-event JSON, which can be opened in chrome://tracing or
+// https://ui.perfetto.dev. When it is "false" the TRACE_ macros compile to nothing.
+#define ENABLE_TRACING false
+
+#define TRACE_OUTPUT_FILE "VulkanPrintf.trace.json"
+
+// The id of the pseudo thread the GPU ranges are shown on in the timeline
+static const uint32_t trace_gpu_thread_id = 0;
+
+#if ENABLE_TRACING
+
+#define TRACE_CONCATENATE_INNER(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_INNER(a, b)
+
+// Records a span from this line to the end of the enclosing scope
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCATENATE(traceScope, __LINE__)(name)
+
+// Records a span between TRACE_BEGIN and the matching TRACE_END, for spans that do not follow a scope
+#define TRACE_BEGIN(span) const uint64_t span = TraceNow()
+#define TRACE_END(span, name) TraceSpan(name, span, TraceNow())
+
+// Records a single point in time
+#define TRACE_INSTANT(name) TraceInstant(name)
+
+// Records a range of GPU execution that has already been converted to the host timeline
+#define TRACE_GPU_RANGE(name, start, end, dispatchIndex) TraceGpuRange(name, start, end, dispatchIndex)
+
+#define TRACE_WRITE() WriteTraceFile(TRACE_OUTPUT_FILE)
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_BEGIN(span)
+#define TRACE_END(span, name)
+#define TRACE_INSTANT(name)
+#define TRACE_GPU_RANGE(name, start, end, dispatchIndex)
+#define TRACE_WRITE()
+
+#endif
+
+// Returns the trace clock, in nanoseconds since the first call
+uint64_t TraceNow();
+
+// Converts a time from the host clock of GetHostNanoseconds (std::chrono::steady_clock) to the trace clock
+uint64_t TraceFromHostNanoseconds(int64_t hostNanoseconds);
+
+// The event names must be string literals (or otherwise outlive the trace), they are not copied
+void TraceSpan(const char *name, uint64_t start, uint64_t end);
+void TraceInstant(const char *name);
+void TraceGpuRange(const char *name, uint64_t start, uint64_t end, uint32_t dispatchIndex);
+
+// Writes every recorded event to a Chrome trace-event JSON file
+// This must only be called once no other thread is recording, for example at exit
+bool WriteTraceFile(const char *filename);
+
+// Records a span covering the lifetime of the object
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name) : name(name), start(TraceNow()) {}
+    ~TraceScope() { TraceSpan(name, start, TraceNow()); }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name;
+    uint64_t start;
+};
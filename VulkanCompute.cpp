@@ -0,0 +1,1383 @@
+#include "VulkanCompute.h"
+#include "Tracing.h"
+#include "AllocationTracking.h"
+#include "PrintfRecord.h"
+#include "PrintfColumns.h"
+#include "PrintfDiff.h"
+#include "PrintfAggregation.h"
+#include "ClockCalibration.h"
+#include "JsonLineWriter.h"
+#include "IntegerFormat.h"
+#include "MessageCollector.h"
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <mutex>
+
+// For more reference, see:
+// https://github.com/KhronosGroup/Vulkan-ValidationLayers/blob/master/docs/debug_printf.md
+// https://stackoverflow.com/questions/64617959/vulkan-debugprintfext-doesnt-print-anything
+// https://github.com/KhronosGroup/GLSL/blob/master/extensions/ext/GLSL_EXT_debug_printf.txt
+// https://vulkan-tutorial.com/Drawing_a_triangle/Setup/Validation_layers
+
+// Note that "Debug Printf" functionality and "GPU-Assisted Validation" extensions cannot be run at the same time
+
+// VK_LAYER_KHRONOS_validation device extension must be enabled
+static const std::vector<const char *> requiredInstanceLayers = {
+    "VK_LAYER_KHRONOS_validation"
+};
+
+// VK_EXT_debug_utils and VK_EXT_debug_report instance extensions must be enabled
+// VK_EXT_debug_utils is needed for the VulkanDebugCallback function
+// VK_EXT_debug_report is needed for the VulkanReportCallback function
+static const std::vector<const char *> requiredInstanceExtensions = {
+    VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+    VK_EXT_DEBUG_REPORT_EXTENSION_NAME
+};
+
+// Counts the debug printf messages received by VulkanDebugCallback, which may be called from any thread
+std::atomic<uint64_t> printfMessageCount(0);
+
+// Returns true if the message was generated by debugPrintfEXT (GLSL) or printf (HLSL)
+// The validation layer names these messages "UNASSIGNED-DEBUG-PRINTF" or "WARNING-DEBUG-PRINTF"
+// depending on its version
+static bool IsDebugPrintfMessage(const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData)
+{
+    return nullptr != pCallbackData->pMessageIdName && nullptr != strstr(pCallbackData->pMessageIdName, "DEBUG-PRINTF");
+}
+
+// The size of the buffer the JSON Lines of the callbacks are encoded into, it is written out when it fills up
+static const size_t json_line_buffer_size = 1024 * 1024;
+
+static MessageOutputFormat messageOutputFormat = MESSAGE_OUTPUT_TEXT;
+
+// Both callbacks encode into the same writer, the mutex keeps their lines whole
+static std::mutex jsonLineMutex;
+static JsonLineWriter jsonLineWriter(json_line_buffer_size);
+
+void SetMessageOutputFormat(MessageOutputFormat format, std::streambuf *jsonOutput)
+{
+    FlushCollectedLines();
+
+    std::lock_guard<std::mutex> lock(jsonLineMutex);
+    jsonLineWriter.Flush();
+    jsonLineWriter.SetOutput(jsonOutput);
+    messageOutputFormat = format;
+}
+
+void FlushMessageOutput()
+{
+    FlushCollectedLines();
+
+    std::lock_guard<std::mutex> lock(jsonLineMutex);
+    jsonLineWriter.Flush();
+}
+
+static PrintfOutputOrder printfOutputOrder = PRINTF_ORDER_ARRIVAL;
+
+void SetPrintfOutputOrder(PrintfOutputOrder order)
+{
+    printfOutputOrder = order;
+}
+
+static const char *GetSeverityName(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity)
+{
+    switch (messageSeverity)
+    {
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT: return "verbose";
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT: return "info";
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT: return "warning";
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT: return "error";
+        default: return "unknown";
+    }
+}
+
+static const char *GetReportSeverityName(VkDebugReportFlagsEXT flags)
+{
+    if (0 != (flags & VK_DEBUG_REPORT_ERROR_BIT_EXT))
+    {
+        return "error";
+    }
+
+    if (0 != (flags & (VK_DEBUG_REPORT_WARNING_BIT_EXT | VK_DEBUG_REPORT_PERFORMANCE_WARNING_BIT_EXT)))
+    {
+        return "warning";
+    }
+
+    return 0 != (flags & VK_DEBUG_REPORT_INFORMATION_BIT_EXT) ? "info" : "verbose";
+}
+
+// Writes the message type flags as an array of their names
+static void WriteJsonMessageType(VkDebugUtilsMessageTypeFlagsEXT messageType)
+{
+    jsonLineWriter.BeginArray();
+    if (0 != (messageType & VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT))
+    {
+        jsonLineWriter.String("general");
+    }
+    if (0 != (messageType & VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT))
+    {
+        jsonLineWriter.String("validation");
+    }
+    if (0 != (messageType & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT))
+    {
+        jsonLineWriter.String("performance");
+    }
+    jsonLineWriter.EndArray();
+}
+
+// Writes the members of a printf message: its correlation id, invocation and arrival time, then
+// the format id, format string and one {"type", "value"} object per argument, or for messages
+// printed with an unknown format a null format id and the text of the message
+static void WriteJsonPrintfRecord(const PrintfRecord &record, const char *text, bool arrivalTime = true)
+{
+    jsonLineWriter.Key("correlationId");
+    jsonLineWriter.Uint(record.correlationId);
+    if (printf_unknown_invocation != record.invocation)
+    {
+        jsonLineWriter.Key("invocation");
+        jsonLineWriter.Uint(record.invocation);
+    }
+    if (arrivalTime)
+    {
+        jsonLineWriter.Key("hostTimeNs");
+        jsonLineWriter.Int(record.hostTime);
+    }
+
+    jsonLineWriter.Key("formatId");
+    if (printf_unknown_format == record.formatId)
+    {
+        jsonLineWriter.Null();
+        jsonLineWriter.Key("text");
+        jsonLineWriter.String(text);
+        return;
+    }
+
+    const PrintfFormatView &format = GetPrintfFormat(record.formatId);
+    jsonLineWriter.Uint(record.formatId);
+    jsonLineWriter.Key("format");
+    jsonLineWriter.String(format.format);
+
+    jsonLineWriter.Key("args");
+    jsonLineWriter.BeginArray();
+
+    uint32_t argument = 0;
+    for (size_t i = 0; i < format.count && argument < record.argumentCount; i++)
+    {
+        const PrintfOp &op = format.ops[i];
+        if (PRINTF_OP_LITERAL == op.type)
+        {
+            continue;
+        }
+
+        const uint64_t value = record.arguments[argument++];
+
+        jsonLineWriter.BeginObject();
+        jsonLineWriter.Key("type");
+
+        if (PRINTF_OP_SIGNED == op.type)
+        {
+            jsonLineWriter.String("int");
+            jsonLineWriter.Key("value");
+            jsonLineWriter.Int(static_cast<int64_t>(value));
+        }
+        else if (PRINTF_OP_UNSIGNED == op.type)
+        {
+            jsonLineWriter.String("uint");
+            jsonLineWriter.Key("value");
+            jsonLineWriter.Uint(value);
+        }
+        else
+        {
+            double floatingPoint = 0.0;
+            memcpy(&floatingPoint, &value, sizeof(floatingPoint));
+
+            jsonLineWriter.String(8 == op.size ? "double" : "float");
+            jsonLineWriter.Key("value");
+            if (8 == op.size)
+            {
+                jsonLineWriter.Double(floatingPoint);
+            }
+            else
+            {
+                jsonLineWriter.Float(static_cast<float>(floatingPoint));
+            }
+        }
+
+        jsonLineWriter.EndObject();
+    }
+
+    jsonLineWriter.EndArray();
+}
+
+// Writes one VulkanDebugCallback message as a JSON object on its own line, record is the parsed
+// printf message when it is one and nullptr otherwise, which are written with their whole text
+static void WriteJsonDebugMessage(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType,
+    const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData, const PrintfRecord *record, const char *text)
+{
+    std::lock_guard<std::mutex> lock(jsonLineMutex);
+
+    jsonLineWriter.BeginObject();
+    jsonLineWriter.Key("callback");
+    jsonLineWriter.String("debug_utils");
+    jsonLineWriter.Key("severity");
+    jsonLineWriter.String(GetSeverityName(messageSeverity));
+    jsonLineWriter.Key("type");
+    WriteJsonMessageType(messageType);
+    jsonLineWriter.Key("messageIdNumber");
+    jsonLineWriter.Int(pCallbackData->messageIdNumber);
+    jsonLineWriter.Key("messageIdName");
+    if (nullptr != pCallbackData->pMessageIdName)
+    {
+        jsonLineWriter.String(pCallbackData->pMessageIdName);
+    }
+    else
+    {
+        jsonLineWriter.Null();
+    }
+
+    if (nullptr != record)
+    {
+        WriteJsonPrintfRecord(*record, text);
+    }
+    else
+    {
+        jsonLineWriter.Key("message");
+        jsonLineWriter.String(pCallbackData->pMessage);
+    }
+
+    jsonLineWriter.EndObject();
+    jsonLineWriter.EndLine();
+}
+
+// Writes one VulkanReportCallback message as a JSON object on its own line, printf messages
+// are parsed as in WriteJsonDebugMessage but not captured, VulkanDebugCallback captures them
+static void WriteJsonReportMessage(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objectType, uint64_t object,
+    int32_t messageCode, const char *pLayerPrefix, const char *pMessage)
+{
+    PrintfRecord record = {};
+    const char *text = nullptr;
+    const bool parsed = ParsePrintfMessage(pMessage, record, text);
+
+    std::lock_guard<std::mutex> lock(jsonLineMutex);
+
+    jsonLineWriter.BeginObject();
+    jsonLineWriter.Key("callback");
+    jsonLineWriter.String("debug_report");
+    jsonLineWriter.Key("severity");
+    jsonLineWriter.String(GetReportSeverityName(flags));
+    jsonLineWriter.Key("flags");
+    jsonLineWriter.Uint(flags);
+    jsonLineWriter.Key("messageIdNumber");
+    jsonLineWriter.Int(messageCode);
+    jsonLineWriter.Key("objectType");
+    jsonLineWriter.Uint(static_cast<uint32_t>(objectType));
+    jsonLineWriter.Key("object");
+    jsonLineWriter.Uint(object);
+    jsonLineWriter.Key("layer");
+    jsonLineWriter.String(nullptr != pLayerPrefix ? pLayerPrefix : "");
+
+    if (parsed)
+    {
+        WriteJsonPrintfRecord(record, text);
+    }
+    else
+    {
+        jsonLineWriter.Key("message");
+        jsonLineWriter.String(pMessage);
+    }
+
+    jsonLineWriter.EndObject();
+    jsonLineWriter.EndLine();
+}
+
+// This Vulkan debug callback receives messages from the 
+// debugPrintfEXT (GLSL) or printf (HLSL) functions in the
+// compute shaders, along with other vulkan messages. 
+// For more reference, see:
+// https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkDebugUtilsMessengerEXT.html
+// https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/vkCreateDebugUtilsMessengerEXT.html
+// https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/vkDestroyDebugUtilsMessengerEXT.html
+// for more info
+VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugCallback(
+    VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+    VkDebugUtilsMessageTypeFlagsEXT messageType,
+    const VkDebugUtilsMessengerCallbackDataEXT * pCallbackData,
+    void *pUserData
+)
+{
+    ALLOCATION_CALLBACK_SCOPE();
+
+#if SHOW_ONLY_DEBUG_PRINTF_EXT_MESSAGES
+    // NOTE:
+    // This message filtering can (and probably should) be done as part of the 
+    // intialization in "vkCreateDebugUtilsMessengerEXT", using the 
+    // VkDebugUtilsMessengerCreateInfoEXT.messageType variable. 
+    // The initialization in "CreateDebugMessenger()" does not do any filtering 
+    // and it is instead done here to demonstrate one potential usage of the 
+    // messageType parameter, but is not optimal.
+    if (VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT != messageType)
+    {
+        return VK_FALSE;
+    }
+#endif
+
+    PrintfRecord record = {};
+    const char *printfText = nullptr;
+    bool captured = false;
+
+    if (IsDebugPrintfMessage(pCallbackData))
+    {
+        printfMessageCount.fetch_add(1, std::memory_order_relaxed);
+        TRACE_INSTANT("printf");
+
+        captured = ParsePrintfMessage(pCallbackData->pMessage, record, printfText);
+    }
+
+    // In invocation and summary order the captured printf messages are left to ReportComputeDispatch
+    const bool written = !captured || PRINTF_ORDER_ARRIVAL == printfOutputOrder;
+
+    if (written && MESSAGE_OUTPUT_JSONL == messageOutputFormat)
+    {
+        WriteJsonDebugMessage(messageSeverity, messageType, pCallbackData, captured ? &record : nullptr, printfText);
+    }
+
+    if (captured)
+    {
+        if (printf_unknown_format == record.formatId)
+        {
+            record.text = printfText;
+        }
+
+        StorePrintfRecord(std::move(record));
+    }
+
+    if (!written || MESSAGE_OUTPUT_JSONL == messageOutputFormat)
+    {
+        return VK_FALSE;
+    }
+
+    // The line is built in a buffer of the thread and collected whole, see MessageCollector.h
+    thread_local std::string line;
+    line.assign("[VULKAN DEBUG] : ");
+
+    switch (messageSeverity)
+    {
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT:
+        {
+            line += "[VERBOSE]";
+            break;
+        }
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:
+        {
+            line += "[INFO]   ";
+            break;
+        }
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT:
+        {
+            line += "[WARNING]";
+            break;
+        }
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT:
+        {
+            line += "[ERROR]  ";
+            break;
+        }
+        default:
+        {
+            line += "[UNKNOWN]";
+            break;
+        }
+    }
+
+    char number[integer_format_max_length];
+    line += " : [FLAGS]: ";
+    line.append(number, FormatDecimal(messageType, number));
+    line += '\t';
+    line += pCallbackData->pMessage;
+
+    CollectLine(line.data(), line.size());
+
+    return VK_FALSE;
+}
+
+// This Vulkan report callback receives messages from the 
+// debugPrintfEXT (GLSL) or printf (HLSL) functions in the
+// compute shaders, along with other vulkan messages. 
+// For more reference, see:
+// https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkDebugReportCallbackEXT.html
+// https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/vkCreateDebugReportCallbackEXT.html
+// https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/vkDestroyDebugReportCallbackEXT.html
+// for more info
+VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportCallback(
+    VkDebugReportFlagsEXT                       flags,
+    VkDebugReportObjectTypeEXT                  objectType,
+    uint64_t                                    object,
+    size_t                                      location,
+    int32_t                                     messageCode,
+    const char *pLayerPrefix,
+    const char *pMessage,
+    void *pUserData
+)
+{
+    ALLOCATION_CALLBACK_SCOPE();
+
+#if SHOW_ONLY_DEBUG_PRINTF_EXT_MESSAGES
+    // NOTE:
+    // This message filtering can (and probably should) be done as part of the 
+    // intialization in "vkCreateDebugReportCallbackEXT", using the 
+    // VkDebugReportCallbackCreateInfoEXT.flags variable. 
+    // The initialization in "CreateReportCallback()" does not do any filtering 
+    // and it is instead done here to demonstrate one potential usage of the 
+    // flags parameter, but is not optimal.
+    if (VK_DEBUG_REPORT_INFORMATION_BIT_EXT != flags)
+    {
+        return VK_FALSE;
+    }
+
+    std::string prefix(pMessage);
+    if (prefix.find("Validation") == std::string::npos)
+    {
+        return VK_FALSE;
+    }
+#endif
+
+    // In invocation and summary order the printf messages are left to ReportComputeDispatch, with the records VulkanDebugCallback captures
+    uint32_t correlationId = 0;
+    uint32_t invocation = 0;
+    const char *text = nullptr;
+    if (PRINTF_ORDER_ARRIVAL != printfOutputOrder && DecodePrintfRecord(pMessage, correlationId, invocation, text))
+    {
+        return VK_FALSE;
+    }
+
+    if (MESSAGE_OUTPUT_JSONL == messageOutputFormat)
+    {
+        WriteJsonReportMessage(flags, objectType, object, messageCode, pLayerPrefix, pMessage);
+        return VK_FALSE;
+    }
+
+    // The line is built in a buffer of the thread and collected whole, see MessageCollector.h
+    thread_local std::string line;
+    char number[integer_format_max_length];
+    line.assign("[VULKAN REPORT]: [FLAGS]: ");
+    line.append(number, FormatDecimal(flags, number));
+    line += " [LAYER]: ";
+    line += pLayerPrefix;
+    line += " [MESSAGE]: ";
+    line += pMessage;
+
+    CollectLine(line.data(), line.size());
+    return VK_FALSE;
+}
+
+// Reads a shader source file (SPIR-V) into a vector<uint32_t>
+std::vector<uint32_t> readFile(const std::string &filename) {
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file!");
+    }
+
+    size_t fileSize = (size_t)file.tellg();
+    std::vector<uint32_t> buffer(fileSize);
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(buffer.data()), fileSize);
+    file.close();
+
+    return buffer;
+}
+
+// Verifies the instance layers in requiredInstanceLayers are available
+bool VerifyInstanceLayers()
+{
+    if (requiredInstanceLayers.size() == 0)
+    {
+        return true;
+    }
+    
+    uint32_t layerCount = 0;
+    vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+
+    std::vector<VkLayerProperties> availableLayers(layerCount);
+    vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+
+    for (const char *layerName : requiredInstanceLayers) 
+    {
+        bool layerFound = false;
+
+        for (const auto &layerProperties : availableLayers) 
+        {
+            if (strcmp(layerName, layerProperties.layerName) == 0) 
+            {
+                layerFound = true;
+                break;
+            }
+        }
+
+        if (!layerFound) 
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Verifies the instance extensions in requiredInstanceExtensions are available
+bool VerifyInstanceExtensions()
+{
+    if (requiredInstanceExtensions.size() == 0)
+    {
+        return true;
+    }
+
+    uint32_t extensionCount = 0;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
+    for (const char *extensionName : requiredInstanceExtensions)
+    {
+        bool layerFound = false;
+
+        for (const auto &extensionProperties : availableExtensions)
+        {
+            if (strcmp(extensionName, extensionProperties.extensionName) == 0)
+            {
+                layerFound = true;
+                break;
+            }
+        }
+
+        if (!layerFound)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Creates a Vulkan instance (without a window)
+VkResult CreateHeadlessVulkanInstance(VkInstance &instance)
+{
+    VkApplicationInfo applicationInfo{};
+    applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    applicationInfo.pNext = 0;
+    applicationInfo.pApplicationName = "VKComputeSample";
+    applicationInfo.applicationVersion = 0;
+    applicationInfo.pEngineName = "";
+    applicationInfo.engineVersion = 0;
+    applicationInfo.apiVersion = VK_HEADER_VERSION_COMPLETE;
+
+    VkInstanceCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    createInfo.pApplicationInfo = &applicationInfo;
+    createInfo.enabledLayerCount = static_cast<uint32_t>(requiredInstanceLayers.size());
+    createInfo.ppEnabledLayerNames = requiredInstanceLayers.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredInstanceExtensions.size());
+    createInfo.ppEnabledExtensionNames = requiredInstanceExtensions.data();
+
+    VkValidationFeatureEnableEXT enabled = VK_VALIDATION_FEATURE_ENABLE_DEBUG_PRINTF_EXT;
+    VkValidationFeaturesEXT features = {};
+    features.sType = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT;
+    features.disabledValidationFeatureCount = 0;
+    features.enabledValidationFeatureCount = 1;
+    features.pDisabledValidationFeatures = nullptr;
+    features.pEnabledValidationFeatures = &enabled;
+
+    createInfo.pNext = &features;
+    
+    return vkCreateInstance(&createInfo, nullptr, &instance);
+}
+
+// Creates a Vulkan Debug Messenger that receives all messages
+// The callback defaults to VulkanDebugCallback, the benchmarks pass wrappers around it
+VkResult CreateDebugMessenger(VkInstance instance, VkDebugUtilsMessengerEXT *debugMessenger, PFN_vkDebugUtilsMessengerCallbackEXT callback)
+{
+    if (nullptr == instance || nullptr == debugMessenger)
+    {
+        return VK_ERROR_UNKNOWN;
+    }
+
+    VkDebugUtilsMessengerCreateInfoEXT createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+    createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |
+        VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+        VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+    createInfo.pfnUserCallback = callback;
+    createInfo.pUserData = nullptr;
+
+    // The function must by loaded dynamically by name
+    auto function = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
+    if (function != nullptr)
+    {
+        // call dll function vkCreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, debugMessenger);
+        return function(instance, &createInfo, nullptr, debugMessenger);
+    }
+    else 
+    {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+}
+
+// Destroys a previously created Vulkan Debug Messenger
+void DestroyDebugMessenger(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger)
+{
+    if (nullptr == instance || nullptr == debugMessenger)
+    {
+        return;
+    }
+
+    auto function = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
+    // call dll function vkDestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+    function(instance, debugMessenger, nullptr);
+}
+
+// Creates a Vulkan Report Callback that receives all messages
+// The callback defaults to VulkanReportCallback, the benchmarks pass wrappers around it
+VkResult CreateReportCallback(VkInstance instance, VkDebugReportCallbackEXT *reportCallback, PFN_vkDebugReportCallbackEXT callback)
+{
+    VkDebugReportCallbackCreateInfoEXT createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT;
+    createInfo.flags = VK_DEBUG_REPORT_DEBUG_BIT_EXT | VK_DEBUG_REPORT_ERROR_BIT_EXT |
+        VK_DEBUG_REPORT_PERFORMANCE_WARNING_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT | VK_DEBUG_REPORT_INFORMATION_BIT_EXT;
+    createInfo.pfnCallback = callback;
+    createInfo.pUserData = nullptr;
+    createInfo.pNext = nullptr;
+
+    // The function must by loaded dynamically by name
+    auto function = (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugReportCallbackEXT");
+    if (function != nullptr)
+    {
+        // call dll function vkCreateDebugReportCallbackEXT(instance, &createInfo, nullptr, reportCallback);
+        return function(instance, &createInfo, nullptr, reportCallback);
+    }
+    else
+    {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+}
+
+// Destroys a previously created Vulkan Report Callback
+void DestroyReportCallback(VkInstance instance, VkDebugReportCallbackEXT reportCallback)
+{
+    if (nullptr == instance || nullptr == reportCallback)
+    {
+        return;
+    }
+
+    auto function = (PFN_vkDestroyDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugReportCallbackEXT");
+    // call dll function vkDestroyDebugReportCallbackEXT(instance, reportCallback, nullptr);
+    function(instance, reportCallback, nullptr);
+}
+
+// Enumerates available Vulkan devices
+VkResult EnumerateDevices(VkInstance instance, VkPhysicalDevice *&devices, uint32_t &device_count)
+{
+    VkResult result = VK_SUCCESS;
+
+    result = vkEnumeratePhysicalDevices(instance, &device_count, 0);
+    if (VK_SUCCESS != result)
+    {
+        return result;
+    }
+
+    devices = (VkPhysicalDevice *)malloc(sizeof(VkPhysicalDevice) * device_count);
+
+    return vkEnumeratePhysicalDevices(instance, &device_count, devices);
+}
+
+// Selects the first physical device whose name contains nameFilter, or the first device if nameFilter is empty
+// This allows a specific driver (for example "llvmpipe" for lavapipe) to be chosen when several are installed
+VkResult SelectPhysicalDevice(const VkPhysicalDevice *devices, uint32_t device_count, const std::string &nameFilter, VkPhysicalDevice &physicalDevice)
+{
+    for (uint32_t i = 0; i < device_count; i++)
+    {
+        VkPhysicalDeviceProperties properties = {};
+        vkGetPhysicalDeviceProperties(devices[i], &properties);
+
+        if (nameFilter.empty() || nullptr != strstr(properties.deviceName, nameFilter.c_str()))
+        {
+            physicalDevice = devices[i];
+            return VK_SUCCESS;
+        }
+    }
+
+    return VK_ERROR_INITIALIZATION_FAILED;
+}
+
+// Gets the best compute queue family index for the compute shaders
+VkResult GetBestComputeQueue(VkPhysicalDevice physicalDevice, uint32_t &queueFamilyIndex)
+{
+    uint32_t queueFamilyPropertiesCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, 0);
+
+    VkQueueFamilyProperties *const queueFamilyProperties = (VkQueueFamilyProperties *)_malloca(sizeof(VkQueueFamilyProperties) * queueFamilyPropertiesCount);
+    if (nullptr == queueFamilyProperties)
+    {
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, queueFamilyProperties);
+
+    // first try and find a queue that has just the compute bit set
+    for (uint32_t i = 0; i < queueFamilyPropertiesCount; i++)
+    {
+        // mask out the sparse binding bit that we aren't caring about (yet!) and the transfer bit
+        const VkQueueFlags maskedFlags = (~(VK_QUEUE_TRANSFER_BIT | VK_QUEUE_SPARSE_BINDING_BIT) & queueFamilyProperties[i].queueFlags);
+
+        if (!(VK_QUEUE_GRAPHICS_BIT & maskedFlags) && (VK_QUEUE_COMPUTE_BIT & maskedFlags))
+        {
+            queueFamilyIndex = i;
+            return VK_SUCCESS;
+        }
+    }
+
+    // lastly get any queue that'll work for us
+    for (uint32_t i = 0; i < queueFamilyPropertiesCount; i++)
+    {
+        // mask out the sparse binding bit that we aren't caring about (yet!) and the transfer bit
+        const VkQueueFlags maskedFlags = (~(VK_QUEUE_TRANSFER_BIT | VK_QUEUE_SPARSE_BINDING_BIT) & queueFamilyProperties[i].queueFlags);
+
+        if (VK_QUEUE_COMPUTE_BIT & maskedFlags)
+        {
+            queueFamilyIndex = i;
+            return VK_SUCCESS;
+        }
+    }
+
+    return VK_ERROR_INITIALIZATION_FAILED;
+}
+
+// Gets how many queues the chosen queue family has
+VkResult GetComputeQueueCount(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t &queueCount)
+{
+    uint32_t queueFamilyPropertiesCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, 0);
+
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyPropertiesCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, queueFamilyProperties.data());
+
+    if (queueFamilyIndex >= queueFamilyPropertiesCount)
+    {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    queueCount = queueFamilyProperties[queueFamilyIndex].queueCount;
+
+    return VK_SUCCESS;
+}
+
+// Gets the optional query features available on the chosen queue family
+void GetQuerySupport(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, QuerySupport &querySupport)
+{
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    uint32_t queueFamilyPropertiesCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, 0);
+
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyPropertiesCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, queueFamilyProperties.data());
+
+    // When timestampComputeAndGraphics is VK_FALSE only some queue families support timestamps,
+    // and those that do not report a timestampValidBits of zero
+    const uint32_t timestampValidBits = queueFamilyIndex < queueFamilyPropertiesCount ? queueFamilyProperties[queueFamilyIndex].timestampValidBits : 0;
+
+    querySupport.timestampPeriod = properties.limits.timestampPeriod;
+    querySupport.timestampsSupported = 0 != timestampValidBits && properties.limits.timestampPeriod > 0.0f;
+    querySupport.timestampMask = timestampValidBits >= 64 ? ~0ull : ((1ull << timestampValidBits) - 1);
+
+#if ENABLE_PIPELINE_STATISTICS_QUERIES
+    VkPhysicalDeviceFeatures features = {};
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+
+    querySupport.pipelineStatisticsSupported = VK_TRUE == features.pipelineStatisticsQuery;
+#endif
+}
+
+// Creates a Vulkan device, enabling the device features needed by the supported queries
+VkResult CreateDevice(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, const QuerySupport &querySupport, VkDevice &device, uint32_t queueCount)
+{
+    const std::vector<float> queuePriorities(queueCount, 1.0f);
+    VkDeviceQueueCreateInfo deviceQueueCreateInfo = {};
+    deviceQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    deviceQueueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+    deviceQueueCreateInfo.queueCount = queueCount;
+    deviceQueueCreateInfo.pQueuePriorities = queuePriorities.data();
+
+    VkDeviceCreateInfo deviceCreateInfo = {};
+    deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceCreateInfo.queueCreateInfoCount = 1;
+    deviceCreateInfo.pQueueCreateInfos = &deviceQueueCreateInfo;
+
+    VkPhysicalDeviceFeatures enabledFeatures = {};
+    enabledFeatures.pipelineStatisticsQuery = querySupport.pipelineStatisticsSupported ? VK_TRUE : VK_FALSE;
+    deviceCreateInfo.pEnabledFeatures = &enabledFeatures;
+
+    if (nullptr != querySupport.calibratedTimestampsExtension)
+    {
+        deviceCreateInfo.enabledExtensionCount = 1;
+        deviceCreateInfo.ppEnabledExtensionNames = &querySupport.calibratedTimestampsExtension;
+    }
+
+#if ENABLE_ALLOCATION_TRACKING
+    DeviceMemoryReportChain deviceMemoryReportChain;
+    AddDeviceMemoryReport(physicalDevice, deviceCreateInfo, deviceMemoryReportChain);
+#endif
+
+    return vkCreateDevice(physicalDevice, &deviceCreateInfo, GetVulkanAllocator(), &device);
+}
+
+// Prints the GPU execution time of a dispatch measured by the timestamps written around vkCmdDispatch
+static void ReportDispatchTimestamps(uint32_t dispatchIndex, const QuerySupport &querySupport, const uint64_t timestamps[2])
+{
+    if (!querySupport.timestampsSupported)
+    {
+        std::cout << "[GPU TIMESTAMP] : dispatch " << dispatchIndex << " : timestamps are not supported on this queue family" << std::endl;
+        return;
+    }
+
+    // The timestamps only hold timestampValidBits bits, so the difference must wrap within that range
+    const uint64_t ticks = (timestamps[1] - timestamps[0]) & querySupport.timestampMask;
+    const double milliseconds = static_cast<double>(ticks) * querySupport.timestampPeriod / 1000000.0;
+
+    std::cout << "[GPU TIMESTAMP] : dispatch " << dispatchIndex << " : " << ticks << " ticks, " << milliseconds << " ms" << std::endl;
+}
+
+// Returns the number of distinct invocations that printed, an invocation may print several messages
+static uint64_t CountPrintingInvocations(const std::vector<PrintfRecord> &printfRecords)
+{
+    std::vector<uint32_t> invocations;
+    invocations.reserve(printfRecords.size());
+    for (const PrintfRecord &record : printfRecords)
+    {
+        if (printf_unknown_invocation != record.invocation)
+        {
+            invocations.push_back(record.invocation);
+        }
+    }
+
+    std::sort(invocations.begin(), invocations.end());
+    return static_cast<uint64_t>(std::unique(invocations.begin(), invocations.end()) - invocations.begin());
+}
+
+// Prints the compute shader invocations launched by a dispatch against the invocations that printed
+static void ReportDispatchStatistics(uint32_t dispatchIndex, uint64_t invocationsLaunched, uint64_t invocationsPrinted)
+{
+    const uint64_t invocationsWasted = invocationsLaunched > invocationsPrinted ? invocationsLaunched - invocationsPrinted : 0;
+    const double wastedPercentage = 0 != invocationsLaunched ? 100.0 * static_cast<double>(invocationsWasted) / static_cast<double>(invocationsLaunched) : 0.0;
+
+    std::cout << "[PIPELINE STATISTICS] : dispatch " << dispatchIndex << " : " << invocationsLaunched << " invocations launched, " <<
+        invocationsPrinted << " printed, " << invocationsWasted << " (" << wastedPercentage << "%) did not print" << std::endl;
+}
+
+// Prints where the time between submitting a dispatch and the wait returning went, with the
+// GPU timestamps and the printf arrival times all on the host clock
+static void ReportDispatchTimeline(const ComputeDispatch &dispatch, int64_t gpuStart, int64_t gpuEnd, const std::vector<PrintfRecord> &printfRecords)
+{
+    std::cout << "[GPU TIMELINE] : dispatch " << dispatch.dispatchIndex << " : submit to GPU start " << (gpuStart - dispatch.submitTime) / 1000.0 <<
+        " us, GPU execution " << (gpuEnd - gpuStart) / 1000.0 << " us, ";
+
+    if (printfRecords.empty())
+    {
+        std::cout << "GPU end to wait return " << (dispatch.waitCompletedTime - gpuEnd) / 1000.0 << " us";
+    }
+    else
+    {
+        const int64_t firstArrival = printfRecords.front().hostTime;
+        const int64_t lastArrival = printfRecords.back().hostTime;
+
+        // The layer reads the printf buffer back between the GPU finishing and the first message,
+        // and the callbacks run from the first message to the last
+        std::cout << "GPU end to first printf " << (firstArrival - gpuEnd) / 1000.0 << " us, printf delivery " << (lastArrival - firstArrival) / 1000.0 <<
+            " us, last printf to wait return " << (dispatch.waitCompletedTime - lastArrival) / 1000.0 << " us";
+    }
+
+    std::cout << " (clock drift " << clockCalibration.GetDriftPartsPerMillion() << " ppm, deviation " << clockCalibration.GetMaxDeviation() << " ns)" << std::endl;
+}
+
+// Creates the shader module for the provided shaderCode
+VkResult CreateComputeShaderModule(VkDevice device, const std::vector<uint32_t> &shaderCode, ComputeDispatch &dispatch)
+{
+    TRACE_SCOPE("module");
+    ALLOCATION_PHASE_SCOPE("module");
+
+    VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+    shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderModuleCreateInfo.codeSize = shaderCode.size();
+    shaderModuleCreateInfo.pCode = shaderCode.data();
+
+    return vkCreateShaderModule(device, &shaderModuleCreateInfo, GetVulkanAllocator(), &dispatch.shaderModule);
+}
+
+// Creates the pipeline layout and compute pipeline for a previously created shader module
+VkResult CreateComputePipeline(VkDevice device, ComputeDispatch &dispatch)
+{
+    TRACE_SCOPE("pipeline");
+    ALLOCATION_PHASE_SCOPE("pipeline");
+
+    VkResult result = VK_ERROR_UNKNOWN;
+
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(uint32_t) + dispatch.pushConstantSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+    result = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, GetVulkanAllocator(), &dispatch.pipelineLayout);
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
+    VkComputePipelineCreateInfo computePipelineCreateInfo = {};
+    computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computePipelineCreateInfo.stage.module = dispatch.shaderModule;
+    computePipelineCreateInfo.stage.pName = "main";
+    computePipelineCreateInfo.layout = dispatch.pipelineLayout;
+
+    return vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, GetVulkanAllocator(), &dispatch.pipeline);
+}
+
+// Creates the query pools and command buffer for a dispatch and records the dispatch into it.
+// Query pools and a command buffer the dispatch still has from an earlier one are reused.
+VkResult RecordComputeDispatch(VkDevice device, uint32_t queueFamilyIndex, const QuerySupport &querySupport, ComputeDispatch &dispatch)
+{
+    TRACE_SCOPE("record");
+    ALLOCATION_PHASE_SCOPE("record");
+
+    VkResult result = VK_ERROR_UNKNOWN;
+
+    // Two timestamps are written, one on each side of vkCmdDispatch
+    if (querySupport.timestampsSupported && VK_NULL_HANDLE == dispatch.timestampQueryPool)
+    {
+        VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+        queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolCreateInfo.queryCount = 2;
+
+        result = vkCreateQueryPool(device, &queryPoolCreateInfo, GetVulkanAllocator(), &dispatch.timestampQueryPool);
+        if (result != VK_SUCCESS)
+        {
+            return result;
+        }
+    }
+
+    // One pipeline statistics query counts the compute shader invocations of vkCmdDispatch
+    if (querySupport.pipelineStatisticsSupported && VK_NULL_HANDLE == dispatch.statisticsQueryPool)
+    {
+        VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+        queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolCreateInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        queryPoolCreateInfo.queryCount = 1;
+        queryPoolCreateInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+        result = vkCreateQueryPool(device, &queryPoolCreateInfo, GetVulkanAllocator(), &dispatch.statisticsQueryPool);
+        if (result != VK_SUCCESS)
+        {
+            return result;
+        }
+    }
+
+    // A command buffer kept from an earlier dispatch is recorded again, its pool must have been
+    // reset since that dispatch completed
+    if (VK_NULL_HANDLE == dispatch.commandBuffer)
+    {
+        if (VK_NULL_HANDLE != dispatch.sharedCommandPool)
+        {
+            dispatch.commandPool = dispatch.sharedCommandPool;
+        }
+        else
+        {
+            VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+            commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+
+            result = vkCreateCommandPool(device, &commandPoolCreateInfo, GetVulkanAllocator(), &dispatch.commandPool);
+            if (result != VK_SUCCESS)
+            {
+                return result;
+            }
+        }
+
+        VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+        commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        commandBufferAllocateInfo.commandPool = dispatch.commandPool;
+        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        commandBufferAllocateInfo.commandBufferCount = 1;
+
+        result = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &dispatch.commandBuffer);
+        if (result != VK_SUCCESS)
+        {
+            return result;
+        }
+    }
+
+    VkCommandBuffer commandBuffer = dispatch.commandBuffer;
+
+    VkCommandBufferBeginInfo commandBufferBeginInfo = {};
+    commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    result = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, dispatch.pipeline);
+
+    if (VK_NULL_HANDLE != dispatch.timestampQueryPool)
+    {
+        vkCmdResetQueryPool(commandBuffer, dispatch.timestampQueryPool, 0, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dispatch.timestampQueryPool, 0);
+    }
+
+    if (VK_NULL_HANDLE != dispatch.statisticsQueryPool)
+    {
+        vkCmdResetQueryPool(commandBuffer, dispatch.statisticsQueryPool, 0, 1);
+        vkCmdBeginQuery(commandBuffer, dispatch.statisticsQueryPool, 0, 0);
+    }
+
+    uint32_t pushConstants[1 + sizeof(dispatch.pushConstants) / sizeof(uint32_t)] = { dispatch.dispatchIndex };
+    memcpy(pushConstants + 1, dispatch.pushConstants, dispatch.pushConstantSize);
+    vkCmdPushConstants(commandBuffer, dispatch.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t) + dispatch.pushConstantSize, pushConstants);
+
+    vkCmdDispatch(commandBuffer, 0 != dispatch.groupCountX ? dispatch.groupCountX : shader_local_size_x, 1, 1);
+
+    if (VK_NULL_HANDLE != dispatch.statisticsQueryPool)
+    {
+        vkCmdEndQuery(commandBuffer, dispatch.statisticsQueryPool, 0);
+    }
+
+    if (VK_NULL_HANDLE != dispatch.timestampQueryPool)
+    {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, dispatch.timestampQueryPool, 1);
+    }
+
+    return vkEndCommandBuffer(commandBuffer);
+}
+
+// Submits a previously recorded dispatch to the queue of the queue family at dispatch.queueIndex
+VkResult SubmitComputeDispatch(VkDevice device, uint32_t queueFamilyIndex, ComputeDispatch &dispatch)
+{
+    TRACE_SCOPE("submit");
+    ALLOCATION_PHASE_SCOPE("submit");
+
+    vkGetDeviceQueue(device, queueFamilyIndex, dispatch.queueIndex, &dispatch.queue);
+
+    // The validation layer delivers the printf messages while the queue is waited on
+    BeginPrintfCapture(dispatch.dispatchIndex);
+
+    dispatch.submitTime = GetHostNanoseconds();
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &dispatch.commandBuffer;
+
+    if (nullptr != dispatch.queueMutex)
+    {
+        std::lock_guard<std::mutex> lock(*dispatch.queueMutex);
+        return vkQueueSubmit(dispatch.queue, 1, &submitInfo, dispatch.fence);
+    }
+
+    return vkQueueSubmit(dispatch.queue, 1, &submitInfo, dispatch.fence);
+}
+
+// Waits for a submitted dispatch to complete
+VkResult WaitForComputeDispatch(VkDevice device, ComputeDispatch &dispatch)
+{
+    TRACE_SCOPE("wait");
+    ALLOCATION_PHASE_SCOPE("wait");
+
+    VkResult result = VK_SUCCESS;
+    if (VK_NULL_HANDLE != dispatch.fence)
+    {
+        result = vkWaitForFences(device, 1, &dispatch.fence, VK_TRUE, UINT64_MAX);
+        if (result == VK_SUCCESS)
+        {
+            result = vkResetFences(device, 1, &dispatch.fence);
+        }
+    }
+    else
+    {
+        result = vkQueueWaitIdle(dispatch.queue);
+    }
+
+    dispatch.waitCompletedTime = GetHostNanoseconds();
+
+    return result;
+}
+
+// Writes the printf messages of a completed dispatch sorted by invocation, for PRINTF_ORDER_INVOCATION
+static void WriteOrderedPrintfRecords(const std::vector<PrintfRecord> &printfRecords)
+{
+    std::vector<uint32_t> order;
+    OrderPrintfRecordsByInvocation(printfRecords, order);
+
+    if (MESSAGE_OUTPUT_JSONL == messageOutputFormat)
+    {
+        std::lock_guard<std::mutex> lock(jsonLineMutex);
+
+        for (uint32_t index : order)
+        {
+            const PrintfRecord &record = printfRecords[index];
+
+            jsonLineWriter.BeginObject();
+            jsonLineWriter.Key("callback");
+            jsonLineWriter.String("printf");
+            WriteJsonPrintfRecord(record, record.text.c_str(), false);
+            jsonLineWriter.EndObject();
+            jsonLineWriter.EndLine();
+        }
+
+        jsonLineWriter.Flush();
+        return;
+    }
+
+    // The lines are rendered into one string and written at once
+    std::string lines;
+    char number[integer_format_max_length];
+
+    for (uint32_t index : order)
+    {
+        const PrintfRecord &record = printfRecords[index];
+
+        lines += "[VULKAN PRINTF] : " PRINTF_CORRELATION_TAG;
+        lines.append(number, FormatDecimal(record.correlationId, number));
+        if (printf_unknown_invocation != record.invocation)
+        {
+            lines += PRINTF_INVOCATION_TAG;
+            lines.append(number, FormatDecimal(record.invocation, number));
+        }
+        lines += "] ";
+
+        RenderPrintfRecord(record, lines);
+        lines += '\n';
+    }
+
+    std::cout.write(lines.data(), static_cast<std::streamsize>(lines.size()));
+    std::cout.flush();
+}
+
+// Reads back the queries of a completed dispatch and prints them
+VkResult ReportComputeDispatch(VkDevice device, const QuerySupport &querySupport, const ComputeDispatch &dispatch, std::vector<PrintfRecord> *takenRecords)
+{
+    TRACE_SCOPE("read queries");
+    ALLOCATION_PHASE_SCOPE("read queries");
+
+    // The dispatch's messages have all arrived, and are written out ahead of its reports
+    FlushMessageOutput();
+
+    // The messages of this dispatch, collected by their correlation id as they arrived
+    std::vector<PrintfRecord> printfRecords = TakePrintfRecords(dispatch.dispatchIndex);
+
+    if (PRINTF_ORDER_INVOCATION == printfOutputOrder)
+    {
+        WriteOrderedPrintfRecords(printfRecords);
+    }
+    else if (PRINTF_ORDER_SUMMARY == printfOutputOrder)
+    {
+        static PrintfAggregator printfAggregator;
+        printfAggregator.Add(printfRecords);
+        printfAggregator.Report(dispatch.dispatchIndex);
+    }
+
+    VkResult result = VK_SUCCESS;
+
+    uint64_t timestamps[2] = {};
+    if (VK_NULL_HANDLE != dispatch.timestampQueryPool)
+    {
+        result = vkGetQueryPoolResults(device, dispatch.timestampQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+        if (result != VK_SUCCESS)
+        {
+            return result;
+        }
+    }
+
+    ReportDispatchTimestamps(dispatch.dispatchIndex, querySupport, timestamps);
+
+    if (VK_NULL_HANDLE != dispatch.timestampQueryPool)
+    {
+        int64_t gpuStart = 0;
+        int64_t gpuEnd = 0;
+
+        // A fresh sample after every dispatch lets the model follow the drift between the clocks
+        if (clockCalibration.IsCalibrated() && VK_SUCCESS == clockCalibration.Sample())
+        {
+            gpuStart = clockCalibration.DeviceTicksToHostNanoseconds(timestamps[0]);
+            gpuEnd = clockCalibration.DeviceTicksToHostNanoseconds(timestamps[1]);
+
+            ReportDispatchTimeline(dispatch, gpuStart, gpuEnd, printfRecords);
+        }
+        else
+        {
+            // Without a calibrated clock the GPU range is placed so that it ends when the wait
+            // returned, which is its latest possible position on the host timeline
+            const uint64_t ticks = (timestamps[1] - timestamps[0]) & querySupport.timestampMask;
+            gpuEnd = dispatch.waitCompletedTime;
+            gpuStart = gpuEnd - static_cast<int64_t>(static_cast<double>(ticks) * querySupport.timestampPeriod);
+        }
+
+        TRACE_GPU_RANGE("dispatch", TraceFromHostNanoseconds(gpuStart), TraceFromHostNanoseconds(gpuEnd), dispatch.dispatchIndex);
+    }
+
+    if (VK_NULL_HANDLE != dispatch.statisticsQueryPool)
+    {
+        uint64_t invocationsLaunched = 0;
+        result = vkGetQueryPoolResults(device, dispatch.statisticsQueryPool, 0, 1, sizeof(invocationsLaunched), &invocationsLaunched, sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+        if (result != VK_SUCCESS)
+        {
+            return result;
+        }
+
+        ReportDispatchStatistics(dispatch.dispatchIndex, invocationsLaunched, CountPrintingInvocations(printfRecords));
+    }
+
+    printfColumnWriter.Append(printfRecords);
+    printfDiff.AddDispatch(dispatch.dispatchIndex, printfRecords);
+
+    if (nullptr != takenRecords)
+    {
+        *takenRecords = std::move(printfRecords);
+    }
+
+    return result;
+}
+
+// Gets the GPU execution time of a completed dispatch, or zero if timestamps are not supported
+VkResult GetComputeDispatchGpuTime(VkDevice device, const QuerySupport &querySupport, const ComputeDispatch &dispatch, double &milliseconds)
+{
+    milliseconds = 0.0;
+
+    if (VK_NULL_HANDLE == dispatch.timestampQueryPool)
+    {
+        return VK_SUCCESS;
+    }
+
+    uint64_t timestamps[2] = {};
+    const VkResult result = vkGetQueryPoolResults(device, dispatch.timestampQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
+    const uint64_t ticks = (timestamps[1] - timestamps[0]) & querySupport.timestampMask;
+    milliseconds = static_cast<double>(ticks) * querySupport.timestampPeriod / 1000000.0;
+
+    return VK_SUCCESS;
+}
+
+// Destroys the Vulkan objects of a dispatch, skipping any that were never created
+void DestroyComputeDispatch(VkDevice device, ComputeDispatch &dispatch)
+{
+    TRACE_SCOPE("destroy");
+    ALLOCATION_PHASE_SCOPE("destroy");
+
+    if (VK_NULL_HANDLE != dispatch.commandBuffer)
+    {
+        vkFreeCommandBuffers(device, dispatch.commandPool, 1, &dispatch.commandBuffer);
+    }
+
+    // A shared pool stays with its owner
+    if (dispatch.commandPool != dispatch.sharedCommandPool)
+    {
+        vkDestroyCommandPool(device, dispatch.commandPool, GetVulkanAllocator());
+    }
+    vkDestroyQueryPool(device, dispatch.statisticsQueryPool, GetVulkanAllocator());
+    vkDestroyQueryPool(device, dispatch.timestampQueryPool, GetVulkanAllocator());
+    vkDestroyPipeline(device, dispatch.pipeline, GetVulkanAllocator());
+    vkDestroyPipelineLayout(device, dispatch.pipelineLayout, GetVulkanAllocator());
+    vkDestroyShaderModule(device, dispatch.shaderModule, GetVulkanAllocator());
+
+    const ComputeDispatch parameters = dispatch;
+    dispatch = {};
+    dispatch.dispatchIndex = parameters.dispatchIndex;
+    dispatch.groupCountX = parameters.groupCountX;
+    dispatch.pushConstantSize = parameters.pushConstantSize;
+    dispatch.fence = parameters.fence;
+    dispatch.sharedCommandPool = parameters.sharedCommandPool;
+    dispatch.queueMutex = parameters.queueMutex;
+    dispatch.queueIndex = parameters.queueIndex;
+    memcpy(dispatch.pushConstants, parameters.pushConstants, sizeof(dispatch.pushConstants));
+}
+
+// Hands out the dispatch indices in order, to the dispatches of every thread
+uint32_t AllocateDispatchIndex()
+{
+    static std::atomic<uint32_t> nextDispatchIndex(0);
+    return nextDispatchIndex.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Runs a compute shader from the provided shaderCode
+// NOTE: This is not a generic function, and only works with the provided shaders.
+VkResult RunComputeShader(VkDevice device, uint32_t queueFamilyIndex, const QuerySupport &querySupport, const std::vector<uint32_t> &shaderCode)
+{
+    ComputeDispatch dispatch = {};
+    dispatch.dispatchIndex = AllocateDispatchIndex();
+
+    if (IsAllocationTrackingEnabled())
+    {
+        ResetAllocationCounts();
+    }
+
+    VkResult result = CreateComputeShaderModule(device, shaderCode, dispatch);
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
+    result = CreateComputePipeline(device, dispatch);
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
+    result = RecordComputeDispatch(device, queueFamilyIndex, querySupport, dispatch);
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
+    result = SubmitComputeDispatch(device, queueFamilyIndex, dispatch);
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
+    result = WaitForComputeDispatch(device, dispatch);
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
+    result = ReportComputeDispatch(device, querySupport, dispatch);
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
+    DestroyComputeDispatch(device, dispatch);
+
+    if (IsAllocationTrackingEnabled())
+    {
+        ReportAllocationCounts(dispatch.dispatchIndex);
+    }
+
+    return result;
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <atomic>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+struct PrintfRecord;
+
+// If this macro is set to "false" all vulkan debug and report messages will be printed
+#define SHOW_ONLY_DEBUG_PRINTF_EXT_MESSAGES true
+
+// If this macro is set to "true" each dispatch is wrapped in a pipeline statistics query that
+// counts the compute shader invocations launched, which is reported next to the number of
+// invocations that printed. Devices without the pipelineStatisticsQuery feature skip it.
+#define ENABLE_PIPELINE_STATISTICS_QUERIES true
+
+// This must match the thread sizes in the GLSL and HLSL shaders
+static const uint32_t shader_local_size_x = 512;
+
+// Describes the optional query features the compute shaders can use on the chosen queue family
+struct QuerySupport
+{
+    bool timestampsSupported = false;
+    float timestampPeriod = 0.0f;
+    uint64_t timestampMask = 0;
+    bool pipelineStatisticsSupported = false;
+
+    // The calibrated timestamps extension CreateDevice enables, nullptr when it is not supported
+    const char *calibratedTimestampsExtension = nullptr;
+};
+
+// Holds the Vulkan objects of one compute shader dispatch while it moves through the
+// phases of RunComputeShader. Each phase fills in the objects it creates, so that the
+// phases can also be called (and timed) one at a time.
+struct ComputeDispatch
+{
+    // Also the correlation id, the first push constant of every shader, which the shader
+    // prints at the start of each message so its messages can be collected per dispatch
+    uint32_t dispatchIndex = 0;
+
+    // The workgroups dispatched in X, shader_local_size_x when left at zero
+    uint32_t groupCountX = 0;
+
+    // Push constants that follow the correlation id, must be set before CreateComputePipeline
+    uint32_t pushConstants[4] = {};
+    uint32_t pushConstantSize = 0;
+
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+    VkQueryPool statisticsQueryPool = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+
+    // The queue of the family SubmitComputeDispatch submits to, it must be below the queue count
+    // the device was created with
+    uint32_t queueIndex = 0;
+
+    // Signalled by the submission when the caller sets it, WaitForComputeDispatch then waits
+    // for (and resets) the fence instead of the whole queue. The caller owns the fence.
+    VkFence fence = VK_NULL_HANDLE;
+
+    // When the caller sets it, RecordComputeDispatch allocates the command buffer from this pool
+    // instead of creating one for the dispatch. The caller owns the pool, and must only use it
+    // from the thread that runs the dispatch.
+    VkCommandPool sharedCommandPool = VK_NULL_HANDLE;
+
+    // When the caller sets it, SubmitComputeDispatch holds it around vkQueueSubmit, for queues
+    // that several threads submit to. Vulkan requires the queue to be externally synchronized.
+    std::mutex *queueMutex = nullptr;
+
+    // The host clock times (GetHostNanoseconds) vkQueueSubmit was called and the wait returned at
+    int64_t submitTime = 0;
+    int64_t waitCompletedTime = 0;
+};
+
+// Counts the debug printf messages received by VulkanDebugCallback
+extern std::atomic<uint64_t> printfMessageCount;
+
+// How VulkanDebugCallback and VulkanReportCallback write the messages they receive
+enum MessageOutputFormat
+{
+    MESSAGE_OUTPUT_TEXT,    // "[VULKAN DEBUG] : [INFO]    : [FLAGS]: ..." lines on std::cout
+    MESSAGE_OUTPUT_JSONL    // One JSON object per message, see WriteJsonDebugMessage
+};
+
+// Selects the callbacks' output format, before any messages arrive. JSON Lines are buffered
+// and written to jsonOutput, or to std::cout's stream buffer when it is nullptr, whenever
+// the buffer fills up and when FlushMessageOutput is called. Text lines are collected in
+// buffers of the threads the callbacks run on, and written whole to std::cout's stream buffer
+// in the order they were collected, when FlushMessageOutput is called, see MessageCollector.h.
+void SetMessageOutputFormat(MessageOutputFormat format, std::streambuf *jsonOutput = nullptr);
+void FlushMessageOutput();
+
+// When the callbacks' printf messages are written
+enum PrintfOutputOrder
+{
+    PRINTF_ORDER_ARRIVAL,    // As each message arrives, in the order the layer reads them back
+    PRINTF_ORDER_INVOCATION, // After the dispatch, sorted by invocation, see OrderPrintfRecordsByInvocation
+    PRINTF_ORDER_SUMMARY     // Never, only a summary of each dispatch's values, see PrintfAggregation.h
+};
+
+// Selects when the printf messages are written, before any messages arrive. In invocation order
+// the callbacks hold the printf messages back, and ReportComputeDispatch writes the messages of
+// each dispatch at once as "[VULKAN PRINTF] : [dispatch <id> invocation <index>] <text>" lines,
+// or as JSON objects without their arrival time, so that the output is the same on every run.
+// In summary order the callbacks hold them back too, and ReportComputeDispatch writes the
+// summary of their arguments instead of any message text.
+void SetPrintfOutputOrder(PrintfOutputOrder order);
+
+VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugCallback(
+    VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+    VkDebugUtilsMessageTypeFlagsEXT messageType,
+    const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
+    void *pUserData
+);
+
+VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportCallback(
+    VkDebugReportFlagsEXT                       flags,
+    VkDebugReportObjectTypeEXT                  objectType,
+    uint64_t                                    object,
+    size_t                                      location,
+    int32_t                                     messageCode,
+    const char *pLayerPrefix,
+    const char *pMessage,
+    void *pUserData
+);
+
+std::vector<uint32_t> readFile(const std::string &filename);
+
+// Vulkan setup
+bool VerifyInstanceLayers();
+bool VerifyInstanceExtensions();
+VkResult CreateHeadlessVulkanInstance(VkInstance &instance);
+VkResult CreateDebugMessenger(VkInstance instance, VkDebugUtilsMessengerEXT *debugMessenger, PFN_vkDebugUtilsMessengerCallbackEXT callback = VulkanDebugCallback);
+void DestroyDebugMessenger(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger);
+VkResult CreateReportCallback(VkInstance instance, VkDebugReportCallbackEXT *reportCallback, PFN_vkDebugReportCallbackEXT callback = VulkanReportCallback);
+void DestroyReportCallback(VkInstance instance, VkDebugReportCallbackEXT reportCallback);
+VkResult EnumerateDevices(VkInstance instance, VkPhysicalDevice *&devices, uint32_t &device_count);
+VkResult SelectPhysicalDevice(const VkPhysicalDevice *devices, uint32_t device_count, const std::string &nameFilter, VkPhysicalDevice &physicalDevice);
+VkResult GetBestComputeQueue(VkPhysicalDevice physicalDevice, uint32_t &queueFamilyIndex);
+
+// Returns how many queues the queue family has, for CreateDevice to create more than one
+VkResult GetComputeQueueCount(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t &queueCount);
+void GetQuerySupport(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, QuerySupport &querySupport);
+// Creates the device with queueCount queues of the family, all of the same priority
+VkResult CreateDevice(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, const QuerySupport &querySupport, VkDevice &device, uint32_t queueCount = 1);
+
+// Compute shader dispatch phases, in the order RunComputeShader calls them
+VkResult CreateComputeShaderModule(VkDevice device, const std::vector<uint32_t> &shaderCode, ComputeDispatch &dispatch);
+VkResult CreateComputePipeline(VkDevice device, ComputeDispatch &dispatch);
+VkResult RecordComputeDispatch(VkDevice device, uint32_t queueFamilyIndex, const QuerySupport &querySupport, ComputeDispatch &dispatch);
+VkResult SubmitComputeDispatch(VkDevice device, uint32_t queueFamilyIndex, ComputeDispatch &dispatch);
+VkResult WaitForComputeDispatch(VkDevice device, ComputeDispatch &dispatch);
+// Reports the printf messages, timings and statistics of a completed dispatch. When printfRecords
+// is set, the printf records of the dispatch are moved there once every report has read them.
+// The clock calibration, aggregator, column writer and diff it feeds are not thread safe, so
+// dispatches run from several threads must be reported one at a time, as ReportComputeJob does.
+VkResult ReportComputeDispatch(VkDevice device, const QuerySupport &querySupport, const ComputeDispatch &dispatch, std::vector<PrintfRecord> *printfRecords = nullptr);
+VkResult GetComputeDispatchGpuTime(VkDevice device, const QuerySupport &querySupport, const ComputeDispatch &dispatch, double &milliseconds);
+void DestroyComputeDispatch(VkDevice device, ComputeDispatch &dispatch);
+
+// Returns a new dispatch index, which is also the printf correlation id, from any thread
+uint32_t AllocateDispatchIndex();
+
+VkResult RunComputeShader(VkDevice device, uint32_t queueFamilyIndex, const QuerySupport &querySupport, const std::vector<uint32_t> &shaderCode);
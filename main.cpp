@@ -1,540 +1,357 @@
-#include <vulkan/vulkan_core.h>
+#include "VulkanCompute.h"
+#include "ComputeCoroutines.h"
+#include "ComputeJobs.h"
+#include "ComputeScheduler.h"
+#include "AllocationTracking.h"
+#include "ClockCalibration.h"
+#include "CompressedLog.h"
+#include "PrintfColumns.h"
+#include "PrintfDiff.h"
+#include "PrintfQuery.h"
+#include "Tracing.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <fstream>
+#include <thread>
 #include <vector>
 
-#define EXIT_ON_BAD_RESULT(result) if (VK_SUCCESS != (result)) { fprintf(stderr, "Failure at %u %s\n", __LINE__, __FILE__); exit(EXIT_FAILURE); }
-
-// If this macro is set to "false" all vulkan debug and report messages will be printed
-#define SHOW_ONLY_DEBUG_PRINTF_EXT_MESSAGES true
-
-// For more reference, see:
-// https://github.com/KhronosGroup/Vulkan-ValidationLayers/blob/master/docs/debug_printf.md
-// https://stackoverflow.com/questions/64617959/vulkan-debugprintfext-doesnt-print-anything
-// https://github.com/KhronosGroup/GLSL/blob/master/extensions/ext/GLSL_EXT_debug_printf.txt
-// https://vulkan-tutorial.com/Drawing_a_triangle/Setup/Validation_layers
-
-// Note that "Debug Printf" functionality and "GPU-Assisted Validation" extensions cannot be run at the same time
-
-// This must match the thread sizes in the GLSL and HLSL shader
-static const size_t shader_local_size_x = 512;
-
-// VK_LAYER_KHRONOS_validation device extension must be enabled
-static const std::vector<const char *> requiredInstanceLayers = {
-    "VK_LAYER_KHRONOS_validation"
-};
-
-// VK_EXT_debug_utils and VK_EXT_debug_report instance extensions must be enabled
-// VK_EXT_debug_utils is needed for the VulkanDebugCallback function
-// VK_EXT_debug_report is needed for the VulkanReportCallback function
-static const std::vector<const char *> requiredInstanceExtensions = {
-    VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
-    VK_EXT_DEBUG_REPORT_EXTENSION_NAME
-};
-
-// This Vulkan debug callback receives messages from the 
-// debugPrintfEXT (GLSL) or printf (HLSL) functions in the
-// compute shaders, along with other vulkan messages. 
-// For more reference, see:
-// https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkDebugUtilsMessengerEXT.html
-// https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/vkCreateDebugUtilsMessengerEXT.html
-// https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/vkDestroyDebugUtilsMessengerEXT.html
-// for more info
-static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugCallback(
-    VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-    VkDebugUtilsMessageTypeFlagsEXT messageType,
-    const VkDebugUtilsMessengerCallbackDataEXT * pCallbackData,
-    void *pUserData
-)
-{
-#if SHOW_ONLY_DEBUG_PRINTF_EXT_MESSAGES
-    // NOTE:
-    // This message filtering can (and probably should) be done as part of the 
-    // intialization in "vkCreateDebugUtilsMessengerEXT", using the 
-    // VkDebugUtilsMessengerCreateInfoEXT.messageType variable. 
-    // The initialization in "CreateDebugMessenger()" does not do any filtering 
-    // and it is instead done here to demonstrate one potential usage of the 
-    // messageType parameter, but is not optimal.
-    if (VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT != messageType)
-    {
-        return VK_FALSE;
-    }
-#endif
-
-    std::cout << "[VULKAN DEBUG] : ";
-
-    switch (messageSeverity)
-    {
-        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT:
-        {
-            std::cout << "[VERBOSE]";
-            break;
-        }
-        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:
-        {
-            std::cout << "[INFO]   ";
-            break;
-        }
-        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT:
-        {
-            std::cout << "[WARNING]";
-            break;
-        }
-        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT:
-        {
-            std::cout << "[ERROR]  ";
-            break;
-        }
-        default:
-        {
-            std::cout << "[UNKNOWN]";
-            break;
-        }
-    }
+#define EXIT_ON_BAD_RESULT(result) if (VK_SUCCESS != (result)) { CloseOutputs(); fprintf(stderr, "Failure at %u %s\n", __LINE__, __FILE__); exit(EXIT_FAILURE); }
 
-    std::cout << " : [FLAGS]: " << messageType << "\t" << pCallbackData->pMessage << std::endl;
+// The compressed log that replaces stdout with --compress=PATH
+static CompressedLogStreamBuffer compressedLog;
+static std::streambuf *stdoutStreamBuffer = nullptr;
 
-    return VK_FALSE;
-}
-
-// This Vulkan report callback receives messages from the 
-// debugPrintfEXT (GLSL) or printf (HLSL) functions in the
-// compute shaders, along with other vulkan messages. 
-// For more reference, see:
-// https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkDebugReportCallbackEXT.html
-// https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/vkCreateDebugReportCallbackEXT.html
-// https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/vkDestroyDebugReportCallbackEXT.html
-// for more info
-static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportCallback(
-    VkDebugReportFlagsEXT                       flags,
-    VkDebugReportObjectTypeEXT                  objectType,
-    uint64_t                                    object,
-    size_t                                      location,
-    int32_t                                     messageCode,
-    const char *pLayerPrefix,
-    const char *pMessage,
-    void *pUserData
-)
+// Writes out what is still buffered and closes the output files, before exiting
+static void CloseOutputs()
 {
-#if SHOW_ONLY_DEBUG_PRINTF_EXT_MESSAGES
-    // NOTE:
-    // This message filtering can (and probably should) be done as part of the 
-    // intialization in "vkCreateDebugReportCallbackEXT", using the 
-    // VkDebugReportCallbackCreateInfoEXT.flags variable. 
-    // The initialization in "CreateReportCallback()" does not do any filtering 
-    // and it is instead done here to demonstrate one potential usage of the 
-    // flags parameter, but is not optimal.
-    if (VK_DEBUG_REPORT_INFORMATION_BIT_EXT != flags)
-    {
-        return VK_FALSE;
-    }
+    FlushMessageOutput();
+    std::cout.rdbuf(stdoutStreamBuffer);
 
-    std::string prefix(pMessage);
-    if (prefix.find("Validation") == std::string::npos)
-    {
-        return VK_FALSE;
-    }
-#endif
-
-    std::cout << "[VULKAN REPORT]: [FLAGS]: " << flags << " [LAYER]: " << pLayerPrefix << " [MESSAGE]: " << pMessage << std::endl;
-    return VK_FALSE;
+    printfColumnWriter.Close();
+    printfDiff.Close();
+    compressedLog.Close();
 }
 
-// Reads a shader source file (SPIR-V) into a vector<uint32_t>
-static std::vector<uint32_t> readFile(const std::string &filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open file!");
-    }
-
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<uint32_t> buffer(fileSize);
-    file.seekg(0);
-    file.read(reinterpret_cast<char *>(buffer.data()), fileSize);
-    file.close();
-
-    return buffer;
-}
-
-// Verifies the instance layers in requiredInstanceLayers are available
-static bool VerifyInstanceLayers()
+// Writes the text of a compressed log to stdout, decompressing a few blocks at a time in parallel
+static int DecompressLog(const char *path)
 {
-    if (requiredInstanceLayers.size() == 0)
+    CompressedLogReader reader;
+    if (!reader.Open(path))
     {
-        return true;
+        fprintf(stderr, "Cannot read %s\n", path);
+        return 1;
     }
-    
-    uint32_t layerCount = 0;
-    vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
 
-    std::vector<VkLayerProperties> availableLayers(layerCount);
-    vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+    static const size_t blocks_in_flight = 4;
+    std::vector<uint8_t> blocks[blocks_in_flight];
+    bool decompressed[blocks_in_flight] = {};
 
-    for (const char *layerName : requiredInstanceLayers) 
+    for (size_t first = 0; first < reader.GetBlockCount(); first += blocks_in_flight)
     {
-        bool layerFound = false;
+        const size_t count = std::min(blocks_in_flight, reader.GetBlockCount() - first);
 
-        for (const auto &layerProperties : availableLayers) 
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < count; i++)
         {
-            if (strcmp(layerName, layerProperties.layerName) == 0) 
-            {
-                layerFound = true;
-                break;
-            }
+            threads.emplace_back([&, i] { decompressed[i] = reader.ReadBlock(first + i, blocks[i]); });
         }
+        decompressed[0] = reader.ReadBlock(first, blocks[0]);
 
-        if (!layerFound) 
+        for (std::thread &thread : threads)
         {
-            return false;
+            thread.join();
         }
-    }
-
-    return true;
-}
-
-// Verifies the instance extensions in requiredInstanceExtensions are available
-static bool VerifyInstanceExtensions()
-{
-    if (requiredInstanceExtensions.size() == 0)
-    {
-        return true;
-    }
-
-    uint32_t extensionCount = 0;
-    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
 
-    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
-
-    for (const char *extensionName : requiredInstanceExtensions)
-    {
-        bool layerFound = false;
-
-        for (const auto &extensionProperties : availableExtensions)
+        for (size_t i = 0; i < count; i++)
         {
-            if (strcmp(extensionName, extensionProperties.extensionName) == 0)
+            if (!decompressed[i])
             {
-                layerFound = true;
-                break;
+                fprintf(stderr, "Block %zu of %s is corrupt\n", first + i, path);
+                return 1;
             }
-        }
 
-        if (!layerFound)
-        {
-            return false;
+            fwrite(blocks[i].data(), 1, blocks[i].size(), stdout);
         }
     }
 
-    return true;
+    return 0;
 }
 
-// Creates a Vulkan instance (without a window)
-static VkResult CreateHeadlessVulkanInstance(VkInstance &instance)
+// Parses "A" or "A-B" into an inclusive range, returns false for anything else
+static bool ParseRange(const char *text, uint32_t &first, uint32_t &last)
 {
-    VkApplicationInfo applicationInfo{};
-    applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-    applicationInfo.pNext = 0;
-    applicationInfo.pApplicationName = "VKComputeSample";
-    applicationInfo.applicationVersion = 0;
-    applicationInfo.pEngineName = "";
-    applicationInfo.engineVersion = 0;
-    applicationInfo.apiVersion = VK_HEADER_VERSION_COMPLETE;
-
-    VkInstanceCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-    createInfo.pApplicationInfo = &applicationInfo;
-    createInfo.enabledLayerCount = static_cast<uint32_t>(requiredInstanceLayers.size());
-    createInfo.ppEnabledLayerNames = requiredInstanceLayers.data();
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredInstanceExtensions.size());
-    createInfo.ppEnabledExtensionNames = requiredInstanceExtensions.data();
-
-    VkValidationFeatureEnableEXT enabled = VK_VALIDATION_FEATURE_ENABLE_DEBUG_PRINTF_EXT;
-    VkValidationFeaturesEXT features = {};
-    features.sType = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT;
-    features.disabledValidationFeatureCount = 0;
-    features.enabledValidationFeatureCount = 1;
-    features.pDisabledValidationFeatures = nullptr;
-    features.pEnabledValidationFeatures = &enabled;
-
-    createInfo.pNext = &features;
-    
-    return vkCreateInstance(&createInfo, nullptr, &instance);
-}
+    char *end = nullptr;
+    const unsigned long long start = strtoull(text, &end, 10);
+    unsigned long long stop = start;
 
-// Creates a Vulkan Debug Messenger that receives all messages
-static VkResult CreateDebugMessenger(VkInstance instance, VkDebugUtilsMessengerEXT *debugMessenger)
-{
-    if (nullptr == instance || nullptr == debugMessenger)
+    if (end != text && '-' == *end)
     {
-        return VK_ERROR_UNKNOWN;
+        const char *next = end + 1;
+        stop = strtoull(next, &end, 10);
+        if (end == next)
+        {
+            return false;
+        }
     }
 
-    VkDebugUtilsMessengerCreateInfoEXT createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-    createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |
-        VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-    createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
-        VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-    createInfo.pfnUserCallback = VulkanDebugCallback;
-    createInfo.pUserData = nullptr;
-
-    // The function must by loaded dynamically by name
-    auto function = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
-    if (function != nullptr)
+    if (end == text || '\0' != *end || start > stop || stop > ~0u)
     {
-        // call dll function vkCreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, debugMessenger);
-        return function(instance, &createInfo, nullptr, debugMessenger);
+        return false;
     }
-    else 
-    {
-        return VK_ERROR_EXTENSION_NOT_PRESENT;
-    }
-}
 
-// Destroys a previously created Vulkan Debug Messenger
-static void DestroyDebugMessenger(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger)
-{
-    if (nullptr == instance || nullptr == debugMessenger)
-    {
-        return;
-    }
+    first = static_cast<uint32_t>(start);
+    last = static_cast<uint32_t>(stop);
 
-    auto function = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
-    // call dll function vkDestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
-    function(instance, debugMessenger, nullptr);
+    return true;
 }
 
-// Creates a Vulkan Report Callback that receives all messages
-static VkResult CreateReportCallback(VkInstance instance, VkDebugReportCallbackEXT *reportCallback)
+// Writes the messages of a column file that match the query to stdout, and what it took to stderr
+static int QueryColumns(const char *path, const PrintfQuery &query)
 {
-    VkDebugReportCallbackCreateInfoEXT createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT;
-    createInfo.flags = VK_DEBUG_REPORT_DEBUG_BIT_EXT | VK_DEBUG_REPORT_ERROR_BIT_EXT |
-        VK_DEBUG_REPORT_PERFORMANCE_WARNING_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT | VK_DEBUG_REPORT_INFORMATION_BIT_EXT;
-    createInfo.pfnCallback = VulkanReportCallback;
-    createInfo.pUserData = nullptr;
-    createInfo.pNext = nullptr;
-
-    // The function must by loaded dynamically by name
-    auto function = (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugReportCallbackEXT");
-    if (function != nullptr)
-    {
-        // call dll function vkCreateDebugReportCallbackEXT(instance, &createInfo, nullptr, reportCallback);
-        return function(instance, &createInfo, nullptr, reportCallback);
-    }
-    else
+    PrintfColumnReader reader;
+    if (!reader.Open(path))
     {
-        return VK_ERROR_EXTENSION_NOT_PRESENT;
+        fprintf(stderr, "Cannot read the index of %s\n", path);
+        return 1;
     }
-}
 
-// Destroys a previously created Vulkan Report Callback
-static void DestroyReportCallback(VkInstance instance, VkDebugReportCallbackEXT reportCallback)
-{
-    if (nullptr == instance || nullptr == reportCallback)
+    PrintfQueryStatistics statistics;
+    if (!RunPrintfQuery(reader, query, stdout, statistics))
     {
-        return;
+        fprintf(stderr, "A chunk of %s is corrupt\n", path);
+        return 1;
     }
 
-    auto function = (PFN_vkDestroyDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugReportCallbackEXT");
-    // call dll function vkDestroyDebugReportCallbackEXT(instance, reportCallback, nullptr);
-    function(instance, reportCallback, nullptr);
+    fprintf(stderr, "Read %u of %u chunks, %llu of %llu rows scanned matched\n", statistics.chunksRead, reader.GetChunkCount(),
+        static_cast<unsigned long long>(statistics.rowsMatched), static_cast<unsigned long long>(statistics.rowsScanned));
+
+    return 0;
 }
 
-// Enumerates available Vulkan devices
-static VkResult EnumerateDevices(VkInstance instance, VkPhysicalDevice *&devices, uint32_t &device_count)
+// Dispatches a shader on the event loop and reports what came back, for --coroutines
+static DispatchTask RunShaderCoroutine(DispatchEventLoop &loop, const char *language, const std::vector<uint32_t> &shaderCode)
 {
-    VkResult result = VK_SUCCESS;
+    ComputeJob job;
+    job.shaderCode = &shaderCode;
 
-    result = vkEnumeratePhysicalDevices(instance, &device_count, 0);
-    if (VK_SUCCESS != result)
+    const DispatchResult dispatchResult = co_await loop.Dispatch(job);
+    if (VK_SUCCESS == dispatchResult.result)
     {
-        return result;
+        std::cout << "[COROUTINE] : " << language << " dispatch " << dispatchResult.dispatchIndex << " : " << dispatchResult.printfRecords.size() << " printf records" << std::endl;
     }
-
-    devices = (VkPhysicalDevice *)malloc(sizeof(VkPhysicalDevice) * device_count);
-
-    return vkEnumeratePhysicalDevices(instance, &device_count, devices);
 }
 
-// Gets the best compute queue family index for the compute shaders
-static VkResult GetBestComputeQueue(VkPhysicalDevice physicalDevice, uint32_t &queueFamilyIndex)
+// Usage: VulkanPrintf [--format=text|jsonl] [--order=arrival|invocation] [--aggregate] [--columnar=PATH] [--compress=PATH]
+//                     [--diff-languages] [--save-signatures=PATH] [--diff-against=PATH] [--workers=N] [--queues=N]
+//                     [--coroutines]
+//        VulkanPrintf --decompress=PATH
+//        VulkanPrintf --query=PATH [--dispatch=A[-B]] [--invocation=A[-B]] [--format-id=N]
+//
+// --format=jsonl writes each Vulkan message as one JSON object per line on stdout, for log
+// pipelines to ingest without parsing the text format, and moves the reports to stderr
+// --order=invocation writes the printf messages of each dispatch sorted by invocation once it
+// completes, instead of in the order the layer reads them back, so runs can be diffed
+// --aggregate writes no printf messages, only the count, range, mean, distinct count and histogram
+// of each printf argument of every dispatch once it completes, see PrintfAggregation.h
+// --columnar=PATH also writes the printf records of every dispatch to a column file, see PrintfColumns.h
+// --compress=PATH writes what would go to stdout to a compressed log instead, see CompressedLog.h
+// --diff-languages compares the printf output of the HLSL dispatch with the GLSL one, invocation by
+// invocation, and reports the invocations that differ, see PrintfDiff.h
+// --save-signatures=PATH saves the per-invocation hashes of every dispatch for --diff-against=PATH
+// to compare a later run, build or driver with. main() returns 2 when a comparison finds differences.
+// --workers=N runs the GLSL and HLSL dispatches at once on N worker threads sharing the device, see
+// ComputeJobs.h. Their reports come in the order they complete, so it cannot be combined with the
+// comparisons, which pair the dispatches by their order.
+// --queues=N creates N queues of the compute family, or as many as it has, and runs the dispatches on
+// the work-stealing scheduler of ComputeScheduler.h with --workers=N submitting threads per queue
+// --coroutines runs the GLSL and HLSL dispatches at once as coroutines that co_await them on one
+// thread, see ComputeCoroutines.h
+// --decompress=PATH writes the text of a compressed log to stdout
+// --query=PATH writes the messages of a column file written by --columnar to stdout, only those of
+// the dispatches, invocations and format given, reading only the chunks its index says can hold them
+int main(int argc, char **argv)
 {
-    uint32_t queueFamilyPropertiesCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, 0);
-
-    VkQueueFamilyProperties *const queueFamilyProperties = (VkQueueFamilyProperties *)_malloca(sizeof(VkQueueFamilyProperties) * queueFamilyPropertiesCount);
-    if (nullptr == queueFamilyProperties)
+    static const char columnar_option[] = "--columnar=";
+    static const char compress_option[] = "--compress=";
+    static const char decompress_option[] = "--decompress=";
+    static const char query_option[] = "--query=";
+    static const char dispatch_option[] = "--dispatch=";
+    static const char invocation_option[] = "--invocation=";
+    static const char format_id_option[] = "--format-id=";
+    static const char save_signatures_option[] = "--save-signatures=";
+    static const char diff_against_option[] = "--diff-against=";
+    static const char workers_option[] = "--workers=";
+    static const char queues_option[] = "--queues=";
+
+    MessageOutputFormat outputFormat = MESSAGE_OUTPUT_TEXT;
+    const char *columnarPath = nullptr;
+    const char *compressPath = nullptr;
+    const char *queryPath = nullptr;
+    const char *signaturesPath = nullptr;
+    const char *baselinePath = nullptr;
+    uint32_t workerCount = 0;
+    uint32_t queueCount = 0;
+    bool useCoroutines = false;
+    PrintfQuery query;
+    bool validArguments = true;
+    for (int i = 1; i < argc; i++)
     {
-        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
-    }
-
-    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, queueFamilyProperties);
-
-    // first try and find a queue that has just the compute bit set
-    for (uint32_t i = 0; i < queueFamilyPropertiesCount; i++)
-    {
-        // mask out the sparse binding bit that we aren't caring about (yet!) and the transfer bit
-        const VkQueueFlags maskedFlags = (~(VK_QUEUE_TRANSFER_BIT | VK_QUEUE_SPARSE_BINDING_BIT) & queueFamilyProperties[i].queueFlags);
-
-        if (!(VK_QUEUE_GRAPHICS_BIT & maskedFlags) && (VK_QUEUE_COMPUTE_BIT & maskedFlags))
+        if (0 == strcmp(argv[i], "--format=text"))
         {
-            queueFamilyIndex = i;
-            return VK_SUCCESS;
+            outputFormat = MESSAGE_OUTPUT_TEXT;
+        }
+        else if (0 == strcmp(argv[i], "--format=jsonl"))
+        {
+            outputFormat = MESSAGE_OUTPUT_JSONL;
+        }
+        else if (0 == strcmp(argv[i], "--order=arrival"))
+        {
+            SetPrintfOutputOrder(PRINTF_ORDER_ARRIVAL);
+        }
+        else if (0 == strcmp(argv[i], "--order=invocation"))
+        {
+            SetPrintfOutputOrder(PRINTF_ORDER_INVOCATION);
+        }
+        else if (0 == strcmp(argv[i], "--aggregate"))
+        {
+            SetPrintfOutputOrder(PRINTF_ORDER_SUMMARY);
+        }
+        else if (0 == strncmp(argv[i], columnar_option, sizeof(columnar_option) - 1))
+        {
+            columnarPath = argv[i] + sizeof(columnar_option) - 1;
+        }
+        else if (0 == strncmp(argv[i], compress_option, sizeof(compress_option) - 1))
+        {
+            compressPath = argv[i] + sizeof(compress_option) - 1;
+        }
+        else if (0 == strcmp(argv[i], "--diff-languages"))
+        {
+            printfDiff.SetComparePairs(true);
+        }
+        else if (0 == strncmp(argv[i], save_signatures_option, sizeof(save_signatures_option) - 1))
+        {
+            signaturesPath = argv[i] + sizeof(save_signatures_option) - 1;
+        }
+        else if (0 == strncmp(argv[i], diff_against_option, sizeof(diff_against_option) - 1))
+        {
+            baselinePath = argv[i] + sizeof(diff_against_option) - 1;
+        }
+        else if (0 == strncmp(argv[i], workers_option, sizeof(workers_option) - 1))
+        {
+            uint32_t lastWorkerCount = 0;
+            validArguments = ParseRange(argv[i] + sizeof(workers_option) - 1, workerCount, lastWorkerCount) && workerCount == lastWorkerCount && 0 != workerCount;
+        }
+        else if (0 == strncmp(argv[i], queues_option, sizeof(queues_option) - 1))
+        {
+            uint32_t lastQueueCount = 0;
+            validArguments = ParseRange(argv[i] + sizeof(queues_option) - 1, queueCount, lastQueueCount) && queueCount == lastQueueCount && 0 != queueCount;
+        }
+        else if (0 == strcmp(argv[i], "--coroutines"))
+        {
+            useCoroutines = true;
+        }
+        else if (0 == strncmp(argv[i], decompress_option, sizeof(decompress_option) - 1))
+        {
+            return DecompressLog(argv[i] + sizeof(decompress_option) - 1);
+        }
+        else if (0 == strncmp(argv[i], query_option, sizeof(query_option) - 1))
+        {
+            queryPath = argv[i] + sizeof(query_option) - 1;
+        }
+        else if (0 == strncmp(argv[i], dispatch_option, sizeof(dispatch_option) - 1))
+        {
+            validArguments = ParseRange(argv[i] + sizeof(dispatch_option) - 1, query.firstCorrelationId, query.lastCorrelationId);
+        }
+        else if (0 == strncmp(argv[i], invocation_option, sizeof(invocation_option) - 1))
+        {
+            validArguments = ParseRange(argv[i] + sizeof(invocation_option) - 1, query.firstInvocation, query.lastInvocation);
+        }
+        else if (0 == strncmp(argv[i], format_id_option, sizeof(format_id_option) - 1))
+        {
+            uint32_t lastFormatId = 0;
+            validArguments = ParseRange(argv[i] + sizeof(format_id_option) - 1, query.formatId, lastFormatId) && query.formatId == lastFormatId;
+            query.matchFormat = true;
+        }
+        else
+        {
+            validArguments = false;
         }
-    }
-
-    // lastly get any queue that'll work for us
-    for (uint32_t i = 0; i < queueFamilyPropertiesCount; i++)
-    {
-        // mask out the sparse binding bit that we aren't caring about (yet!) and the transfer bit
-        const VkQueueFlags maskedFlags = (~(VK_QUEUE_TRANSFER_BIT | VK_QUEUE_SPARSE_BINDING_BIT) & queueFamilyProperties[i].queueFlags);
 
-        if (VK_QUEUE_COMPUTE_BIT & maskedFlags)
+        if (!validArguments)
         {
-            queueFamilyIndex = i;
-            return VK_SUCCESS;
+            fprintf(stderr, "Usage: VulkanPrintf [--format=text|jsonl] [--order=arrival|invocation] [--aggregate] [--columnar=PATH] [--compress=PATH]\n"
+                "                    [--diff-languages] [--save-signatures=PATH] [--diff-against=PATH] [--workers=N] [--queues=N]\n"
+                "                    [--coroutines]\n"
+                "       VulkanPrintf --decompress=PATH\n"
+                "       VulkanPrintf --query=PATH [--dispatch=A[-B]] [--invocation=A[-B]] [--format-id=N]\n");
+            return 1;
         }
     }
 
-    return VK_ERROR_INITIALIZATION_FAILED;
-}
-
-// Creates a Vulkan device
-static VkResult CreateDevice(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, VkDevice &device)
-{
-    const float queuePrioritory = 1.0f;
-    VkDeviceQueueCreateInfo deviceQueueCreateInfo = {};
-    deviceQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    deviceQueueCreateInfo.queueFamilyIndex = queueFamilyIndex;
-    deviceQueueCreateInfo.queueCount = 1;
-    deviceQueueCreateInfo.pQueuePriorities = &queuePrioritory;
-
-    VkDeviceCreateInfo deviceCreateInfo = {};
-    deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    deviceCreateInfo.queueCreateInfoCount = 1;
-    deviceCreateInfo.pQueueCreateInfos = &deviceQueueCreateInfo;
-
-    return vkCreateDevice(physicalDevice, &deviceCreateInfo, 0, &device);
-}
-
-// Runs a compute shader from the provided shaderCode
-// NOTE: This is not a generic function, and only works with the provided shaders.
-static VkResult RunComputeShader(VkDevice device, uint32_t queueFamilyIndex, const std::vector<uint32_t> &shaderCode)
-{
-    VkResult result = VK_ERROR_UNKNOWN;
-
-    VkShaderModuleCreateInfo glslShaderModuleCreateInfo = {};
-    glslShaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    glslShaderModuleCreateInfo.codeSize = shaderCode.size();
-    glslShaderModuleCreateInfo.pCode = shaderCode.data();
-
-    VkShaderModule glslShaderModule = nullptr;
-    result = vkCreateShaderModule(device, &glslShaderModuleCreateInfo, 0, &glslShaderModule);
-    if (result != VK_SUCCESS)
+    if (nullptr != queryPath)
     {
-        return result;
+        return QueryColumns(queryPath, query);
     }
 
-    VkPipelineLayoutCreateInfo glslPipelineLayoutCreateInfo = {};
-    glslPipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
-    VkPipelineLayout glslPipelineLayout = nullptr;
-    result = vkCreatePipelineLayout(device, &glslPipelineLayoutCreateInfo, 0, &glslPipelineLayout);
-    if (result != VK_SUCCESS)
+    if (nullptr != columnarPath && !printfColumnWriter.Open(columnarPath))
     {
-        return result;
+        fprintf(stderr, "Cannot open %s\n", columnarPath);
+        return 1;
     }
 
-    VkComputePipelineCreateInfo glslComputePipelineCreateInfo = {};
-    glslComputePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    glslComputePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    glslComputePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    glslComputePipelineCreateInfo.stage.module = glslShaderModule;
-    glslComputePipelineCreateInfo.stage.pName = "main";
-    glslComputePipelineCreateInfo.layout = glslPipelineLayout;
-
-    VkPipeline pipeline = nullptr;
-    result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &glslComputePipelineCreateInfo, VK_NULL_HANDLE, &pipeline);
-    if (result != VK_SUCCESS)
+    if ((0 != workerCount || 0 != queueCount || useCoroutines) && (printfDiff.IsEnabled() || nullptr != baselinePath || nullptr != signaturesPath))
     {
-        return result;
+        fprintf(stderr, "--workers, --queues and --coroutines cannot be combined with the printf comparisons\n");
+        return 1;
     }
 
-    VkCommandPoolCreateInfo commandPoolCreateInfo = {};
-    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
-
-    VkCommandPool commandPool;
-    result = vkCreateCommandPool(device, &commandPoolCreateInfo, VK_NULL_HANDLE, &commandPool);
-    if (result != VK_SUCCESS)
+    if (useCoroutines && (0 != workerCount || 0 != queueCount))
     {
-        return result;
+        fprintf(stderr, "--coroutines cannot be combined with --workers or --queues\n");
+        return 1;
     }
 
-    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
-    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    commandBufferAllocateInfo.commandPool = commandPool;
-    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    commandBufferAllocateInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer = {};
-    result = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &commandBuffer);
-    if (result != VK_SUCCESS)
+    // Saving the signatures would truncate the baseline before it is read
+    if (nullptr != baselinePath && nullptr != signaturesPath && 0 == strcmp(baselinePath, signaturesPath))
     {
-        return result;
+        fprintf(stderr, "The signatures cannot be saved to the baseline %s\n", baselinePath);
+        return 1;
     }
 
-    VkCommandBufferBeginInfo commandBufferBeginInfo = {};
-    commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    result = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
-    if (result != VK_SUCCESS)
+    if (nullptr != baselinePath && !printfDiff.OpenBaseline(baselinePath))
     {
-        return result;
+        fprintf(stderr, "Cannot read the signatures of %s\n", baselinePath);
+        return 1;
     }
 
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
-    vkCmdDispatch(commandBuffer, shader_local_size_x, 1, 1);
-    result = vkEndCommandBuffer(commandBuffer);
-    if (result != VK_SUCCESS)
+    if (nullptr != signaturesPath && !printfDiff.OpenSignatureOutput(signaturesPath))
     {
-        return result;
+        fprintf(stderr, "Cannot open %s\n", signaturesPath);
+        return 1;
     }
 
-    VkQueue queue = {};
-    vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
-
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-
-    result = vkQueueSubmit(queue, 1, &submitInfo, 0);
-    if (result != VK_SUCCESS)
+    if (nullptr != compressPath && !compressedLog.Open(compressPath))
     {
-        return result;
+        fprintf(stderr, "Cannot open %s\n", compressPath);
+        return 1;
     }
 
-    result = vkQueueWaitIdle(queue);
-    if (result != VK_SUCCESS)
+    stdoutStreamBuffer = std::cout.rdbuf();
+    std::streambuf *const outputStreamBuffer = compressedLog.IsOpen() ? &compressedLog : stdoutStreamBuffer;
+    if (MESSAGE_OUTPUT_JSONL == outputFormat)
     {
-        return result;
+        SetMessageOutputFormat(MESSAGE_OUTPUT_JSONL, outputStreamBuffer);
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+    else
+    {
+        std::cout.rdbuf(outputStreamBuffer);
     }
 
-    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
-    vkDestroyCommandPool(device, commandPool, NULL);
-    vkDestroyPipeline(device, pipeline, NULL);
-    vkDestroyPipelineLayout(device, glslPipelineLayout, NULL);
-    vkDestroyShaderModule(device, glslShaderModule, NULL);
-
-    return result;
-}
+    InitializeAllocationTracking();
 
-int main()
-{
     // Vulkan setup
 
     bool instanceLayersPresent = VerifyInstanceLayers();
@@ -545,15 +362,20 @@ int main()
         return 1;
     }
 
+    TRACE_BEGIN(instanceSpan);
     VkInstance instance = {};
     EXIT_ON_BAD_RESULT(CreateHeadlessVulkanInstance(instance));
+    TRACE_END(instanceSpan, "instance");
 
+    TRACE_BEGIN(messengerSpan);
     VkDebugUtilsMessengerEXT debugMessenger = {};
     EXIT_ON_BAD_RESULT(CreateDebugMessenger(instance, &debugMessenger));
 
     VkDebugReportCallbackEXT reportCallback = {};
     EXIT_ON_BAD_RESULT(CreateReportCallback(instance, &reportCallback));
+    TRACE_END(messengerSpan, "messengers");
 
+    TRACE_BEGIN(deviceSpan);
     VkPhysicalDevice *physicalDevices = nullptr;
     uint32_t physicalDeviceCount = 0;
     EXIT_ON_BAD_RESULT(EnumerateDevices(instance, physicalDevices, physicalDeviceCount));
@@ -561,27 +383,128 @@ int main()
     uint32_t queueFamilyIndex = 0;
     EXIT_ON_BAD_RESULT(GetBestComputeQueue(physicalDevices[0], queueFamilyIndex));
 
+    QuerySupport querySupport = {};
+    GetQuerySupport(physicalDevices[0], queueFamilyIndex, querySupport);
+    GetCalibratedTimestampSupport(instance, physicalDevices[0], querySupport);
+
+    if (0 != queueCount)
+    {
+        uint32_t familyQueueCount = 0;
+        EXIT_ON_BAD_RESULT(GetComputeQueueCount(physicalDevices[0], queueFamilyIndex, familyQueueCount));
+        queueCount = std::min(queueCount, familyQueueCount);
+    }
+
     VkDevice device = {};
-    EXIT_ON_BAD_RESULT(CreateDevice(physicalDevices[0], queueFamilyIndex, device));
+    EXIT_ON_BAD_RESULT(CreateDevice(physicalDevices[0], queueFamilyIndex, querySupport, device, std::max(1u, queueCount)));
+
+    // Devices without calibrated timestamps run uncalibrated, and skip the GPU timeline report
+    clockCalibration.Initialize(device, querySupport);
+    TRACE_END(deviceSpan, "device");
+
+    if (useCoroutines)
+    {
+        // Both shaders run as coroutines of an event loop on this thread
+        TRACE_BEGIN(coroutinesSpan);
+        const std::vector<uint32_t> glslShaderCode = readFile("GLSLComputeShader.comp.spv");
+        const std::vector<uint32_t> hlslShaderCode = readFile("HLSLComputeShader.comp.spv");
+
+        ComputeQueueTarget target;
+        target.device = device;
+        target.queueFamilyIndex = queueFamilyIndex;
+        target.querySupport = querySupport;
 
-    // GLSL Shader setup and run
-    auto glslShaderCode = readFile("GLSLComputeShader.comp.spv");
-    EXIT_ON_BAD_RESULT(RunComputeShader(device, queueFamilyIndex, glslShaderCode));
+        DispatchEventLoop loop;
+        EXIT_ON_BAD_RESULT(loop.Initialize(target));
 
-    // HLSL Shader setup and run
-    auto hlslShaderCode = readFile("HLSLComputeShader.comp.spv");
-    EXIT_ON_BAD_RESULT(RunComputeShader(device, queueFamilyIndex, hlslShaderCode));
+        loop.Spawn(RunShaderCoroutine(loop, "GLSL", glslShaderCode));
+        loop.Spawn(RunShaderCoroutine(loop, "HLSL", hlslShaderCode));
+
+        EXIT_ON_BAD_RESULT(loop.Run());
+        loop.Destroy();
+        TRACE_END(coroutinesSpan, "shader coroutines");
+    }
+    else if (0 != queueCount)
+    {
+        // Both shaders run as jobs spread over the queues
+        TRACE_BEGIN(jobsSpan);
+        const std::vector<uint32_t> glslShaderCode = readFile("GLSLComputeShader.comp.spv");
+        const std::vector<uint32_t> hlslShaderCode = readFile("HLSLComputeShader.comp.spv");
+
+        ComputeScheduler scheduler;
+        for (uint32_t i = 0; i < queueCount; i++)
+        {
+            ComputeQueueTarget target;
+            target.device = device;
+            target.queueFamilyIndex = queueFamilyIndex;
+            target.queueIndex = i;
+            target.querySupport = querySupport;
+            scheduler.AddQueue(target, std::max(1u, workerCount));
+        }
+        EXIT_ON_BAD_RESULT(scheduler.Start());
+
+        ComputeJob job;
+        job.shaderCode = &glslShaderCode;
+        scheduler.Submit(job);
+        job.shaderCode = &hlslShaderCode;
+        scheduler.Submit(job);
+
+        EXIT_ON_BAD_RESULT(scheduler.WaitIdle());
+        scheduler.Stop();
+        scheduler.Report();
+        TRACE_END(jobsSpan, "scheduled shader jobs");
+    }
+    else if (0 != workerCount)
+    {
+        // Both shaders run as jobs of a worker pool
+        TRACE_BEGIN(jobsSpan);
+        const std::vector<uint32_t> glslShaderCode = readFile("GLSLComputeShader.comp.spv");
+        const std::vector<uint32_t> hlslShaderCode = readFile("HLSLComputeShader.comp.spv");
+
+        ComputeJobRunner jobRunner;
+        EXIT_ON_BAD_RESULT(jobRunner.Start(device, queueFamilyIndex, querySupport, workerCount));
+
+        ComputeJob job;
+        job.shaderCode = &glslShaderCode;
+        jobRunner.Submit(job);
+        job.shaderCode = &hlslShaderCode;
+        jobRunner.Submit(job);
+
+        EXIT_ON_BAD_RESULT(jobRunner.WaitIdle());
+        jobRunner.Stop();
+        TRACE_END(jobsSpan, "shader jobs");
+    }
+    else
+    {
+        // GLSL Shader setup and run
+        TRACE_BEGIN(glslSpan);
+        auto glslShaderCode = readFile("GLSLComputeShader.comp.spv");
+        EXIT_ON_BAD_RESULT(RunComputeShader(device, queueFamilyIndex, querySupport, glslShaderCode));
+        TRACE_END(glslSpan, "GLSL shader");
+
+        // HLSL Shader setup and run
+        TRACE_BEGIN(hlslSpan);
+        auto hlslShaderCode = readFile("HLSLComputeShader.comp.spv");
+        EXIT_ON_BAD_RESULT(RunComputeShader(device, queueFamilyIndex, querySupport, hlslShaderCode));
+        TRACE_END(hlslSpan, "HLSL shader");
+    }
 
     // Vulkan cleanup
 
-    vkDestroyDevice(device, NULL);
+    TRACE_BEGIN(cleanupSpan);
+    clockCalibration.Reset();
+    vkDestroyDevice(device, GetVulkanAllocator());
 
     DestroyDebugMessenger(instance, debugMessenger);
     DestroyReportCallback(instance, reportCallback);
 
     vkDestroyInstance(instance, nullptr);
+    TRACE_END(cleanupSpan, "destroy");
 
-    return 0;
+    CloseOutputs();
+
+    TRACE_WRITE();
+
+    return 0 != printfDiff.GetFailedComparisonCount() ? 2 : 0;
 }
 
 #undef EXIT_ON_BAD_RESULT